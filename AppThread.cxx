@@ -0,0 +1,67 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "AppThread.h"
+
+#include "FinalProjectApp.h"
+
+AppThread
+::AppThread()
+{
+  m_App = 0;
+}
+
+
+AppThread
+::~AppThread()
+{
+  this->Stop();
+}
+
+
+FinalProjectApp*
+AppThread
+::StartApp()
+{
+  this->start();
+  m_Created.acquire();
+  return m_App;
+}
+
+
+void
+AppThread
+::Stop()
+{
+  if(this->isRunning())
+  {
+    this->quit();
+    this->wait();
+  }
+}
+
+
+void
+AppThread
+::run()
+{
+  m_App = new FinalProjectApp;
+  m_Created.release();
+
+  this->exec();
+
+  // Stop the camera and write the logs from the thread that owns them
+  delete m_App;
+  m_App = 0;
+}
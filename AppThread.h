@@ -0,0 +1,51 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _AppThread_h
+#define _AppThread_h
+
+#include <QSemaphore>
+#include <QThread>
+
+class FinalProjectApp;
+
+/** Runs FinalProjectApp in its own thread with its own event loop, so capture,
+detection, logging and image conversion never wait on window moves, resizes or
+repaints, and a slow detection pass doesn't freeze the GUI. The app is created
+and deleted on this thread, so its timers and capture thread belong to it. */
+class AppThread : public QThread
+{
+public:
+
+  /** Constructor */
+  AppThread();
+
+  /** Destructor; stops the app */
+  virtual ~AppThread();
+
+  /** Start the thread and wait until the app has been created in it */
+  FinalProjectApp* StartApp();
+
+  /** Leave the event loop, delete the app and wait for the thread */
+  void Stop();
+
+protected:
+
+  virtual void run();
+
+  FinalProjectApp* m_App;
+  QSemaphore m_Created;
+};
+
+#endif
@@ -0,0 +1,213 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "AttentionStatistics.h"
+
+AttentionStatistics
+::AttentionStatistics(int windowFrames)
+{
+  m_Window.assign(windowFrames > 0 ? windowFrames : 1, 0);
+  m_WindowPosition = 0;
+  m_WindowCount = 0;
+  m_WindowSum = 0;
+  this->StartTrial(0, 0);
+}
+
+
+void
+AttentionStatistics
+::StartTrial(int trial, double time)
+{
+  m_Summary.Trial = trial;
+  m_Summary.Feature = -1;
+  m_Summary.StartTime = time;
+  m_Summary.EndTime = time;
+  for(int e = 0; e < NUM_EPOCHS; e++)
+  {
+    m_Summary.Frames[e] = 0;
+    m_Summary.Detections[e] = 0;
+    m_Summary.EpochDropoutFrames[e] = 0;
+    m_Summary.EpochDropoutTime[e] = 0;
+  }
+  m_Summary.LongestDropoutFrames = 0;
+  m_Summary.LongestDropoutTime = 0;
+  m_Summary.MinWindowRate = -1;
+  m_Summary.ReachToDetection = -1;
+  m_Summary.Successful = false;
+
+  // The sliding window deliberately carries over from the previous trial
+  m_DropoutFrames = 0;
+  m_DropoutStart = time;
+  m_DropoutEpoch = -1;
+  m_EpochDropoutFrames = 0;
+  m_EpochDropoutStart = time;
+  m_ReachStart = -1;
+}
+
+
+void
+AttentionStatistics
+::EnterEpoch(int epoch, double time)
+{
+  // Only the first Reach epoch of a trial starts the clock
+  if(epoch == 2 && m_Summary.ReachToDetection < 0)
+    m_ReachStart = time;
+  else if(epoch != 2)
+    m_ReachStart = -1;
+}
+
+
+void
+AttentionStatistics
+::AddFrame(double time, int epoch, int feature, int detect)
+{
+  // Frames without tracking don't count towards anything
+  if(detect < 0 || epoch < 0 || epoch >= NUM_EPOCHS)
+    return;
+
+  m_Summary.Feature = feature;
+  m_Summary.EndTime = time;
+  m_Summary.Frames[epoch]++;
+
+  if(detect > 0)
+  {
+    m_Summary.Detections[epoch]++;
+    m_DropoutFrames = 0;
+    m_EpochDropoutFrames = 0;
+
+    if(m_ReachStart >= 0)
+    {
+      m_Summary.ReachToDetection = time - m_ReachStart;
+      m_ReachStart = -1;
+    }
+  }
+  else
+  {
+    if(m_DropoutFrames == 0)
+      m_DropoutStart = time;
+    m_DropoutFrames++;
+
+    if(m_DropoutFrames > m_Summary.LongestDropoutFrames)
+    {
+      m_Summary.LongestDropoutFrames = m_DropoutFrames;
+      m_Summary.LongestDropoutTime = time - m_DropoutStart;
+    }
+
+    // A dropout that crosses an epoch change counts in each epoch from its first frame there
+    if(m_EpochDropoutFrames == 0 || epoch != m_DropoutEpoch)
+    {
+      m_DropoutEpoch = epoch;
+      m_EpochDropoutFrames = 0;
+      m_EpochDropoutStart = time;
+    }
+    m_EpochDropoutFrames++;
+
+    if(m_EpochDropoutFrames > m_Summary.EpochDropoutFrames[epoch])
+    {
+      m_Summary.EpochDropoutFrames[epoch] = m_EpochDropoutFrames;
+      m_Summary.EpochDropoutTime[epoch] = time - m_EpochDropoutStart;
+    }
+  }
+
+  // Replace the oldest window entry and keep the running sum in step
+  int size = (int)m_Window.size();
+  if(m_WindowCount == size)
+    m_WindowSum -= m_Window[m_WindowPosition];
+  else
+    m_WindowCount++;
+  m_Window[m_WindowPosition] = detect > 0 ? 1 : 0;
+  m_WindowSum += m_Window[m_WindowPosition];
+  m_WindowPosition = (m_WindowPosition + 1) % size;
+
+  // Only judge the window once it is full
+  if(m_WindowCount == size && (m_Summary.MinWindowRate < 0 || this->GetWindowRate() < m_Summary.MinWindowRate))
+    m_Summary.MinWindowRate = this->GetWindowRate();
+}
+
+
+const TrialSummary&
+AttentionStatistics
+::EndTrial(double time, bool successful)
+{
+  m_Summary.EndTime = time;
+  m_Summary.Successful = successful;
+  return m_Summary;
+}
+
+
+double
+AttentionStatistics
+::GetDetectionRatio() const
+{
+  int frames = 0, detections = 0;
+  for(int e = 0; e < NUM_EPOCHS; e++)
+  {
+    frames += m_Summary.Frames[e];
+    detections += m_Summary.Detections[e];
+  }
+  return frames > 0 ? (double)detections / frames : 0;
+}
+
+
+double
+AttentionStatistics
+::GetEpochDetectionRatio(int epoch) const
+{
+  if(epoch < 0 || epoch >= NUM_EPOCHS || m_Summary.Frames[epoch] == 0)
+    return 0;
+  return (double)m_Summary.Detections[epoch] / m_Summary.Frames[epoch];
+}
+
+
+double
+AttentionStatistics
+::GetWindowRate() const
+{
+  return m_WindowCount > 0 ? (double)m_WindowSum / m_WindowCount : 0;
+}
+
+
+void
+AttentionStatistics
+::WriteHeader(FILE* file)
+{
+  fprintf(file, "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n", "Trial", "Feature", "Start", "End",
+    "Frames", "Ratio", "Ratio0", "Ratio1", "Ratio2",
+    "LongestDropoutFrames", "LongestDropoutTime",
+    "DropoutFrames0", "DropoutTime0", "DropoutFrames1", "DropoutTime1", "DropoutFrames2", "DropoutTime2",
+    "MinWindowRate", "ReachToDetection", "Success");
+}
+
+
+void
+AttentionStatistics
+::WriteRecord(FILE* file, const TrialSummary& s)
+{
+  int frames = 0, detections = 0;
+  double ratio[NUM_EPOCHS];
+  for(int e = 0; e < NUM_EPOCHS; e++)
+  {
+    frames += s.Frames[e];
+    detections += s.Detections[e];
+    ratio[e] = s.Frames[e] > 0 ? (double)s.Detections[e] / s.Frames[e] : 0;
+  }
+
+  fprintf(file, "%i,%i,%f,%f,%i,%f,%f,%f,%f,%i,%f,%i,%f,%i,%f,%i,%f,%f,%f,%i\n", s.Trial, s.Feature, s.StartTime, s.EndTime,
+    frames, frames > 0 ? (double)detections / frames : 0, ratio[0], ratio[1], ratio[2],
+    s.LongestDropoutFrames, s.LongestDropoutTime,
+    s.EpochDropoutFrames[0], s.EpochDropoutTime[0], s.EpochDropoutFrames[1], s.EpochDropoutTime[1],
+    s.EpochDropoutFrames[2], s.EpochDropoutTime[2],
+    s.MinWindowRate, s.ReachToDetection, s.Successful ? 1 : 0);
+}
@@ -0,0 +1,113 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef _AttentionStatistics_h
+#define _AttentionStatistics_h
+
+#include <stdio.h>
+#include <vector>
+
+/** Number of trial epochs: 0 = Intertrial, 1 = Button Press, 2 = Reach */
+#define NUM_EPOCHS 3
+
+/** Aggregates for one trial, written as one line of the trial summary file */
+struct TrialSummary
+{
+  int Trial;
+  int Feature;
+  double StartTime;
+  double EndTime;
+
+  /** Tracked frames and frames with a detection, per epoch */
+  int Frames[NUM_EPOCHS];
+  int Detections[NUM_EPOCHS];
+
+  /** Longest run of tracked frames without a detection */
+  int LongestDropoutFrames;
+  double LongestDropoutTime;
+
+  /** The same per epoch, counting only the part of a dropout inside the epoch */
+  int EpochDropoutFrames[NUM_EPOCHS];
+  double EpochDropoutTime[NUM_EPOCHS];
+
+  /** Lowest detection rate seen in the (full) sliding window during the trial;
+  -1 if the window never filled, which says nothing about attention */
+  double MinWindowRate;
+
+  /** Seconds from the start of the Reach epoch to the first detection; -1 if none */
+  double ReachToDetection;
+
+  bool Successful;
+};
+
+/** Keeps per-trial and per-epoch attention aggregates up to date with O(1) work per frame,
+so the trial outcome can be reported without rescanning the frame log. */
+class AttentionStatistics
+{
+public:
+
+  /** Constructor; the sliding window covers the last windowFrames tracked frames */
+  AttentionStatistics(int windowFrames = 30);
+
+  /** Reset the aggregates for a new trial */
+  void StartTrial(int trial, double time);
+
+  /** Note an epoch change within the current trial */
+  void EnterEpoch(int epoch, double time);
+
+  /** Add one frame. detect is 1 or 0 for a tracked frame, -1 when tracking is off */
+  void AddFrame(double time, int epoch, int feature, int detect);
+
+  /** Close the current trial and return its summary */
+  const TrialSummary& EndTrial(double time, bool successful);
+
+  /** Detection ratio over the whole trial so far */
+  double GetDetectionRatio() const;
+
+  /** Detection ratio within one epoch of the trial so far */
+  double GetEpochDetectionRatio(int epoch) const;
+
+  /** Detection rate over the sliding window */
+  double GetWindowRate() const;
+
+  /** Aggregates of the current (or just finished) trial */
+  const TrialSummary& GetSummary() const { return m_Summary; }
+
+  /** Write the column names / one summary record of the trial summary file */
+  static void WriteHeader(FILE* file);
+  static void WriteRecord(FILE* file, const TrialSummary& summary);
+
+protected:
+
+  TrialSummary m_Summary;
+
+  /** Ring buffer of the last detect values and their running sum */
+  std::vector<char> m_Window;
+  int m_WindowPosition;
+  int m_WindowCount;
+  int m_WindowSum;
+
+  /** The dropout in progress, and its part in the current epoch */
+  int m_DropoutFrames;
+  double m_DropoutStart;
+  int m_DropoutEpoch;
+  int m_EpochDropoutFrames;
+  double m_EpochDropoutStart;
+
+  /** Start of the Reach epoch, -1 when not in it or a detection was already seen */
+  double m_ReachStart;
+};
+
+#endif
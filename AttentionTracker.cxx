@@ -0,0 +1,581 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "AttentionTracker.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "ImagePool.h"
+#include "Trace.h"
+
+AttentionTracker
+::AttentionTracker()
+{
+  // Detection runs on a copy no wider than VGA, which is what the cascades were tuned on
+  m_MaxDetectionWidth = 640;
+  m_DetectionLimit = m_MaxDetectionWidth;
+  m_DetectionWidth = 0;
+  m_DetectionScale = 1.0;
+  m_DetectionColor = 0;
+  m_DetectionGray = 0;
+  m_ImagePool = 0;
+  m_FrameInterval = 1;
+
+  // Carry detections forward over static frames, but re-detect at least once a second
+  m_MotionGateEnabled = true;
+  m_GateTimeoutFrames = 30;
+  m_FramesSinceDetection = 0;
+  m_GateFeature = -1;
+  m_CarryDetection = false;
+
+  m_Feature = FeatureTracker::EyePairBig;
+  m_NumberOfDetections = 0;
+
+  m_AttentionCounter = 0;
+  m_Threshold = 40;
+
+  m_Epoch = 0;
+  m_Trial = 0;
+  m_SuccessfulTrials = 0;
+  m_FailedTrials = 0;
+  m_Statistics.StartTrial(m_Trial, 0);
+  m_LastTrial = m_Statistics.GetSummary();
+}
+
+
+AttentionTracker
+::~AttentionTracker()
+{
+  this->ReleaseDetectionImages();
+}
+
+
+void
+AttentionTracker
+::ReleaseDetectionImages()
+{
+  for(size_t s = 0; s < m_Streams.size(); s++)
+  {
+    ImagePool::Free(m_ImagePool, &m_Streams[s].Color);
+    ImagePool::Free(m_ImagePool, &m_Streams[s].Gray);
+  }
+  m_Streams.clear();
+  m_DetectionColor = 0;
+  m_DetectionGray = 0;
+
+  for(size_t b = 0; b < m_BatchGray.size(); b++)
+    ImagePool::Free(m_ImagePool, &m_BatchGray[b]);
+  m_BatchGray.clear();
+}
+
+
+void
+AttentionTracker
+::SetImagePool(ImagePool* pool)
+{
+  this->ReleaseDetectionImages();
+  m_ImagePool = pool;
+  m_MotionGate.SetImagePool(pool);
+  m_Tracker.GetDetectors().SetImagePool(pool);
+
+  // The gate's reference thumbnail is gone
+  m_GateFeature = -1;
+}
+
+
+bool
+AttentionTracker
+::Initialize()
+{
+  // Full effort during the task epochs, much less during intertrial
+  if(m_EpochPolicy.Load("EpochPolicy.txt"))
+    printf("Loaded detection budgets from EpochPolicy.txt\n");
+
+  // Per-cascade detection settings found by the ParameterSweep tool, if available
+  if(m_DetectionProfile.Load("DetectionProfile.txt"))
+    printf("Loaded detection settings from DetectionProfile.txt\n");
+
+  // Load the cascades for every feature up front so we don't have to read from file for every frame
+  m_Tracker.GetDetectors().SetProfile(&m_DetectionProfile);
+  if(!m_Tracker.BindDefaultDetectors())
+    return false;
+
+  // A rig can bind features to cheaper backends (lbp, template) instead
+  if(m_Tracker.GetDetectors().Load("FeatureDetectors.txt"))
+    printf("Loaded detector bindings from FeatureDetectors.txt\n");
+
+  return true;
+}
+
+
+bool
+AttentionTracker
+::BindDetector(const char* feature, const char* backend, const char* model)
+{
+  if(!m_Tracker.BindDetector(feature, backend, model))
+    return false;
+
+  // A new detector has no previous result to carry forward
+  m_GateFeature = -1;
+  return true;
+}
+
+
+FeatureDetector*
+AttentionTracker
+::ReplaceDetector(const char* feature, FeatureDetector* detector)
+{
+  // A new detector has no previous result to carry forward
+  m_GateFeature = -1;
+  return m_Tracker.ReplaceDetector(feature, detector);
+}
+
+
+void
+AttentionTracker
+::SetThreshold(int threshold)
+{
+  m_Threshold = threshold;
+  m_AttentionCounter = 0;
+}
+
+
+void
+AttentionTracker
+::SetMaxDetectionWidth(int width)
+{
+  if(width == m_MaxDetectionWidth)
+    return;
+
+  // The last detections are in the old detection image's scale; don't carry them over
+  m_MaxDetectionWidth = width;
+  m_GateFeature = -1;
+  m_Tracker.ForgetLastDetections();
+  m_NumberOfDetections = 0;
+}
+
+
+void
+AttentionTracker
+::SetRequiredHitRate(double hitRate)
+{
+  m_DetectionProfile.SetRequiredHitRate(hitRate);
+  m_Tracker.GetDetectors().ApplyProfile();
+  m_GateFeature = -1;
+}
+
+
+void
+AttentionTracker
+::SetMotionGateEnabled(bool enabled)
+{
+  m_MotionGateEnabled = enabled;
+  m_GateFeature = -1;
+}
+
+
+void
+AttentionTracker
+::SelectDetectionStream(const IplImage* frame)
+{
+  for(size_t s = 0; s < m_Streams.size(); s++)
+  {
+    DetectionStream& stream = m_Streams[s];
+    if(stream.FrameSize.width == frame->width && stream.FrameSize.height == frame->height
+      && stream.Channels == frame->nChannels && stream.Limit == m_DetectionLimit)
+    {
+      m_DetectionColor = stream.Color;
+      m_DetectionGray = stream.Gray;
+      m_DetectionScale = (double)frame->width / stream.Gray->width;
+      m_DetectionWidth = stream.Gray->width;
+      return;
+    }
+  }
+
+  // Derive the detection stream, keeping the aspect ratio
+  DetectionStream stream;
+  stream.FrameSize = cvSize(frame->width, frame->height);
+  stream.Channels = frame->nChannels;
+  stream.Limit = m_DetectionLimit;
+  CvSize size = GetDetectionSize(stream.FrameSize, m_DetectionLimit);
+
+  // Gray frames are shrunk straight into the gray image
+  stream.Color = frame->nChannels > 1 ? ImagePool::Create(m_ImagePool, size, frame->nChannels) : 0;
+  stream.Gray = ImagePool::Create(m_ImagePool, size, 1);
+  m_Streams.push_back(stream);
+
+  m_DetectionColor = stream.Color;
+  m_DetectionGray = stream.Gray;
+  m_DetectionScale = (double)frame->width / size.width;
+  m_DetectionWidth = size.width;
+}
+
+
+void
+AttentionTracker
+::PrepareDetectionImage(const IplImage* frame)
+{
+  this->SelectDetectionStream(frame);
+  this->ShrinkFrame(frame, m_DetectionGray);
+}
+
+
+void
+AttentionTracker
+::ShrinkFrame(const IplImage* frame, IplImage* gray)
+{
+  TraceScope trace("detection image", frame->nChannels);
+  if(frame->nChannels == 1)
+  {
+    if(m_DetectionScale > 1.0)
+      cvResize(frame, gray, CV_INTER_LINEAR);
+    else
+      cvCopy(frame, gray);
+    return;
+  }
+
+  // Shrink first, then convert, so the color conversion only touches detection sized data
+  int conversion = frame->nChannels == 4 ? CV_BGRA2GRAY : CV_BGR2GRAY;
+  if(m_DetectionScale > 1.0)
+  {
+    cvResize(frame, m_DetectionColor, CV_INTER_LINEAR);
+    cvCvtColor(m_DetectionColor, gray, conversion);
+  }
+  else
+    cvCvtColor(frame, gray, conversion);
+}
+
+
+CvSize
+AttentionTracker
+::GetDetectionSize(CvSize frameSize, int width)
+{
+  double scale = 1.0;
+  if(frameSize.width > width)
+    scale = (double)frameSize.width / width;
+  return cvSize(cvRound(frameSize.width / scale), cvRound(frameSize.height / scale));
+}
+
+
+bool
+AttentionTracker
+::Detect(const IplImage* frame)
+{
+  this->PrepareDetectionGray(frame, m_MaxDetectionWidth);
+  return this->DetectGray(m_DetectionGray, cvSize(frame->width, frame->height));
+}
+
+
+const IplImage*
+AttentionTracker
+::PrepareDetectionGray(const IplImage* frame, int width)
+{
+  m_DetectionLimit = width;
+  this->PrepareDetectionImage(frame);
+  return m_DetectionGray;
+}
+
+
+bool
+AttentionTracker
+::DetectGray(IplImage* gray, CvSize frameSize)
+{
+  m_DetectionScale = (double)frameSize.width / gray->width;
+  m_DetectionWidth = gray->width;
+
+  m_Tracker.SetFeature(m_Feature);
+  bool found = m_Tracker.Track(gray);
+  this->MapResults();
+  return found;
+}
+
+
+void
+AttentionTracker
+::DetectBatch(const IplImage* const* frames, int count, const int* features, int numberOfFeatures,
+  std::vector<BatchResult>& results)
+{
+  if(count <= 0)
+  {
+    results.clear();
+    return;
+  }
+
+  // Every frame shares the first one's detection stream, at the full detection width
+  // whatever the current epoch's budget is; ProcessFrame() keeps the epoch's limit
+  int limit = m_DetectionLimit;
+  m_DetectionLimit = m_MaxDetectionWidth;
+  this->SelectDetectionStream(frames[0]);
+  m_DetectionLimit = limit;
+  CvSize size = cvGetSize(m_DetectionGray);
+  if(!m_BatchGray.empty() && (m_BatchGray[0]->width != size.width || m_BatchGray[0]->height != size.height))
+  {
+    for(size_t b = 0; b < m_BatchGray.size(); b++)
+      ImagePool::Free(m_ImagePool, &m_BatchGray[b]);
+    m_BatchGray.clear();
+  }
+  while((int)m_BatchGray.size() < count)
+    m_BatchGray.push_back(ImagePool::Create(m_ImagePool, size, 1));
+
+  // Preprocess the whole batch before any detector runs
+  for(int i = 0; i < count; i++)
+    this->ShrinkFrame(frames[i], m_BatchGray[i]);
+
+  this->DetectGrayBatch(&m_BatchGray[0], count, cvSize(frames[0]->width, frames[0]->height),
+    features, numberOfFeatures, results);
+}
+
+
+void
+AttentionTracker
+::DetectGrayBatch(IplImage* const* grays, int count, CvSize frameSize, const int* features, int numberOfFeatures,
+  std::vector<BatchResult>& results)
+{
+  results.resize(count * numberOfFeatures);
+  if(count <= 0)
+    return;
+
+  TraceScope trace("detection batch", count);
+  m_DetectionScale = (double)frameSize.width / grays[0]->width;
+  m_DetectionWidth = grays[0]->width;
+  m_BatchRects.resize(2 * count);
+
+  // Feature by feature, so one cascade at a time sweeps all the frames
+  for(int f = 0; f < numberOfFeatures; f++)
+  {
+    m_Tracker.SetFeature(features[f]);
+    m_Tracker.TrackBatch(grays, count, &m_BatchRects[0]);
+
+    int used = m_Tracker.GetNumberOfResults();
+    for(int i = 0; i < count; i++)
+    {
+      BatchResult& result = results[i * numberOfFeatures + f];
+      result.NumberOfDetections = used;
+      result.Found = true;
+      for(int r = 0; r < used; r++)
+      {
+        result.Detections[r] = this->MapDetectionToFull(m_BatchRects[2 * i + r]);
+        result.Found &= result.Detections[r].width > 0;
+      }
+    }
+  }
+
+  // Like Detect(), leave the last frame's detections behind. They may be at another
+  // scale than the epoch's stream, so the gate doesn't carry them.
+  this->MapResults();
+  m_GateFeature = -1;
+}
+
+
+bool
+AttentionTracker
+::ProcessFrame(const IplImage* frame, double time)
+{
+  // The epoch decides how often and at what resolution to detect; frames
+  // in between reuse the last result without even shrinking the image
+  m_CarryDetection = this->ApplyEpochBudget();
+
+  if(!m_CarryDetection)
+  {
+    // Everything below works on the low resolution detection stream
+    this->PrepareDetectionImage(frame);
+
+    // Decide whether this frame needs a detection pass or can reuse the last result
+    if(m_MotionGateEnabled)
+    {
+      m_MotionGate.Update(m_DetectionGray);
+      m_CarryDetection = !this->DetectionRequired();
+    }
+  }
+  else
+    this->SelectDetectionStream(frame);
+
+  // Track the selected feature with whichever detectors are bound to it
+  m_Tracker.SetFeature(m_Feature);
+  bool found = m_CarryDetection ? m_Tracker.Carry() : m_Tracker.Track(m_DetectionGray);
+  this->MapResults();
+
+  // A fresh detection becomes the new reference for the motion gate
+  if(m_CarryDetection)
+    m_FramesSinceDetection++;
+  else
+  {
+    m_MotionGate.SetReference();
+    m_FramesSinceDetection = 0;
+    m_GateFeature = m_Feature;
+  }
+
+  this->AddDecision(found ? 1 : 0, time);
+  return found;
+}
+
+
+void
+AttentionTracker
+::AddDecision(int detect, double time)
+{
+  if(detect == 1)
+  {
+    if(m_AttentionCounter < m_Threshold)
+      m_AttentionCounter++;
+  }
+  else if(m_AttentionCounter > 0)
+    m_AttentionCounter--;
+
+  // Force a fresh detection once tracking is switched back on
+  int feature = m_Feature;
+  if(detect < 0)
+  {
+    m_GateFeature = -1;
+    m_NumberOfDetections = 0;
+    feature = -1;
+  }
+
+  // Keep the trial aggregates current
+  m_Statistics.AddFrame(time, m_Epoch, feature, detect);
+}
+
+
+int
+AttentionTracker
+::AdvanceEpoch(int epoch, double time)
+{
+  if(epoch < 0 || epoch >= NUM_EPOCHS)
+  {
+    printf("Error, invalid number for next Epoch (%i)\n", epoch);
+    return -1;
+  }
+
+  m_Epoch = epoch;
+  int outcome = -1;
+
+  // Entering Intertrial closes the trial; judge it on the counter
+  if(m_Epoch == 0)
+  {
+    bool success = ((double)m_AttentionCounter) / ((double)m_Threshold) > 0.5;
+    if(success) m_SuccessfulTrials++;
+    else m_FailedTrials++;
+    outcome = success ? 1 : 0;
+
+    m_LastTrial = m_Statistics.EndTrial(time, success);
+    m_Trial++;
+    m_Statistics.StartTrial(m_Trial, time);
+  }
+  m_Statistics.EnterEpoch(m_Epoch, time);
+  return outcome;
+}
+
+
+bool
+AttentionTracker
+::ApplyEpochBudget()
+{
+  const EpochBudget& budget = m_EpochPolicy.Get(m_Epoch);
+
+  // Switch the detection stream to the epoch's resolution. Old results are in the old
+  // coordinates, so neither the gate nor the eye search may start from them.
+  int limit = m_MaxDetectionWidth;
+  if(budget.DetectionWidth > 0 && budget.DetectionWidth < limit)
+    limit = budget.DetectionWidth;
+  if(limit != m_DetectionLimit)
+  {
+    m_DetectionLimit = limit;
+    m_GateFeature = -1;
+    m_Tracker.ForgetLastDetections();
+    m_NumberOfDetections = 0;
+  }
+  m_FrameInterval = budget.FrameInterval;
+
+  // Between budgeted frames the last result is reused
+  return m_GateFeature == m_Feature && m_FramesSinceDetection + 1 < budget.FrameInterval;
+}
+
+
+bool
+AttentionTracker
+::DetectionRequired()
+{
+  // A new feature or a stale reference always gets a full pass
+  const std::map<FeatureDetector*, CvRect>& lastDetections = m_Tracker.GetLastDetections();
+  if(m_GateFeature != m_Feature)
+  {
+    m_Tracker.ForgetLastDetections();
+    return true;
+  }
+  if(m_FramesSinceDetection >= m_GateTimeoutFrames || lastDetections.empty())
+    return true;
+
+  // Watch the union of the last boxes; if anything was missed, watch the whole frame
+  CvRect region = cvRect(0, 0, 0, 0);
+  std::map<FeatureDetector*, CvRect>::const_iterator it;
+  for(it = lastDetections.begin(); it != lastDetections.end(); ++it)
+  {
+    CvRect r = it->second;
+    if(r.width <= 0)
+    {
+      region = cvRect(0, 0, 0, 0);
+      break;
+    }
+    if(region.width == 0)
+      region = r;
+    else
+    {
+      int x1 = std::max(region.x + region.width, r.x + r.width);
+      int y1 = std::max(region.y + region.height, r.y + r.height);
+      region.x = std::min(region.x, r.x);
+      region.y = std::min(region.y, r.y);
+      region.width = x1 - region.x;
+      region.height = y1 - region.y;
+    }
+  }
+
+  return m_MotionGate.HasMotion(region);
+}
+
+
+void
+AttentionTracker
+::MapResults()
+{
+  m_NumberOfDetections = m_Tracker.GetNumberOfResults();
+  for(int r = 0; r < m_NumberOfDetections; r++)
+    m_Detections[r] = this->MapDetectionToFull(m_Tracker.GetResult(r));
+}
+
+
+CvRect
+AttentionTracker
+::MapDetectionToFull(CvRect rect) const
+{
+  // Misses are passed through unchanged
+  if(rect.width <= 0 || m_DetectionScale == 1.0)
+    return rect;
+
+  return cvRect(cvRound(rect.x * m_DetectionScale), cvRound(rect.y * m_DetectionScale),
+    cvRound(rect.width * m_DetectionScale), cvRound(rect.height * m_DetectionScale));
+}
+
+
+CvRect
+AttentionTracker
+::MapFullToDetection(CvRect rect) const
+{
+  if(rect.width <= 0 || m_DetectionScale == 1.0)
+    return rect;
+
+  return cvRect(cvRound(rect.x / m_DetectionScale), cvRound(rect.y / m_DetectionScale),
+    cvRound(rect.width / m_DetectionScale), cvRound(rect.height / m_DetectionScale));
+}
@@ -0,0 +1,264 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _AttentionTracker_h
+#define _AttentionTracker_h
+
+#include <vector>
+
+#include <cv.h>
+
+#include "AttentionStatistics.h"
+#include "DetectionProfile.h"
+#include "EpochPolicy.h"
+#include "FeatureTracker.h"
+#include "MotionGate.h"
+
+class ImagePool;
+
+/** Everything between a captured frame and the attention decision, without the camera,
+display or log: shrinking the frame into the gray detection stream, the epoch budget,
+the motion gate, detection and tracking of the selected feature, the attention counter
+and the trial outcomes. FinalProjectApp, the batch tools and the C API in
+AttentionTrackerAPI.h all run this class, so they decide exactly alike. It has no Qt
+dependency. Not thread safe: use one tracker per thread. */
+class AttentionTracker
+{
+public:
+
+  /** Constructor */
+  AttentionTracker();
+
+  /** Destructor */
+  ~AttentionTracker();
+
+  /** Load DetectionProfile.txt, the stock cascades, FeatureDetectors.txt and EpochPolicy.txt
+  from the working directory, as the app does; returns false if a stock cascade is missing */
+  bool Initialize();
+
+  /** Bind a feature to a backend and model; see FeatureDetectorRegistry::Bind() */
+  bool BindDetector(const char* feature, const char* backend, const char* model);
+
+  /** Bind a detector loaded elsewhere, e.g. on a loader thread, between frames. Returns
+  the detector it replaces, or 0; nothing uses that one any more, so the caller deletes it. */
+  FeatureDetector* ReplaceDetector(const char* feature, FeatureDetector* detector);
+
+  /** The feature tracker, its detectors and the detection budgets */
+  FeatureTracker& GetTracker() { return m_Tracker; }
+  EpochPolicy& GetEpochPolicy() { return m_EpochPolicy; }
+
+  /** Feature to track, as numbered in FeatureTracker::Feature */
+  void SetFeature(int feature) { m_Feature = feature; }
+  int GetFeature() const { return m_Feature; }
+
+  /** Upper limit of the attention counter; changing it restarts the counter */
+  void SetThreshold(int threshold);
+  int GetThreshold() const { return m_Threshold; }
+
+  /** Frames wider than this are shrunk before detection; changing it drops the last detections */
+  void SetMaxDetectionWidth(int width);
+  int GetMaxDetectionWidth() const { return m_MaxDetectionWidth; }
+
+  /** Skip the detection pass on frames where nothing moved near the last detection */
+  void SetMotionGateEnabled(bool enabled);
+
+  /** Borrow the detection images, the motion gate's thumbnails and the detectors' scratch
+  images from this pool; 0 allocates them plainly. Images held so far are given back, so
+  call it between frames. The pool must outlive the tracker or be unset first. */
+  void SetImagePool(ImagePool* pool);
+
+  /** Smallest hit rate the detection profile settings must reach; the fastest setting that
+  does is used, and with 0 (default) the most accurate. Updates the bound detectors in
+  place, so call it from the detection thread while no detector loads are pending. */
+  void SetRequiredHitRate(double hitRate);
+
+  /** Shrink a frame (8 bit gray, BGR or BGRA, any size) and search it for the feature,
+  without budget, motion gate or attention accounting. The frame is only read. */
+  bool Detect(const IplImage* frame);
+
+  /** The two halves of Detect(), for callers that keep the gray detection images, e.g. in
+  a preprocessing cache. PrepareDetectionGray() shrinks a frame to at most width pixels
+  and converts it; the image is the tracker's and is overwritten by the next call.
+  DetectGray() searches such an image of a frame of the given size. */
+  const IplImage* PrepareDetectionGray(const IplImage* frame, int width);
+  bool DetectGray(IplImage* gray, CvSize frameSize);
+
+  /** Size of the detection image for a frame of this size and a width limit */
+  static CvSize GetDetectionSize(CvSize frameSize, int width);
+
+  /** What DetectBatch() found on one frame for one feature: whether it was found and
+  its rectangles in frame coordinates, as GetDetections() gives them after Detect() */
+  struct BatchResult
+  {
+    bool Found;
+    int NumberOfDetections;
+    CvRect Detections[2];
+  };
+
+  /** Detect() for a batch of frames of one size and layout, and for several features at
+  once. All frames are shrunk first, into images kept for the next batch; then each
+  detector sweeps the whole batch before the next one runs, so its cascade stays in
+  cache rather than being evicted by preprocessing and the other features' cascades.
+  results gets count * numberOfFeatures entries, results[frame * numberOfFeatures + f],
+  the same as running Detect() over the frames in order for each feature on its own. */
+  void DetectBatch(const IplImage* const* frames, int count, const int* features, int numberOfFeatures,
+    std::vector<BatchResult>& results);
+
+  /** DetectBatch() on gray detection images of frames of the given size, e.g. from a
+  preprocessing cache; the images' ROIs must not be set */
+  void DetectGrayBatch(IplImage* const* grays, int count, CvSize frameSize, const int* features, int numberOfFeatures,
+    std::vector<BatchResult>& results);
+
+  /** The full per-frame decision: apply the epoch budget and the motion gate, detect
+  or reuse the last result, and update the attention counter and trial statistics.
+  time is in seconds on the caller's clock. Returns true if the feature was found. */
+  bool ProcessFrame(const IplImage* frame, double time);
+
+  /** Account for one frame decided elsewhere: detect is 1 or 0, or -1 when tracking is off */
+  void AddDecision(int detect, double time);
+
+  /** Move to the next trial epoch (0 = Intertrial, 1 = Button Press, 2 = Reach). Entering
+  Intertrial ends the trial; returns 1 if it was successful, 0 if it failed, -1 if no trial
+  ended or the epoch is invalid. */
+  int AdvanceEpoch(int epoch, double time);
+
+  /** Rectangles found on the last frame, in frame coordinates; a rectangle without width
+  was not found. The array stays valid until the next frame. */
+  int GetNumberOfDetections() const { return m_NumberOfDetections; }
+  const CvRect* GetDetections() const { return m_Detections; }
+
+  /** How the last frame was handled, for the frame log */
+  bool GetCarried() const { return m_CarryDetection; }
+  int GetFrameInterval() const { return m_FrameInterval; }
+  int GetDetectionWidth() const { return m_DetectionWidth; }
+
+  /** Map a rectangle between detection image and frame coordinates */
+  CvRect MapDetectionToFull(CvRect rect) const;
+  CvRect MapFullToDetection(CvRect rect) const;
+
+  /** Attention counter, between 0 and the threshold */
+  int GetAttention() const { return m_AttentionCounter; }
+
+  int GetEpoch() const { return m_Epoch; }
+  int GetTrial() const { return m_Trial; }
+  int GetSuccessfulTrials() const { return m_SuccessfulTrials; }
+  int GetFailedTrials() const { return m_FailedTrials; }
+
+  /** Aggregates of the current trial */
+  const AttentionStatistics& GetStatistics() const { return m_Statistics; }
+
+  /** Summary of the trial AdvanceEpoch() ended last */
+  const TrialSummary& GetLastTrial() const { return m_LastTrial; }
+
+protected:
+
+  /** Detection images of one frame geometry and detection width */
+  struct DetectionStream
+  {
+    CvSize FrameSize;
+    int Channels;
+    int Limit;
+    IplImage* Color;
+    IplImage* Gray;
+  };
+
+  /** Point m_DetectionColor/Gray at the stream for this frame and the current width limit.
+  Streams are kept once made, so epochs switching widths don't allocate. */
+  void SelectDetectionStream(const IplImage* frame);
+
+  /** Shrink the frame into the gray detection image */
+  void PrepareDetectionImage(const IplImage* frame);
+
+  /** Shrink a frame of the current stream's geometry into gray */
+  void ShrinkFrame(const IplImage* frame, IplImage* gray);
+
+  /** Apply the current epoch's detection budget; returns true if this frame falls
+  between budgeted detections and should reuse the last result */
+  bool ApplyEpochBudget();
+
+  /** Ask the motion gate whether this frame needs a full detection or can reuse the last result */
+  bool DetectionRequired();
+
+  /** Copy the tracker's results to m_Detections in frame coordinates */
+  void MapResults();
+
+  FeatureTracker m_Tracker;
+
+  /** Detection settings per model file, from DetectionProfile.txt when present */
+  DetectionProfile m_DetectionProfile;
+
+  /** Detection effort per trial epoch */
+  EpochPolicy m_EpochPolicy;
+
+  /** Detection streams and the one in use */
+  std::vector<DetectionStream> m_Streams;
+  IplImage* m_DetectionColor;
+  IplImage* m_DetectionGray;
+
+  /** Detection images of the last batch, and its rectangles in detection image coordinates */
+  std::vector<IplImage*> m_BatchGray;
+  std::vector<CvRect> m_BatchRects;
+
+  /** Where the detection images come from, or 0 */
+  ImagePool* m_ImagePool;
+
+  /** Give back the detection streams and batch images */
+  void ReleaseDetectionImages();
+
+  /** Width cap on the detection image; the epoch budget can lower the limit in force below it */
+  int m_MaxDetectionWidth;
+  int m_DetectionLimit;
+  int m_DetectionWidth;
+
+  /** Frame pixels per detection image pixel */
+  double m_DetectionScale;
+
+  /** Budget interval of the last frame */
+  int m_FrameInterval;
+
+  /** Motion gate used to carry detections forward over static frames */
+  MotionGate m_MotionGate;
+  bool m_MotionGateEnabled;
+
+  /** Force a full detection after this many carried frames, even without motion */
+  int m_GateTimeoutFrames;
+  int m_FramesSinceDetection;
+
+  /** Feature the last full detection ran for; -1 forces a new detection */
+  int m_GateFeature;
+
+  /** True while the current frame reuses the previous detection results */
+  bool m_CarryDetection;
+
+  int m_Feature;
+
+  /** Results of the last frame in frame coordinates */
+  int m_NumberOfDetections;
+  CvRect m_Detections[2];
+
+  /** Counts up on frames with a detection and down on frames without, within 0..m_Threshold */
+  int m_AttentionCounter;
+  int m_Threshold;
+
+  int m_Epoch;
+  int m_Trial;
+  int m_SuccessfulTrials;
+  int m_FailedTrials;
+
+  /** Live per-trial attention aggregates */
+  AttentionStatistics m_Statistics;
+  TrialSummary m_LastTrial;
+};
+
+#endif
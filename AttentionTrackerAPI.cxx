@@ -0,0 +1,153 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "AttentionTrackerAPI.h"
+
+#include <new>
+
+#include "AttentionTracker.h"
+
+// The handle is the tracker plus an image header reused to wrap the caller's frames
+struct atTracker
+{
+  AttentionTracker Tracker;
+  IplImage Header;
+};
+
+// atRect is handed out as a view of the tracker's CvRect array
+typedef char atRectMatchesCvRect[sizeof(atRect) == sizeof(CvRect) ? 1 : -1];
+
+
+int atGetVersion(void)
+{
+  return AT_API_VERSION;
+}
+
+
+atTracker* atCreateTracker(void)
+{
+  atTracker* tracker = new(std::nothrow) atTracker;
+  if(tracker == 0)
+    return 0;
+
+  if(!tracker->Tracker.Initialize())
+  {
+    delete tracker;
+    return 0;
+  }
+  return tracker;
+}
+
+
+void atReleaseTracker(atTracker** tracker)
+{
+  if(tracker == 0)
+    return;
+  delete *tracker;
+  *tracker = 0;
+}
+
+
+int atBindDetector(atTracker* tracker, const char* feature, const char* backend, const char* model)
+{
+  if(tracker == 0 || feature == 0 || backend == 0 || model == 0)
+    return -1;
+  return tracker->Tracker.BindDetector(feature, backend, model) ? 0 : -1;
+}
+
+
+int atSetFeature(atTracker* tracker, int feature)
+{
+  if(tracker == 0 || feature < AT_FEATURE_EYE_PAIR_BIG || feature > AT_FEATURE_NOSE)
+    return -1;
+  tracker->Tracker.SetFeature(feature);
+  return 0;
+}
+
+
+int atSetThreshold(atTracker* tracker, int threshold)
+{
+  if(tracker == 0 || threshold < 1)
+    return -1;
+  tracker->Tracker.SetThreshold(threshold);
+  return 0;
+}
+
+
+int atSetMaxDetectionWidth(atTracker* tracker, int width)
+{
+  if(tracker == 0 || width < 1)
+    return -1;
+  tracker->Tracker.SetMaxDetectionWidth(width);
+  return 0;
+}
+
+
+int atSetMotionGate(atTracker* tracker, int enabled)
+{
+  if(tracker == 0)
+    return -1;
+  tracker->Tracker.SetMotionGateEnabled(enabled != 0);
+  return 0;
+}
+
+
+int atProcessFrame(atTracker* tracker, const atFrame* frame, double time,
+  const atRect** detections, int* count)
+{
+  if(tracker == 0 || frame == 0 || frame->data == 0 || frame->width < 1 || frame->height < 1
+    || (frame->channels != 1 && frame->channels != 3 && frame->channels != 4)
+    || frame->step < frame->width * frame->channels)
+    return -1;
+
+  // Point the header at the caller's pixels; nothing is copied. The tracker only reads them.
+  IplImage* header = &tracker->Header;
+  cvInitImageHeader(header, cvSize(frame->width, frame->height), IPL_DEPTH_8U, frame->channels);
+  cvSetData(header, (void*)frame->data, frame->step);
+
+  bool found = tracker->Tracker.ProcessFrame(header, time);
+
+  if(detections)
+    *detections = (const atRect*)tracker->Tracker.GetDetections();
+  if(count)
+    *count = tracker->Tracker.GetNumberOfDetections();
+  return found ? 1 : 0;
+}
+
+
+int atAdvanceEpoch(atTracker* tracker, int epoch, double time)
+{
+  if(tracker == 0 || epoch < AT_EPOCH_INTERTRIAL || epoch > AT_EPOCH_REACH)
+    return -1;
+  int outcome = tracker->Tracker.AdvanceEpoch(epoch, time);
+  return outcome < 0 ? 2 : outcome;
+}
+
+
+int atGetAttention(const atTracker* tracker)
+{
+  if(tracker == 0)
+    return -1;
+  return tracker->Tracker.GetAttention();
+}
+
+
+int atGetTrialCounts(const atTracker* tracker, int* successful, int* failed)
+{
+  if(tracker == 0)
+    return -1;
+  if(successful) *successful = tracker->Tracker.GetSuccessfulTrials();
+  if(failed) *failed = tracker->Tracker.GetFailedTrials();
+  return 0;
+}
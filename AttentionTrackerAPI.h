@@ -0,0 +1,121 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _AttentionTrackerAPI_h
+#define _AttentionTrackerAPI_h
+
+/* C interface to the attention tracker, for programs such as the task controller that
+want the attention decision in process. The caller owns the frame memory: frames are
+read in place, never copied, and detections are returned as a pointer into the
+tracker, valid until the next frame. Each tracker must be used from one thread at a
+time. Functions returning int return a negative value on error.
+
+  atTracker* tracker = atCreateTracker();
+  atSetFeature(tracker, AT_FEATURE_FRONTAL_FACE);
+  for each frame:
+    atFrame frame = { pixels, width, height, bytesPerRow, 3 };
+    const atRect* found; int count;
+    atProcessFrame(tracker, &frame, seconds, &found, &count);
+  on each epoch change from the task:
+    atAdvanceEpoch(tracker, epoch, seconds);
+  atReleaseTracker(&tracker);
+
+New functions may be added; existing ones keep their signature and meaning. */
+
+#if defined(_WIN32) && defined(AttentionTracking_EXPORTS)
+#  define AT_API __declspec(dllexport)
+#else
+#  define AT_API
+#endif
+
+#define AT_API_VERSION 1
+
+/* Features, numbered as in the frame log */
+#define AT_FEATURE_EYE_PAIR_BIG 1
+#define AT_FEATURE_EYE_PAIR_SMALL 2
+#define AT_FEATURE_FRONTAL_FACE 3
+#define AT_FEATURE_LEFT_RIGHT_EYE 4
+#define AT_FEATURE_MOUTH 5
+#define AT_FEATURE_NOSE 6
+
+/* Trial epochs */
+#define AT_EPOCH_INTERTRIAL 0
+#define AT_EPOCH_BUTTON_PRESS 1
+#define AT_EPOCH_REACH 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct atTracker atTracker;
+
+/* A caller-owned 8 bit image: gray (1 channel), BGR (3) or BGRA (4), rows step bytes apart */
+typedef struct atFrame
+{
+  const unsigned char* data;
+  int width;
+  int height;
+  int step;
+  int channels;
+} atFrame;
+
+/* Detection rectangle in frame pixels; a width of 0 or less means not found */
+typedef struct atRect
+{
+  int x;
+  int y;
+  int width;
+  int height;
+} atRect;
+
+/* AT_API_VERSION of the library actually linked */
+AT_API int atGetVersion(void);
+
+/* Create a tracker with the stock cascades and any DetectionProfile.txt, FeatureDetectors.txt
+and EpochPolicy.txt in the working directory; 0 if a stock cascade can't be loaded */
+AT_API atTracker* atCreateTracker(void);
+
+/* Destroy a tracker and set the pointer to 0 */
+AT_API void atReleaseTracker(atTracker** tracker);
+
+/* Bind a feature ("FrontalFace", "LeftEye", ...) to a backend ("haar", "lbp", "template")
+and model file; the old binding stays if the new one can't be loaded */
+AT_API int atBindDetector(atTracker* tracker, const char* feature, const char* backend, const char* model);
+
+/* Settings: the feature to track, the attention counter limit (restarts the counter), the
+widest detection image, and whether static frames may reuse the last detection */
+AT_API int atSetFeature(atTracker* tracker, int feature);
+AT_API int atSetThreshold(atTracker* tracker, int threshold);
+AT_API int atSetMaxDetectionWidth(atTracker* tracker, int width);
+AT_API int atSetMotionGate(atTracker* tracker, int enabled);
+
+/* Decide one frame; time is in seconds on the caller's clock. Returns 1 if the feature
+was found, 0 if not. detections and count may be 0 if not wanted. */
+AT_API int atProcessFrame(atTracker* tracker, const atFrame* frame, double time,
+  const atRect** detections, int* count);
+
+/* Move to the next trial epoch; returns 1 or 0 if this ended a successful or failed trial, 2 otherwise */
+AT_API int atAdvanceEpoch(atTracker* tracker, int epoch, double time);
+
+/* Attention counter, between 0 and the threshold */
+AT_API int atGetAttention(const atTracker* tracker);
+
+/* Trials ended so far */
+AT_API int atGetTrialCounts(const atTracker* tracker, int* successful, int* failed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,679 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <cv.h>
+#include <highgui.h>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+
+#include "AttentionTracker.h"
+#include "PreprocessCache.h"
+#include "WorkStealingPool.h"
+
+// Reruns detection over a directory of recorded sessions, e.g. after the detection
+// settings changed, using every core of the machine:
+//
+//   BatchReprocess <session dir> [-o Reprocessed] [-threads n] [-chunk frames]
+//                  [-feature n | -features n,n,...] [-threshold n] [-width pixels]
+//                  [-cache dir] [-cachewidth pixels] [-levels n] [-batch frames] [-compare]
+//
+// Every <name>.avi is paired with the frame log it was recorded with, <name>.csv
+// ("Log File.csv" for "Session Video.avi"), which supplies the time, trial and epoch
+// of each frame. Videos are cut into chunks of frames; the chunks are dealt out so
+// each thread reads long runs of consecutive frames, and threads that finish early
+// steal chunks from the others. Detection itself has no state across frames here
+// (the motion gate and epoch budget are real-time savings and stay off), so the chunks
+// are simply stitched back in order; the attention counter and trial summaries, which
+// do carry state, are then recomputed in one sequential pass per video. Both halves
+// run the app's AttentionTracker, so the results match what the app would decide.
+//
+// For every video, <name>.csv and <name> Trial Summary.csv are written to the output directory.
+//
+// With -cache, the gray detection images of every frame are kept in <dir>/<name>.w<cachewidth>.cache
+// at -levels detection widths, halving from -cachewidth (default -width, 3 levels). A later run
+// whose -width is one of those widths detects straight from the cache, skipping decoding and
+// conversion, as long as the video hasn't changed; any other run fills in missing frames.
+//
+// -features detects several features on every frame, e.g. -features 1,3,5; the first one
+// decides attention and is written to the log, as -feature does on its own.
+//
+// Frames are detected in batches of -batch frames (default 16): a batch is shrunk first and
+// then each feature's cascade sweeps all of it before the next cascade runs, so one cascade
+// at a time is in cache. -batch 1 detects frame by frame as the app does, running every
+// feature's cascade on a frame before going on to the next frame. With a single feature
+// both do the same work, so the difference only shows with -features. -compare reruns the
+// chunks both ways, times shrinking and detecting on each side, and checks that they
+// decided every frame alike for every feature. Left/right eye mode searches where the
+// eyes were on the last frame it saw, which the other features' passes make it forget
+// frame by frame but not within a batch, so alongside other features it may differ.
+
+/** One recorded session */
+struct Session
+{
+  std::string Name;
+  std::string Video;
+  std::string Log;
+  int Frames;
+  double FramesPerSecond;
+  CvSize FrameSize;
+  std::vector<int> Chunks;
+
+  /** Preprocessed frames; 0 when not caching */
+  PreprocessCache* Cache;
+};
+
+/** A range of frames of one video, and the detection results for it: the first
+feature's per frame, and every other feature's, frame after frame */
+struct Chunk
+{
+  int Session;
+  int Begin;
+  int End;
+  std::vector<signed char> Detect;
+  std::vector<signed char> OtherFeatures;
+};
+
+/** What a worker keeps between chunks: its tracker, which holds the detection buffers, and the open video */
+struct WorkerState
+{
+  AttentionTracker* Tracker;
+  CvCapture* Capture;
+  int Session;
+  int NextFrame;
+
+  /** The part of the preprocessing cache the current chunk covers */
+  PreprocessCache::Range* Cached;
+
+  /** Detection images waiting for the batch to fill: headers into the cache, or copies */
+  std::vector<IplImage*> Pending;
+  std::vector<IplImage> Headers;
+  std::vector<IplImage*> Copies;
+  std::vector<AttentionTracker::BatchResult> Results;
+
+  /** Time spent shrinking and detecting, without decoding or filling the cache */
+  double DetectSeconds;
+};
+
+/** One frame row of a session log */
+struct LogRow
+{
+  double Time;
+  int Trial;
+  int Epoch;
+};
+
+
+class ReprocessJob : public WorkStealingPool::Job
+{
+public:
+  ReprocessJob(std::vector<Session>& sessions, std::vector<Chunk>& chunks,
+    std::vector<WorkerState>& workers, const std::vector<int>& features, int maxWidth, int batchSize)
+    : m_Sessions(sessions), m_Chunks(chunks), m_Workers(workers), m_Features(features),
+      m_MaxWidth(maxWidth), m_BatchSize(std::max(batchSize, 1)) {}
+
+  virtual void Run(int task, int worker)
+  {
+    Chunk& chunk = m_Chunks[task];
+    WorkerState& state = m_Workers[worker];
+    Session& session = m_Sessions[chunk.Session];
+    if((int)state.Headers.size() < m_BatchSize)
+      state.Headers.resize(m_BatchSize);
+
+    // Frames already in the cache at the detection width need neither decoding nor conversion
+    PreprocessCache* cache = session.Cache;
+    int level = cache ? cache->FindLevel(m_MaxWidth) : -1;
+    bool cached = cache && state.Cached->Map(*cache, chunk.Begin, chunk.End);
+    if(cached && level >= 0 && state.Cached->GetEnd() == chunk.End && cache->HasFrames(chunk.Begin, chunk.End))
+    {
+      double start = (double)cvGetTickCount();
+      for(int f = chunk.Begin; f < chunk.End; f++)
+      {
+        IplImage* gray = &state.Headers[state.Pending.size()];
+        state.Cached->GetLevel(f, level, gray);
+        this->DetectGray(state, chunk, session, gray, false);
+      }
+      this->FlushBatch(state, chunk, session);
+      AddSeconds(state, start);
+      state.Cached->Unmap();
+      m_FramesDone.fetchAndAddRelaxed((int)chunk.Detect.size());
+      m_FramesFromCache.fetchAndAddRelaxed((int)chunk.Detect.size());
+      return;
+    }
+
+    // Keep reading if this chunk continues where the last one stopped; seek otherwise.
+    // The recorder writes MJPG, where every frame is a key frame, so seeking is exact.
+    if(state.Capture == 0 || state.Session != chunk.Session || state.NextFrame != chunk.Begin)
+    {
+      if(state.Capture) cvReleaseCapture(&state.Capture);
+      state.Capture = cvCreateFileCapture(m_Sessions[chunk.Session].Video.c_str());
+      if(state.Capture == 0)
+      {
+        printf("Couldnt open video '%s'\n", m_Sessions[chunk.Session].Video.c_str());
+        return;
+      }
+      if(chunk.Begin > 0)
+        cvSetCaptureProperty(state.Capture, CV_CAP_PROP_POS_FRAMES, chunk.Begin);
+      state.Session = chunk.Session;
+    }
+
+    for(int f = chunk.Begin; f < chunk.End; f++)
+    {
+      IplImage* frame = cvQueryFrame(state.Capture);
+      if(frame == 0)
+        break;
+
+      // Fill the cache on the way; the video may be longer than it said
+      if(cached && f < state.Cached->GetEnd() && frame->width == session.FrameSize.width
+        && frame->height == session.FrameSize.height)
+      {
+        for(int l = 0; l < cache->GetNumberOfLevels(); l++)
+          state.Cached->StoreLevel(f, l, state.Tracker->PrepareDetectionGray(frame, cache->GetLevelWidth(l)));
+        cache->MarkFrame(f);
+        m_FramesCached.fetchAndAddRelaxed(1);
+
+        if(level >= 0)
+        {
+          double start = (double)cvGetTickCount();
+          IplImage* gray = &state.Headers[state.Pending.size()];
+          state.Cached->GetLevel(f, level, gray);
+          this->DetectGray(state, chunk, session, gray, false);
+          AddSeconds(state, start);
+          continue;
+        }
+      }
+
+      // The tracker's detection image is overwritten by the next frame
+      double start = (double)cvGetTickCount();
+      const IplImage* gray = state.Tracker->PrepareDetectionGray(frame, m_MaxWidth);
+      this->DetectGray(state, chunk, session, (IplImage*)gray, true);
+      AddSeconds(state, start);
+    }
+    double start = (double)cvGetTickCount();
+    this->FlushBatch(state, chunk, session);
+    AddSeconds(state, start);
+    if(cached)
+      state.Cached->Unmap();
+    state.NextFrame = chunk.Begin + (int)chunk.Detect.size();
+    m_FramesDone.fetchAndAddRelaxed((int)chunk.Detect.size());
+  }
+
+  /** Detect every feature on a gray detection image now when not batching, or queue it
+  and detect on the batch once it is full. Queued images must stay valid until
+  FlushBatch(), so those the tracker will overwrite are copied. */
+  void DetectGray(WorkerState& state, Chunk& chunk, const Session& session, IplImage* gray, bool overwritten)
+  {
+    if(m_BatchSize == 1)
+    {
+      for(size_t f = 0; f < m_Features.size(); f++)
+      {
+        state.Tracker->SetFeature(m_Features[f]);
+        signed char found = state.Tracker->DetectGray(gray, session.FrameSize) ? 1 : 0;
+        if(f == 0)
+          chunk.Detect.push_back(found);
+        else
+          chunk.OtherFeatures.push_back(found);
+      }
+      return;
+    }
+
+    if(overwritten)
+    {
+      size_t slot = state.Pending.size();
+      if(state.Copies.size() <= slot)
+        state.Copies.resize(slot + 1, 0);
+      IplImage*& copy = state.Copies[slot];
+      if(copy && (copy->width != gray->width || copy->height != gray->height))
+        cvReleaseImage(&copy);
+      if(copy == 0)
+        copy = cvCreateImage(cvGetSize(gray), IPL_DEPTH_8U, 1);
+      cvCopy(gray, copy);
+      gray = copy;
+    }
+    state.Pending.push_back(gray);
+    if((int)state.Pending.size() == m_BatchSize)
+      this->FlushBatch(state, chunk, session);
+  }
+
+  /** Detect on the queued images */
+  void FlushBatch(WorkerState& state, Chunk& chunk, const Session& session)
+  {
+    if(state.Pending.empty())
+      return;
+
+    int numberOfFeatures = (int)m_Features.size();
+    state.Tracker->DetectGrayBatch(&state.Pending[0], (int)state.Pending.size(), session.FrameSize,
+      &m_Features[0], numberOfFeatures, state.Results);
+
+    for(size_t i = 0; i < state.Results.size(); i++)
+    {
+      signed char found = state.Results[i].Found ? 1 : 0;
+      if(i % numberOfFeatures == 0)
+        chunk.Detect.push_back(found);
+      else
+        chunk.OtherFeatures.push_back(found);
+    }
+    state.Pending.clear();
+  }
+
+  /** Both paths are timed the same way: from the decoded frame to its decision */
+  static void AddSeconds(WorkerState& state, double start)
+  {
+    state.DetectSeconds += ((double)cvGetTickCount() - start) / (cvGetTickFrequency() * 1000000.0);
+  }
+
+  int GetFramesDone() { return m_FramesDone.fetchAndAddOrdered(0); }
+  int GetFramesFromCache() { return m_FramesFromCache.fetchAndAddOrdered(0); }
+  int GetFramesCached() { return m_FramesCached.fetchAndAddOrdered(0); }
+
+protected:
+
+  std::vector<Session>& m_Sessions;
+  std::vector<Chunk>& m_Chunks;
+  std::vector<WorkerState>& m_Workers;
+  std::vector<int> m_Features;
+  int m_MaxWidth;
+  int m_BatchSize;
+  QAtomicInt m_FramesDone;
+  QAtomicInt m_FramesFromCache;
+  QAtomicInt m_FramesCached;
+};
+
+
+/** Read time, trial and epoch of every frame row of a session log */
+static std::vector<LogRow> ReadLog(const std::string& filename)
+{
+  std::vector<LogRow> rows;
+  FILE* file = fopen(filename.c_str(), "r");
+  if(file == 0)
+    return rows;
+
+  // The header and the legend at the end don't parse as frame rows
+  char line[1024];
+  while(fgets(line, sizeof(line), file))
+  {
+    LogRow row;
+    int feature, detect;
+    if(sscanf(line, "%lf,%d,%d,%d,%d", &row.Time, &row.Trial, &feature, &detect, &row.Epoch) == 5)
+      rows.push_back(row);
+  }
+  fclose(file);
+  return rows;
+}
+
+
+/** Join a video's chunks into its log and recompute the attention counter and trial summaries in frame order */
+static int StitchSession(const Session& session, const std::vector<Chunk>& chunks, const std::string& outputDir,
+  int feature, int threshold)
+{
+  std::vector<LogRow> rows = ReadLog(session.Log);
+  if(rows.empty())
+    printf("%s: no frame log, writing trial 0, epoch 0\n", session.Name.c_str());
+
+  std::string logName = outputDir + "/" + session.Name + ".csv";
+  std::string summaryName = outputDir + "/" + session.Name + " Trial Summary.csv";
+  FILE* log = fopen(logName.c_str(), "w");
+  FILE* summaryFile = fopen(summaryName.c_str(), "w");
+  if(log == 0 || summaryFile == 0)
+  {
+    printf("Couldnt write '%s'\n", log == 0 ? logName.c_str() : summaryName.c_str());
+    if(log) fclose(log);
+    if(summaryFile) fclose(summaryFile);
+    return 0;
+  }
+
+  fprintf(log, "%s,%s,%s,%s,%s,%s\n", "Time", "Trial", "Feature", "Detect", "Epoch", "Carried");
+  AttentionStatistics::WriteHeader(summaryFile);
+
+  // Only the accounting half of the tracker is used here; it needs no cascades
+  AttentionTracker attention;
+  attention.SetFeature(feature);
+  attention.SetThreshold(threshold);
+  int frames = 0;
+  int missing = 0;
+  int trial = -1;
+  for(size_t c = 0; c < session.Chunks.size(); c++)
+  {
+    // Frames are matched to log rows by their position in the video, so a chunk that
+    // decoded short leaves a gap instead of shifting every later frame onto the wrong row.
+    // Only the last chunk may end early without a gap: the frame count is an estimate.
+    const Chunk& chunk = chunks[session.Chunks[c]];
+    bool last = c + 1 == session.Chunks.size();
+    int end = last ? chunk.Begin + (int)chunk.Detect.size() : chunk.End;
+    if(!last && (int)chunk.Detect.size() < chunk.End - chunk.Begin)
+    {
+      printf("%s: frames %d to %d didnt decode, logged with Detect -1\n", session.Name.c_str(),
+        chunk.Begin + (int)chunk.Detect.size(), chunk.End - 1);
+      missing += chunk.End - chunk.Begin - (int)chunk.Detect.size();
+    }
+
+    for(int frame = chunk.Begin; frame < end; frame++)
+    {
+      LogRow row = { frame / session.FramesPerSecond, 0, 0 };
+      if(frame < (int)rows.size())
+        row = rows[frame];
+      else if(!rows.empty())
+      {
+        row.Trial = rows.back().Trial;
+        row.Epoch = rows.back().Epoch;
+      }
+
+      // Trial and epoch changes as AdvanceTrialEpoch() made them, judged on the counter so far
+      if(trial >= 0 && row.Trial != trial && attention.AdvanceEpoch(0, row.Time) >= 0)
+        AttentionStatistics::WriteRecord(summaryFile, attention.GetLastTrial());
+      if(row.Epoch != attention.GetEpoch())
+        attention.AdvanceEpoch(row.Epoch, row.Time);
+      trial = row.Trial;
+
+      // A gap is logged like a frame without tracking and leaves the counter alone
+      int i = frame - chunk.Begin;
+      int detect = i < (int)chunk.Detect.size() ? chunk.Detect[i] : -1;
+      fprintf(log, "%f,%i,%i,%i,%i,%i\n", row.Time, row.Trial, feature, detect, row.Epoch, 0);
+      if(detect >= 0)
+        attention.AddDecision(detect, row.Time);
+      frames = frame + 1;
+    }
+  }
+
+  if(!rows.empty() && frames != (int)rows.size())
+    printf("%s: %d video frames but %d log rows; the recorder may have dropped frames\n",
+      session.Name.c_str(), frames, (int)rows.size());
+
+  fprintf(log, "\n%s,\t%s,\t%s,\t%s,\t%s,\t%s", "bigEyePair = 1", "smallEyePair = 2", "frontalFace = 3", "leftRightEye = 4", "mouth = 5", "nose = 6");
+  fprintf(log, "\n%s,\t%s,\t%s","Epoch 0 = Intertrial", "Epoch 1 = Button Press", "Epoch 2 = Reach");
+  fprintf(log, "\n%s,\t%s", "Carried 0 = Detected this frame", "Carried 1 = Previous detection reused (no motion)");
+  fclose(log);
+  fclose(summaryFile);
+  return frames - missing;
+}
+
+
+/** Seconds the workers spent detecting since the last call, summed over threads */
+static double TakeDetectSeconds(std::vector<WorkerState>& workers)
+{
+  double seconds = 0;
+  for(size_t w = 0; w < workers.size(); w++)
+  {
+    seconds += workers[w].DetectSeconds;
+    workers[w].DetectSeconds = 0;
+  }
+  return seconds;
+}
+
+
+int main( int argc, char** argv )
+{
+  if(argc < 2)
+  {
+    printf("Usage: BatchReprocess <session dir> [-o Reprocessed] [-threads n] [-chunk frames] [-feature n | -features n,n,...]\n"
+           "                      [-threshold n] [-width pixels]\n"
+           "                      [-cache dir] [-cachewidth pixels] [-levels n] [-batch frames] [-compare]\n");
+    return 1;
+  }
+
+  std::string outputDir = "Reprocessed";
+  int threads = 0;
+  int chunkFrames = 600;
+  std::vector<int> features(1, FeatureTracker::EyePairBig);
+  int threshold = 40;
+  int maxWidth = 640;
+  std::string cacheDir;
+  int cacheWidth = 0;
+  int levels = 3;
+  int batchSize = 16;
+  bool compare = false;
+  for(int i = 2; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-compare") == 0)
+    {
+      compare = true;
+      continue;
+    }
+    if(i + 1 >= argc)
+      break;
+
+    if(strcmp(argv[i], "-o") == 0) outputDir = argv[++i];
+    else if(strcmp(argv[i], "-threads") == 0) threads = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-chunk") == 0) chunkFrames = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-feature") == 0) features.assign(1, atoi(argv[++i]));
+    else if(strcmp(argv[i], "-features") == 0)
+    {
+      features.clear();
+      for(char* item = strtok(argv[++i], ","); item; item = strtok(0, ","))
+        features.push_back(atoi(item));
+      if(features.empty())
+        features.push_back(FeatureTracker::EyePairBig);
+    }
+    else if(strcmp(argv[i], "-threshold") == 0) threshold = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-width") == 0) maxWidth = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-cache") == 0) cacheDir = argv[++i];
+    else if(strcmp(argv[i], "-cachewidth") == 0) cacheWidth = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-levels") == 0) levels = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-batch") == 0) batchSize = atoi(argv[++i]);
+  }
+  if(batchSize < 1) batchSize = 1;
+  if(cacheWidth <= 0) cacheWidth = maxWidth;
+  levels = std::max(1, std::min(levels, (int)PreprocessCache::MaxLevels));
+
+  // Detection widths of the cache levels
+  std::vector<int> cacheWidths;
+  for(int l = 0, width = cacheWidth; l < levels && width > 0; l++, width /= 2)
+    cacheWidths.push_back(width);
+  if(!cacheDir.empty())
+    QDir().mkpath(QString::fromStdString(cacheDir));
+  if(chunkFrames < 1) chunkFrames = 1;
+  if(threshold < 1) threshold = 1;
+
+  // Find the sessions and their lengths
+  QDir directory(argv[1]);
+  QStringList videos = directory.entryList(QStringList("*.avi"), QDir::Files, QDir::Name);
+  std::vector<Session> sessions;
+  for(int v = 0; v < videos.size(); v++)
+  {
+    Session session;
+    session.Name = QFileInfo(videos[v]).completeBaseName().toStdString();
+    session.Video = directory.filePath(videos[v]).toStdString();
+    QString log = session.Name == "Session Video" ? QString("Log File.csv") : QFileInfo(videos[v]).completeBaseName() + ".csv";
+    session.Log = directory.filePath(log).toStdString();
+
+    CvCapture* capture = cvCreateFileCapture(session.Video.c_str());
+    if(capture == 0)
+    {
+      printf("Couldnt open video '%s'\n", session.Video.c_str());
+      continue;
+    }
+    session.Frames = (int)cvGetCaptureProperty(capture, CV_CAP_PROP_FRAME_COUNT);
+    session.FramesPerSecond = cvGetCaptureProperty(capture, CV_CAP_PROP_FPS);
+    if(session.FramesPerSecond <= 0)
+      session.FramesPerSecond = 30;
+
+    // The cache is laid out for the frame size, so it takes one decoded frame to open it
+    session.Cache = 0;
+    session.FrameSize = cvSize(0, 0);
+    IplImage* first = cacheDir.empty() || session.Frames <= 0 ? 0 : cvQueryFrame(capture);
+    if(first)
+    {
+      session.FrameSize = cvSize(first->width, first->height);
+      char name[64];
+      snprintf(name, sizeof(name), ".w%d.cache", cacheWidth);
+      session.Cache = new PreprocessCache;
+      if(session.Cache->Open(cacheDir + "/" + session.Name + name, session.Video, session.Frames, session.FrameSize, cacheWidths))
+        printf("%s: %d of %d frames preprocessed in the cache\n", session.Name.c_str(),
+          session.Cache->GetFramesAtOpen(), session.Frames);
+      else
+      {
+        delete session.Cache;
+        session.Cache = 0;
+      }
+    }
+    cvReleaseCapture(&capture);
+
+    // Without a frame count the whole video is one chunk that runs until the frames stop
+    if(session.Frames <= 0)
+      session.Frames = 0x7fffffff;
+    sessions.push_back(session);
+  }
+  if(sessions.empty())
+  {
+    printf("No session videos in '%s'\n", argv[1]);
+    return 1;
+  }
+
+  // Cut every video into chunks
+  std::vector<Chunk> chunks;
+  long long totalFrames = 0;
+  for(size_t s = 0; s < sessions.size(); s++)
+  {
+    int step = sessions[s].Frames == 0x7fffffff ? sessions[s].Frames : chunkFrames;
+    for(int begin = 0; begin < sessions[s].Frames; begin += step)
+    {
+      Chunk chunk;
+      chunk.Session = (int)s;
+      chunk.Begin = begin;
+      chunk.End = begin + std::min(step, sessions[s].Frames - begin);
+      sessions[s].Chunks.push_back((int)chunks.size());
+      chunks.push_back(chunk);
+      if(step == 0x7fffffff)
+        break;
+    }
+    totalFrames += sessions[s].Frames == 0x7fffffff ? chunkFrames : sessions[s].Frames;
+  }
+
+  WorkStealingPool pool(threads);
+  int numberOfThreads = pool.GetNumberOfThreads();
+
+  // Deal consecutive chunks to the same thread, an equal share of frames each, so every
+  // thread mostly decodes straight through; stealing evens out whatever is left over
+  std::vector< std::vector<int> > queues(numberOfThreads);
+  long long share = (totalFrames + numberOfThreads - 1) / numberOfThreads;
+  long long dealt = 0;
+  for(size_t c = 0; c < chunks.size(); c++)
+  {
+    int w = (int)std::min<long long>(dealt / std::max<long long>(share, 1), numberOfThreads - 1);
+    queues[w].push_back((int)c);
+    dealt += std::min<long long>(chunks[c].End - chunks[c].Begin, chunkFrames);
+  }
+
+  // Detectors aren't thread safe, so every thread gets its own tracker
+  std::vector<WorkerState> workers(numberOfThreads);
+  for(int w = 0; w < numberOfThreads; w++)
+  {
+    WorkerState& state = workers[w];
+    state.Tracker = new AttentionTracker;
+    if(!state.Tracker->Initialize())
+      return 1;
+    state.Tracker->SetFeature(features[0]);
+    state.Tracker->SetMaxDetectionWidth(maxWidth);
+    state.Capture = 0;
+    state.Session = -1;
+    state.NextFrame = 0;
+    state.Cached = new PreprocessCache::Range;
+    state.DetectSeconds = 0;
+  }
+
+  printf("Reprocessing %d sessions in %d chunks on %d threads, %d frames per batch, %d features\n", (int)sessions.size(),
+    (int)chunks.size(), numberOfThreads, batchSize, (int)features.size());
+  ReprocessJob job(sessions, chunks, workers, features, maxWidth, batchSize);
+  double start = (double)cvGetTickCount();
+  pool.Run(&job, queues);
+  double seconds = ((double)cvGetTickCount() - start) / (cvGetTickFrequency() * 1000000.0);
+  TakeDetectSeconds(workers);
+
+  // Run the same chunks again, batched and frame by frame. The first run may have
+  // filled the cache, so both reruns start from the same cache and read the same way.
+  // Decoding is left out; shrinking and detecting are timed on both sides.
+  if(compare && batchSize > 1)
+  {
+    std::vector<Chunk> batched = chunks;
+    for(size_t c = 0; c < batched.size(); c++)
+    {
+      batched[c].Detect.clear();
+      batched[c].OtherFeatures.clear();
+    }
+    ReprocessJob batchedJob(sessions, batched, workers, features, maxWidth, batchSize);
+    pool.Run(&batchedJob, queues);
+    double detectSeconds = TakeDetectSeconds(workers);
+
+    std::vector<Chunk> perFrame = chunks;
+    for(size_t c = 0; c < perFrame.size(); c++)
+    {
+      perFrame[c].Detect.clear();
+      perFrame[c].OtherFeatures.clear();
+    }
+    ReprocessJob perFrameJob(sessions, perFrame, workers, features, maxWidth, 1);
+    pool.Run(&perFrameJob, queues);
+    double perFrameSeconds = TakeDetectSeconds(workers);
+
+    // A frame differs if any of its features was decided differently
+    int others = (int)features.size() - 1;
+    int frames = batchedJob.GetFramesDone();
+    int differ = 0;
+    for(size_t c = 0; c < batched.size(); c++)
+      for(size_t f = 0; f < std::min(batched[c].Detect.size(), perFrame[c].Detect.size()); f++)
+      {
+        bool same = batched[c].Detect[f] == perFrame[c].Detect[f];
+        for(int o = 0; o < others; o++)
+          same &= batched[c].OtherFeatures[f * others + o] == perFrame[c].OtherFeatures[f * others + o];
+        differ += same ? 0 : 1;
+      }
+
+    printf("Detection of %d features per thread: %.1f frames per second in batches of %d, %.1f frame by frame (%.2fx)\n",
+      (int)features.size(), detectSeconds > 0 ? frames / detectSeconds : 0, batchSize,
+      perFrameSeconds > 0 ? perFrameJob.GetFramesDone() / perFrameSeconds : 0,
+      detectSeconds > 0 ? perFrameSeconds / detectSeconds : 0);
+    if(differ == 0 && perFrameJob.GetFramesDone() == frames)
+      printf("Both decided every frame alike\n");
+    else
+      printf("%d frames decided differently, %d and %d frames detected\n", differ, frames, perFrameJob.GetFramesDone());
+  }
+
+  for(int w = 0; w < numberOfThreads; w++)
+  {
+    WorkerState& state = workers[w];
+    if(state.Capture) cvReleaseCapture(&state.Capture);
+    delete state.Tracker;
+    delete state.Cached;
+    for(size_t c = 0; c < state.Copies.size(); c++)
+      if(state.Copies[c]) cvReleaseImage(&state.Copies[c]);
+  }
+  for(size_t s = 0; s < sessions.size(); s++)
+    delete sessions[s].Cache;
+
+  // Stitch each video back together, in frame order
+  QDir().mkpath(QString::fromStdString(outputDir));
+  int written = 0;
+  for(size_t s = 0; s < sessions.size(); s++)
+    written += StitchSession(sessions[s], chunks, outputDir, features[0], threshold);
+
+  int frames = job.GetFramesDone();
+  printf("Detected on %d frames in %.1f s: %.1f frames per second\n", frames, seconds, seconds > 0 ? frames / seconds : 0);
+  if(!cacheDir.empty())
+    printf("%d frames read from the preprocessing cache, %d added to it\n", job.GetFramesFromCache(), job.GetFramesCached());
+  printf("Chunks per thread:");
+  for(int w = 0; w < numberOfThreads; w++)
+    printf(" %d", pool.GetTasksRun()[w]);
+  printf(", %d stolen\n", pool.GetSteals());
+  printf("Wrote %d frames of logs to '%s'\n", written, outputDir.c_str());
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "CaptureThread.h"
+
+#include "Trace.h"
+
+CaptureThread
+::CaptureThread(FrameSource* source)
+{
+  m_Source = source;
+  m_Policy = 0;
+  m_ImagePool = 0;
+  m_Back = 0;
+  m_Latest = 0;
+  m_Front = 0;
+  m_LatestGrabStart = 0;
+  m_LatestTime = 0;
+  m_FrontGrabStart = 0;
+  m_FrontTime = 0;
+  m_HasNewFrame = false;
+}
+
+
+CaptureThread
+::~CaptureThread()
+{
+  this->Stop();
+
+  ImagePool::Free(m_ImagePool, &m_Back);
+  ImagePool::Free(m_ImagePool, &m_Latest);
+  ImagePool::Free(m_ImagePool, &m_Front);
+}
+
+
+void
+CaptureThread
+::Stop()
+{
+  m_Stopping.fetchAndStoreOrdered(1);
+  QThread::wait();
+}
+
+
+void
+CaptureThread
+::run()
+{
+  double ticksPerSecond = cvGetTickFrequency() * 1000000.0;
+  double interval = m_Source->GetFrameInterval() * ticksPerSecond;
+  double due = (double)cvGetTickCount();
+  if(m_Policy)
+    m_Policy->Apply(CaptureThreadRole);
+  TraceThreadName("capture");
+
+  while(!m_Stopping.fetchAndAddOrdered(0))
+  {
+    // Recorded and synthetic frames are handed out at their frame rate; if we fall
+    // more than a frame behind, carry on from now rather than bursting to catch up
+    if(interval > 0)
+    {
+      double wait = due - (double)cvGetTickCount();
+      if(wait > 0)
+        QThread::usleep((unsigned long)(wait * 1000000.0 / ticksPerSecond));
+      else if(wait < -interval)
+        due = (double)cvGetTickCount();
+      due += interval;
+    }
+
+    // Blocks until the camera delivers the next frame; the time spent here is the driver's
+    double grabStart = (double)cvGetTickCount();
+    TraceEvent("capture", 'B');
+    IplImage* frame = m_Source->QueryFrame();
+    TraceEvent("capture", 'E');
+    double captureTime = (double)cvGetTickCount();
+    if(frame == 0)
+    {
+      QThread::msleep(5);
+      continue;
+    }
+
+    // Buffers are created on first use, and recreated if the frame size changes, only
+    // while they sit in the back position where nobody else can be looking at them
+    if(m_Back == 0 || m_Back->width != frame->width || m_Back->height != frame->height
+      || m_Back->nChannels != frame->nChannels)
+    {
+      ImagePool::Free(m_ImagePool, &m_Back);
+      m_Back = ImagePool::Create(m_ImagePool, cvSize(frame->width, frame->height), frame->nChannels);
+    }
+
+    // OpenCV reuses its frame on the next query, so copy it out before publishing
+    TraceEvent("copy frame", 'B');
+    cvCopy(frame, m_Back);
+    TraceEvent("copy frame", 'E');
+
+    m_SwapMutex.lock();
+    IplImage* temp = m_Latest;
+    m_Latest = m_Back;
+    m_Back = temp;
+    m_LatestGrabStart = grabStart;
+    m_LatestTime = captureTime;
+    m_HasNewFrame = true;
+    m_SwapMutex.unlock();
+
+    // One queued notification at a time; a consumer that falls behind just gets the newest frame
+    if(m_NotifyPending.testAndSetOrdered(0, 1))
+      emit FrameArrived();
+  }
+
+  if(m_Policy)
+    m_Policy->Leave();
+}
+
+
+IplImage*
+CaptureThread
+::TakeLatestFrame(double* grabStart, double* captureTime)
+{
+  m_NotifyPending.fetchAndStoreOrdered(0);
+
+  QMutexLocker lock(&m_SwapMutex);
+  if(!m_HasNewFrame)
+    return 0;
+
+  IplImage* temp = m_Front;
+  m_Front = m_Latest;
+  m_Latest = temp;
+  m_FrontGrabStart = m_LatestGrabStart;
+  m_FrontTime = m_LatestTime;
+  m_HasNewFrame = false;
+
+  if(grabStart)
+    *grabStart = m_FrontGrabStart;
+  if(captureTime)
+    *captureTime = m_FrontTime;
+  return m_Front;
+}
@@ -0,0 +1,94 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef _CaptureThread_h
+#define _CaptureThread_h
+
+#include <cv.h>
+
+#include "FrameSource.h"
+#include "ImagePool.h"
+#include "ThreadPolicy.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThread>
+
+/** Pulls frames from the camera (or another frame source) on its own thread and announces each one with
+FrameArrived(), so processing runs when a frame is ready instead of on a fixed
+timer. Frames are handed over through three buffers: the thread fills one while
+the newest complete frame waits in the second and the consumer reads the third. */
+class CaptureThread : public QThread
+{
+Q_OBJECT
+
+public:
+
+  /** Constructor; the source stays owned by the caller. Sources that don't wait
+  for their frames themselves are paced at their frame interval. */
+  CaptureThread(FrameSource* source);
+
+  /** Destructor; stops the thread */
+  virtual ~CaptureThread();
+
+  /** Ask the thread to stop and wait for it */
+  void Stop();
+
+  /** CPU and priority for the thread; call before start() */
+  void SetThreadPolicy(ThreadPolicy* policy) { m_Policy = policy; }
+
+  /** Borrow the three frame buffers from this pool, which locks them in memory if asked
+  to; without one they are allocated plainly. Call before start(). */
+  void SetImagePool(ImagePool* pool) { m_ImagePool = pool; }
+
+  /** Take the newest frame, or 0 if none arrived since the last call. The frame stays
+  valid until the next call. grabStart and captureTime are when the source was asked for
+  the frame and when it returned it, in cvGetTickCount() ticks. */
+  IplImage* TakeLatestFrame(double* grabStart, double* captureTime);
+
+signals:
+
+  /** A new frame is waiting; not emitted again until TakeLatestFrame() is called */
+  void FrameArrived();
+
+protected:
+
+  /** Capture loop */
+  virtual void run();
+
+  FrameSource* m_Source;
+  ThreadPolicy* m_Policy;
+  ImagePool* m_ImagePool;
+
+  /** Being filled by the thread, newest complete frame, held by the consumer */
+  IplImage* m_Back;
+  IplImage* m_Latest;
+  IplImage* m_Front;
+
+  /** Grab start and capture times of m_Latest and m_Front */
+  double m_LatestGrabStart;
+  double m_LatestTime;
+  double m_FrontGrabStart;
+  double m_FrontTime;
+
+  /** Guards the pointer swaps only, never a copy */
+  QMutex m_SwapMutex;
+  bool m_HasNewFrame;
+
+  QAtomicInt m_NotifyPending;
+  QAtomicInt m_Stopping;
+};
+
+#endif
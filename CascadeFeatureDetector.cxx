@@ -0,0 +1,52 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "CascadeFeatureDetector.h"
+
+bool
+CascadeFeatureDetector
+::Load(const std::string& filename)
+{
+  if(!m_Classifier.load(filename))
+    return false;
+
+  m_Model = filename;
+  return true;
+}
+
+
+CvRect
+CascadeFeatureDetector
+::DetectObject(IplImage* gray)
+{
+  if(m_Classifier.empty())
+    return cvRect(-1,-1,-1,-1);
+
+  // The Mat header shares the pixels and, like the C API, honours the ROI
+  IplImage* detectImg = this->ApplyInputScale(gray);
+  cv::Mat image(detectImg);
+
+  m_Objects.clear();
+  m_Classifier.detectMultiScale(image, m_Objects, m_Parameters.ScaleFactor, m_Parameters.MinNeighbors,
+    m_Parameters.Flags, cv::Size(m_Parameters.MinSize, m_Parameters.MinSize));
+
+  CvRect best = cvRect(-1,-1,-1,-1);
+  for(size_t r = 0; r < m_Objects.size(); r++)
+  {
+    if(m_Objects[r].area() > best.width * best.height)
+      best = m_Objects[r];
+  }
+
+  return this->UndoInputScale(best);
+}
@@ -0,0 +1,42 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _CascadeFeatureDetector_h
+#define _CascadeFeatureDetector_h
+
+#include "opencv2/objdetect/objdetect.hpp"
+
+#include "FeatureDetector.h"
+
+/** A cascade run through the OpenCV 2 cv::CascadeClassifier, as in objectDetection.cpp.
+This reads the newer cascade format, so it is the backend for LBP cascades, which
+use integer features and are several times cheaper than Haar cascades of the same size. */
+class CascadeFeatureDetector : public FeatureDetector
+{
+public:
+
+  virtual const char* GetBackend() const { return "lbp"; }
+  virtual bool Load(const std::string& filename);
+
+protected:
+
+  virtual CvRect DetectObject(IplImage* gray);
+
+  cv::CascadeClassifier m_Classifier;
+
+  /** Reused between frames so detectMultiScale doesn't allocate */
+  std::vector<cv::Rect> m_Objects;
+};
+
+#endif
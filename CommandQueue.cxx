@@ -0,0 +1,55 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "CommandQueue.h"
+
+CommandQueue
+::CommandQueue(int capacity)
+  : m_Ring(capacity)
+{
+}
+
+
+bool
+CommandQueue
+::Push(int type, int value)
+{
+  int tail = m_Tail.fetchAndAddRelaxed(0);
+  int next = (tail + 1) % (int)m_Ring.size();
+
+  // Acquire pairs with the consumer's release, so the slot is really free
+  if(next == m_Head.fetchAndAddAcquire(0))
+    return false;
+
+  m_Ring[tail].Type = type;
+  m_Ring[tail].Value = value;
+
+  // Release makes the command visible before the new tail
+  m_Tail.fetchAndStoreRelease(next);
+  return true;
+}
+
+
+bool
+CommandQueue
+::Pop(Command& command)
+{
+  int head = m_Head.fetchAndAddRelaxed(0);
+  if(head == m_Tail.fetchAndAddAcquire(0))
+    return false;
+
+  command = m_Ring[head];
+  m_Head.fetchAndStoreRelease((head + 1) % (int)m_Ring.size());
+  return true;
+}
@@ -0,0 +1,58 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _CommandQueue_h
+#define _CommandQueue_h
+
+#include <vector>
+
+#include <QAtomicInt>
+
+/** One control change, e.g. a new threshold */
+struct Command
+{
+  int Type;
+  int Value;
+};
+
+/** Fixed size ring of commands from a producer to one consumer thread. Neither side
+locks or allocates: each owns one end of the ring and only publishes its index to the
+other with an atomic store. Push() must not be called by two threads at once; callers
+with several producer threads serialize them, the consumer never waits on that. */
+class CommandQueue
+{
+public:
+
+  /** Constructor; holds at most capacity - 1 commands */
+  CommandQueue(int capacity = 256);
+
+  /** Producer, one at a time: append a command; returns false and drops it if the
+  ring is full */
+  bool Push(int type, int value);
+
+  /** Consumer: take the oldest command; returns false if there is none */
+  bool Pop(Command& command);
+
+protected:
+
+  std::vector<Command> m_Ring;
+
+  /** Next slot to read, written by the consumer only */
+  QAtomicInt m_Head;
+
+  /** Next slot to write, written by the producer only */
+  QAtomicInt m_Tail;
+};
+
+#endif
@@ -0,0 +1,123 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "DetectionProfile.h"
+
+#include <stdio.h>
+
+DetectionProfile
+::DetectionProfile()
+{
+  m_RequiredHitRate = 0;
+}
+
+
+bool
+DetectionProfile
+::Load(const char* filename)
+{
+  FILE* file = fopen(filename, "r");
+  if(file == 0)
+    return false;
+
+  // One setting per line; '#' starts a comment
+  char line[1024];
+  char cascade[512];
+  while(fgets(line, sizeof(line), file))
+  {
+    if(line[0] == '#')
+      continue;
+
+    DetectionParameters p;
+    int fields = sscanf(line, "%511s %lf %d %d %d %lf %lf %lf", cascade, &p.ScaleFactor, &p.MinNeighbors,
+      &p.MinSize, &p.Flags, &p.InputScale, &p.Latency, &p.HitRate);
+    if(fields >= 6)
+      this->Add(cascade, p);
+  }
+
+  fclose(file);
+  return true;
+}
+
+
+bool
+DetectionProfile
+::Save(const char* filename) const
+{
+  FILE* file = fopen(filename, "w");
+  if(file == 0)
+    return false;
+
+  fprintf(file, "# cascade scale_factor min_neighbors min_size flags input_scale latency_ms hit_rate\n");
+  for(EntryMap::const_iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+  {
+    for(size_t e = 0; e < it->second.size(); e++)
+    {
+      const DetectionParameters& p = it->second[e];
+      fprintf(file, "%s %g %d %d %d %g %f %f\n", it->first.c_str(), p.ScaleFactor, p.MinNeighbors,
+        p.MinSize, p.Flags, p.InputScale, p.Latency, p.HitRate);
+    }
+  }
+
+  fclose(file);
+  return true;
+}
+
+
+void
+DetectionProfile
+::Add(const std::string& cascade, const DetectionParameters& parameters)
+{
+  m_Entries[cascade].push_back(parameters);
+}
+
+
+void
+DetectionProfile
+::Clear(const std::string& cascade)
+{
+  m_Entries.erase(cascade);
+}
+
+
+DetectionParameters
+DetectionProfile
+::Get(const std::string& cascade) const
+{
+  EntryMap::const_iterator it = m_Entries.find(cascade);
+  if(it == m_Entries.end() || it->second.empty())
+    return DetectionParameters();
+
+  const std::vector<DetectionParameters>& entries = it->second;
+
+  // Fastest setting that is accurate enough ...
+  int best = -1;
+  for(size_t e = 0; e < entries.size(); e++)
+    if(m_RequiredHitRate > 0 && entries[e].HitRate >= m_RequiredHitRate)
+      if(best < 0 || entries[e].Latency < entries[best].Latency)
+        best = (int)e;
+
+  // ... or else the most accurate one, the faster one on a tie
+  if(best < 0)
+  {
+    best = 0;
+    for(size_t e = 1; e < entries.size(); e++)
+      if(entries[e].HitRate > entries[best].HitRate ||
+        (entries[e].HitRate == entries[best].HitRate && entries[e].Latency < entries[best].Latency))
+        best = (int)e;
+  }
+
+  return entries[best];
+}
@@ -0,0 +1,83 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef _DetectionProfile_h
+#define _DetectionProfile_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cv.h>
+
+/** Settings for one cvHaarDetectObjects call */
+struct DetectionParameters
+{
+  /** Defaults are the values the app has always used */
+  DetectionParameters()
+    : ScaleFactor(1.1), MinNeighbors(3), MinSize(10),
+      Flags(CV_HAAR_FIND_BIGGEST_OBJECT | CV_HAAR_DO_ROUGH_SEARCH), InputScale(1.0),
+      Latency(0), HitRate(0) {}
+
+  double ScaleFactor;
+  int MinNeighbors;
+  int MinSize;
+  int Flags;
+
+  /** The detection image is shrunk by this factor before the cascade runs */
+  double InputScale;
+
+  /** Measured by the parameter sweep: mean milliseconds per frame and fraction of correct frames */
+  double Latency;
+  double HitRate;
+};
+
+/** Per-cascade detection settings, keyed by cascade file name.
+A profile written by the ParameterSweep tool holds the whole speed/accuracy Pareto
+front for every cascade; Get() picks the fastest point that is accurate enough. */
+class DetectionProfile
+{
+public:
+
+  /** Constructor */
+  DetectionProfile();
+
+  /** Read a profile; returns false if the file can't be opened */
+  bool Load(const char* filename);
+
+  /** Write the profile */
+  bool Save(const char* filename) const;
+
+  /** Add one candidate setting for a cascade */
+  void Add(const std::string& cascade, const DetectionParameters& parameters);
+
+  /** Drop all settings of a cascade */
+  void Clear(const std::string& cascade);
+
+  /** Settings to use for a cascade; defaults if the profile doesn't mention it */
+  DetectionParameters Get(const std::string& cascade) const;
+
+  /** Smallest hit rate Get() accepts; with 0 the most accurate setting is used */
+  void SetRequiredHitRate(double hitRate) { m_RequiredHitRate = hitRate; }
+
+protected:
+
+  typedef std::map< std::string, std::vector<DetectionParameters> > EntryMap;
+  EntryMap m_Entries;
+
+  double m_RequiredHitRate;
+};
+
+#endif
@@ -0,0 +1,158 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "DetectorLoader.h"
+
+#include <stdio.h>
+
+#include "HaarFeatureDetector.h"
+#include "Trace.h"
+
+DetectorLoader
+::DetectorLoader(const FeatureDetectorRegistry& registry)
+  : m_Registry(registry)
+{
+  m_Stopping = false;
+}
+
+
+DetectorLoader
+::~DetectorLoader()
+{
+  this->Stop();
+
+  std::string feature;
+  while(FeatureDetector* detector = this->TakeLoaded(feature))
+    delete detector;
+}
+
+
+void
+DetectorLoader
+::Stop()
+{
+  m_Mutex.lock();
+  m_Stopping = true;
+  m_Requests.clear();
+  m_Wake.wakeAll();
+  m_Mutex.unlock();
+
+  QThread::wait();
+}
+
+
+void
+DetectorLoader
+::Request(const std::string& feature, const std::string& backend, const std::string& model,
+  CvSize warmUpSize)
+{
+  LoadRequest request = { feature, backend, model, warmUpSize };
+
+  QMutexLocker lock(&m_Mutex);
+  m_Requests.push_back(request);
+  m_Wake.wakeOne();
+}
+
+
+void
+DetectorLoader
+::run()
+{
+  TraceThreadName("detector loader");
+  while(true)
+  {
+    m_Mutex.lock();
+    while(m_Requests.empty() && !m_Stopping)
+      m_Wake.wait(&m_Mutex);
+    if(m_Stopping)
+    {
+      m_Mutex.unlock();
+      return;
+    }
+    LoadRequest request = m_Requests.front();
+    m_Requests.pop_front();
+    m_Mutex.unlock();
+
+    TraceEvent("load detector", 'B');
+    FeatureDetector* detector = this->Load(request);
+    TraceEvent("load detector", 'E');
+    if(detector == 0)
+      continue;
+
+    // Publish; the detection thread only ever swaps the whole list out, so a plain push is safe
+    Loaded* loaded = new Loaded;
+    loaded->Feature = request.Feature;
+    loaded->Detector = detector;
+    do
+      loaded->Next = m_Ready;
+    while(!m_Ready.testAndSetRelease(loaded->Next, loaded));
+  }
+}
+
+
+FeatureDetector*
+DetectorLoader
+::Load(const LoadRequest& request)
+{
+  const std::string& feature = request.Feature;
+  const std::string& backend = request.Backend;
+  const std::string& model = request.Model;
+  double start = (double)cvGetTickCount();
+  FeatureDetector* detector = m_Registry.Create(feature, backend, model);
+  if(detector == 0)
+    return 0;
+
+  // A cascade without stages or window loads fine but never finds anything
+  HaarFeatureDetector* haar = dynamic_cast<HaarFeatureDetector*>(detector);
+  CvHaarClassifierCascade* cascade = haar ? haar->GetCascade() : 0;
+  if(haar && (cascade == 0 || cascade->count < 1 || cascade->orig_window_size.width < 1 || cascade->orig_window_size.height < 1))
+  {
+    printf("'%s' is not a usable cascade, keeping the detector for %s\n", model.c_str(), feature.c_str());
+    delete detector;
+    return 0;
+  }
+
+  // The first search builds the cascade's internal tables; let it happen here, and keep it out of the costs
+  IplImage* blank = cvCreateImage(request.WarmUpSize, IPL_DEPTH_8U, 1);
+  cvZero(blank);
+  detector->Detect(blank);
+  detector->ResetCost();
+  cvReleaseImage(&blank);
+
+  printf("Loaded %s model '%s' for %s in %.0f ms\n", backend.c_str(), model.c_str(), feature.c_str(),
+    ((double)cvGetTickCount() - start) / (cvGetTickFrequency() * 1000.0));
+  return detector;
+}
+
+
+FeatureDetector*
+DetectorLoader
+::TakeLoaded(std::string& feature)
+{
+  // Take everything published so far; it comes newest first
+  if(m_Taken.empty())
+  {
+    for(Loaded* loaded = m_Ready.fetchAndStoreAcquire(0); loaded; loaded = loaded->Next)
+      m_Taken.push_back(loaded);
+  }
+  if(m_Taken.empty())
+    return 0;
+
+  Loaded* loaded = m_Taken.back();
+  m_Taken.pop_back();
+  feature = loaded->Feature;
+  FeatureDetector* detector = loaded->Detector;
+  delete loaded;
+  return detector;
+}
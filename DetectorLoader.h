@@ -0,0 +1,96 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _DetectorLoader_h
+#define _DetectorLoader_h
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <cv.h>
+
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "FeatureDetectorRegistry.h"
+
+/** Loads replacement detectors off the frame loop. cvLoad of a cascade takes a second or
+more, and its first search builds the cascade's internal tables, so both happen here:
+each requested detector is loaded, checked and warmed up with one search of a blank
+image before it is handed over. Finished detectors are published on a lock-free list;
+the detection thread takes them between frames with TakeLoaded(), binds them, and
+deletes the old ones, which by then no frame is using. No frame ever waits. */
+class DetectorLoader : public QThread
+{
+public:
+
+  /** Constructor; detectors are created through the registry's backends and profile */
+  DetectorLoader(const FeatureDetectorRegistry& registry);
+
+  /** Destructor; stops the thread and deletes detectors nobody took */
+  virtual ~DetectorLoader();
+
+  /** Finish the current load, drop the queued ones and wait for the thread */
+  void Stop();
+
+  /** Queue a detector to load; returns immediately. Safe from any thread. The detector is
+  warmed up on a blank image of warmUpSize, best the size of the detection image. */
+  void Request(const std::string& feature, const std::string& backend, const std::string& model,
+    CvSize warmUpSize = cvSize(640, 480));
+
+  /** Detection thread only: the next detector that finished loading, oldest first, or 0.
+  Never blocks. The caller owns the detector. */
+  FeatureDetector* TakeLoaded(std::string& feature);
+
+protected:
+
+  virtual void run();
+
+  struct LoadRequest
+  {
+    std::string Feature;
+    std::string Backend;
+    std::string Model;
+    CvSize WarmUpSize;
+  };
+
+  /** Load, check and warm up one detector; 0 if it isn't usable */
+  FeatureDetector* Load(const LoadRequest& request);
+
+  struct Loaded
+  {
+    std::string Feature;
+    FeatureDetector* Detector;
+    Loaded* Next;
+  };
+
+  const FeatureDetectorRegistry& m_Registry;
+
+  /** Requests, guarded by the mutex; only the requesting thread and the loader take it */
+  QMutex m_Mutex;
+  QWaitCondition m_Wake;
+  std::deque<LoadRequest> m_Requests;
+  bool m_Stopping;
+
+  /** Loaded detectors, newest first, pushed by the loader and taken all at once */
+  QAtomicPointer<Loaded> m_Ready;
+
+  /** Taken from m_Ready but not handed out yet, oldest last; detection thread only */
+  std::vector<Loaded*> m_Taken;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "EpochPolicy.h"
+
+#include <stdio.h>
+
+EpochPolicy
+::EpochPolicy()
+{
+  m_Full.FrameInterval = 1;
+  m_Full.DetectionWidth = 0;
+  for(int e = 0; e < NUM_EPOCHS; e++)
+    m_Budgets[e] = m_Full;
+
+  // Nobody is asked to attend during the intertrial interval
+  this->Set(0, 4, 320);
+}
+
+
+bool
+EpochPolicy
+::Load(const char* filename)
+{
+  FILE* file = fopen(filename, "r");
+  if(file == 0)
+    return false;
+
+  char line[256];
+  int epoch, frameInterval, detectionWidth;
+  while(fgets(line, sizeof(line), file))
+  {
+    if(line[0] == '#' || sscanf(line, "%d %d %d", &epoch, &frameInterval, &detectionWidth) != 3)
+      continue;
+    this->Set(epoch, frameInterval, detectionWidth);
+  }
+  fclose(file);
+  return true;
+}
+
+
+void
+EpochPolicy
+::Set(int epoch, int frameInterval, int detectionWidth)
+{
+  if(epoch < 0 || epoch >= NUM_EPOCHS)
+  {
+    printf("Error, invalid epoch in detection budget (%i)\n", epoch);
+    return;
+  }
+
+  m_Budgets[epoch].FrameInterval = frameInterval > 1 ? frameInterval : 1;
+  m_Budgets[epoch].DetectionWidth = detectionWidth > 0 ? detectionWidth : 0;
+}
+
+
+const EpochBudget&
+EpochPolicy
+::Get(int epoch) const
+{
+  if(epoch < 0 || epoch >= NUM_EPOCHS)
+    return m_Full;
+  return m_Budgets[epoch];
+}
+
+
+void
+EpochPolicy
+::Print() const
+{
+  for(int e = 0; e < NUM_EPOCHS; e++)
+  {
+    if(m_Budgets[e].DetectionWidth > 0)
+      printf("Epoch %d: detect every %d frame(s) at up to %d pixels wide\n", e, m_Budgets[e].FrameInterval, m_Budgets[e].DetectionWidth);
+    else
+      printf("Epoch %d: detect every %d frame(s) at full detection width\n", e, m_Budgets[e].FrameInterval);
+  }
+}
@@ -0,0 +1,60 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _EpochPolicy_h
+#define _EpochPolicy_h
+
+#include "AttentionStatistics.h"
+
+/** How much detection effort one epoch gets */
+struct EpochBudget
+{
+  /** Detect on every n-th frame; the frames in between reuse the last result */
+  int FrameInterval;
+
+  /** Widest detection image to use, in pixels; 0 for the app's full detection width */
+  int DetectionWidth;
+};
+
+/** Detection effort per trial epoch. The attention decision only matters during
+Button Press and Reach, so by default those get full-rate, full-resolution detection,
+and Intertrial drops to every 4th frame on a 320 pixel wide image. A rig can override
+this with an EpochPolicy.txt of lines
+  <epoch> <frame interval> <detection width> */
+class EpochPolicy
+{
+public:
+
+  /** Constructor */
+  EpochPolicy();
+
+  /** Read budgets from a file; returns false if it can't be opened */
+  bool Load(const char* filename);
+
+  /** Change the budget of one epoch */
+  void Set(int epoch, int frameInterval, int detectionWidth);
+
+  /** Budget of an epoch; out of range epochs get full effort */
+  const EpochBudget& Get(int epoch) const;
+
+  /** One line per epoch to stdout */
+  void Print() const;
+
+protected:
+
+  EpochBudget m_Budgets[NUM_EPOCHS];
+  EpochBudget m_Full;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "FeatureDetector.h"
+
+#include "ImagePool.h"
+#include "Trace.h"
+
+FeatureDetector
+::FeatureDetector()
+{
+  m_Scaled = 0;
+  m_ImagePool = 0;
+}
+
+
+FeatureDetector
+::~FeatureDetector()
+{
+  ImagePool::Free(m_ImagePool, &m_Scaled);
+}
+
+
+void
+FeatureDetector
+::SetImagePool(ImagePool* pool)
+{
+  ImagePool::Free(m_ImagePool, &m_Scaled);
+  m_ImagePool = pool;
+}
+
+
+CvRect
+FeatureDetector
+::Detect(IplImage* gray)
+{
+  TraceScope trace(this->GetBackend());
+  double t = (double)cvGetTickCount();
+  CvRect rect = this->DetectObject(gray);
+  m_Cost.Add(((double)cvGetTickCount() - t) / (cvGetTickFrequency() * 1000.0));
+  return rect;
+}
+
+
+IplImage*
+FeatureDetector
+::ApplyInputScale(IplImage* gray)
+{
+  double inputScale = m_Parameters.InputScale;
+  if(inputScale >= 1.0)
+    return gray;
+
+  // cvGetSize() honours the ROI, so only the search area is shrunk
+  CvSize size = cvGetSize(gray);
+  CvSize scaledSize = cvSize(cvRound(size.width * inputScale), cvRound(size.height * inputScale));
+  if(m_Scaled == 0 || m_Scaled->width != scaledSize.width || m_Scaled->height != scaledSize.height)
+  {
+    ImagePool::Free(m_ImagePool, &m_Scaled);
+    m_Scaled = ImagePool::Create(m_ImagePool, scaledSize, 1);
+  }
+  cvResize(gray, m_Scaled, CV_INTER_LINEAR);
+  return m_Scaled;
+}
+
+
+CvRect
+FeatureDetector
+::UndoInputScale(CvRect rect) const
+{
+  double inputScale = m_Parameters.InputScale;
+  if(inputScale >= 1.0 || rect.width <= 0)
+    return rect;
+
+  return cvRect(cvRound(rect.x / inputScale), cvRound(rect.y / inputScale),
+    cvRound(rect.width / inputScale), cvRound(rect.height / inputScale));
+}
@@ -0,0 +1,93 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _FeatureDetector_h
+#define _FeatureDetector_h
+
+#include <string>
+
+#include <cv.h>
+
+#include "DetectionProfile.h"
+#include "LatencyStatistics.h"
+
+class ImagePool;
+
+/** Interface of a detection backend. A detector loads one model (a cascade or a
+template) and finds the biggest instance of it in a gray image. Every call is
+timed, so each backend reports what it costs per frame on this machine. */
+class FeatureDetector
+{
+public:
+
+  /** Constructor */
+  FeatureDetector();
+
+  /** Destructor */
+  virtual ~FeatureDetector();
+
+  /** Name of the backend as used in FeatureDetectors.txt, e.g. "haar" */
+  virtual const char* GetBackend() const = 0;
+
+  /** Load the model; returns false if the file can't be read */
+  virtual bool Load(const std::string& filename) = 0;
+
+  /** Find the biggest instance in a gray image, searching only its ROI if one is set.
+  The rectangle is relative to the ROI, or (-1,-1,-1,-1) if nothing was found. */
+  CvRect Detect(IplImage* gray);
+
+  /** Search settings; backends ignore what doesn't apply to them */
+  void SetParameters(const DetectionParameters& parameters) { m_Parameters = parameters; }
+  const DetectionParameters& GetParameters() const { return m_Parameters; }
+
+  /** File the model was loaded from */
+  const std::string& GetModel() const { return m_Model; }
+
+  /** The model as it was bound, which may say more than the file, e.g. "cascade.xml#4"
+  for a pruned detector; set by the registry, and empty for detectors made elsewhere */
+  void SetSpec(const std::string& spec) { m_Spec = spec; }
+  const std::string& GetSpec() const { return m_Spec; }
+
+  /** Borrow scratch images from this pool, or 0 to allocate them plainly; the ones held
+  so far are given back. The pool must outlive the detector or be unset first. */
+  virtual void SetImagePool(ImagePool* pool);
+
+  /** Milliseconds spent in Detect() per call */
+  const LatencyStatistics& GetCost() const { return m_Cost; }
+  void ResetCost() { m_Cost.Reset(); }
+
+protected:
+
+  /** The backend's search; same contract as Detect() */
+  virtual CvRect DetectObject(IplImage* gray) = 0;
+
+  /** Shrink the search area by the InputScale setting into m_Scaled; returns the image to search */
+  IplImage* ApplyInputScale(IplImage* gray);
+
+  /** Scale a rectangle found on the shrunk image back up */
+  CvRect UndoInputScale(CvRect rect) const;
+
+  std::string m_Model;
+  std::string m_Spec;
+  DetectionParameters m_Parameters;
+  LatencyStatistics m_Cost;
+
+  /** Scratch image for ApplyInputScale(), kept between frames */
+  IplImage* m_Scaled;
+
+  /** Where scratch images come from, or 0 */
+  ImagePool* m_ImagePool;
+};
+
+#endif
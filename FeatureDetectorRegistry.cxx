@@ -0,0 +1,196 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "FeatureDetectorRegistry.h"
+
+#include <stdio.h>
+
+#include "HaarFeatureDetector.h"
+#include "CascadeFeatureDetector.h"
+#include "PrunedHaarFeatureDetector.h"
+#include "TemplateFeatureDetector.h"
+#include "TiledHaarFeatureDetector.h"
+
+static FeatureDetector* CreateHaar() { return new HaarFeatureDetector; }
+static FeatureDetector* CreatePruned() { return new PrunedHaarFeatureDetector; }
+static FeatureDetector* CreateTiled() { return new TiledHaarFeatureDetector; }
+static FeatureDetector* CreateCascade() { return new CascadeFeatureDetector; }
+static FeatureDetector* CreateTemplate() { return new TemplateFeatureDetector; }
+
+
+FeatureDetectorRegistry
+::FeatureDetectorRegistry()
+{
+  m_Profile = 0;
+  m_ImagePool = 0;
+
+  this->RegisterBackend("haar", CreateHaar);
+  this->RegisterBackend("lbp", CreateCascade);
+  this->RegisterBackend("pruned", CreatePruned);
+  this->RegisterBackend("template", CreateTemplate);
+  this->RegisterBackend("tiled", CreateTiled);
+}
+
+
+FeatureDetectorRegistry
+::~FeatureDetectorRegistry()
+{
+  std::map<std::string, FeatureDetector*>::iterator it;
+  for(it = m_Bindings.begin(); it != m_Bindings.end(); ++it)
+    delete it->second;
+}
+
+
+void
+FeatureDetectorRegistry
+::RegisterBackend(const std::string& backend, FeatureDetectorCreator creator)
+{
+  m_Backends[backend] = creator;
+}
+
+
+std::vector<std::string>
+FeatureDetectorRegistry
+::GetBackends() const
+{
+  std::vector<std::string> backends;
+  std::map<std::string, FeatureDetectorCreator>::const_iterator it;
+  for(it = m_Backends.begin(); it != m_Backends.end(); ++it)
+    backends.push_back(it->first);
+  return backends;
+}
+
+
+bool
+FeatureDetectorRegistry
+::Bind(const std::string& feature, const std::string& backend, const std::string& model)
+{
+  FeatureDetector* detector = this->Create(feature, backend, model);
+  if(detector == 0)
+    return false;
+
+  delete this->Replace(feature, detector);
+  return true;
+}
+
+
+FeatureDetector*
+FeatureDetectorRegistry
+::Create(const std::string& feature, const std::string& backend, const std::string& model) const
+{
+  std::map<std::string, FeatureDetectorCreator>::const_iterator creator = m_Backends.find(backend);
+  if(creator == m_Backends.end())
+  {
+    printf("Unknown detection backend '%s' for %s\n", backend.c_str(), feature.c_str());
+    return 0;
+  }
+
+  FeatureDetector* detector = creator->second();
+  if(!detector->Load(model))
+  {
+    printf("Couldnt load %s model '%s' for %s\n", backend.c_str(), model.c_str(), feature.c_str());
+    delete detector;
+    return 0;
+  }
+  // The profile knows models by file; a backend may take more than a file name as its model
+  detector->SetSpec(model);
+  detector->SetImagePool(m_ImagePool);
+  if(m_Profile)
+    detector->SetParameters(m_Profile->Get(detector->GetModel()));
+  return detector;
+}
+
+
+void
+FeatureDetectorRegistry
+::ApplyProfile()
+{
+  if(m_Profile == 0)
+    return;
+
+  std::map<std::string, FeatureDetector*>::iterator it;
+  for(it = m_Bindings.begin(); it != m_Bindings.end(); ++it)
+    it->second->SetParameters(m_Profile->Get(it->second->GetModel()));
+}
+
+
+void
+FeatureDetectorRegistry
+::SetImagePool(ImagePool* pool)
+{
+  m_ImagePool = pool;
+
+  std::map<std::string, FeatureDetector*>::iterator it;
+  for(it = m_Bindings.begin(); it != m_Bindings.end(); ++it)
+    if(it->second)
+      it->second->SetImagePool(pool);
+}
+
+
+FeatureDetector*
+FeatureDetectorRegistry
+::Replace(const std::string& feature, FeatureDetector* detector)
+{
+  FeatureDetector*& bound = m_Bindings[feature];
+  FeatureDetector* old = bound;
+  bound = detector;
+  return old;
+}
+
+
+FeatureDetector*
+FeatureDetectorRegistry
+::Get(const std::string& feature) const
+{
+  std::map<std::string, FeatureDetector*>::const_iterator it = m_Bindings.find(feature);
+  return it == m_Bindings.end() ? 0 : it->second;
+}
+
+
+bool
+FeatureDetectorRegistry
+::Load(const char* filename)
+{
+  FILE* file = fopen(filename, "r");
+  if(file == 0)
+    return false;
+
+  char line[2048], feature[256], backend[256], model[1024];
+  while(fgets(line, sizeof(line), file))
+  {
+    if(line[0] == '#' || sscanf(line, "%255s %255s %1023s", feature, backend, model) != 3)
+      continue;
+    this->Bind(feature, backend, model);
+  }
+  fclose(file);
+  return true;
+}
+
+
+void
+FeatureDetectorRegistry
+::PrintCosts() const
+{
+  std::map<std::string, FeatureDetector*>::const_iterator it;
+  for(it = m_Bindings.begin(); it != m_Bindings.end(); ++it)
+  {
+    const FeatureDetector* detector = it->second;
+    if(detector->GetCost().GetCount() == 0)
+      continue;
+
+    char name[1024];
+    snprintf(name, sizeof(name), "%s (%s %s)", it->first.c_str(), detector->GetBackend(), detector->GetModel().c_str());
+    detector->GetCost().Print(name);
+  }
+}
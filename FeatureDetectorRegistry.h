@@ -0,0 +1,88 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _FeatureDetectorRegistry_h
+#define _FeatureDetectorRegistry_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "FeatureDetector.h"
+#include "DetectionProfile.h"
+
+/** Creates a detector of one backend */
+typedef FeatureDetector* (*FeatureDetectorCreator)();
+
+/** Knows the available detection backends and which one each tracked feature
+("FrontalFace", "LeftEye", ...) is bound to. Bindings can be changed at run time,
+and a rig picks its backends with a FeatureDetectors.txt of lines
+  <feature> <backend> <model file>
+Backends built in are "haar", "lbp", "pruned" (two-tier Haar), "tiled" (Haar split
+across cores) and "template". */
+class FeatureDetectorRegistry
+{
+public:
+
+  /** Constructor; registers the built in backends */
+  FeatureDetectorRegistry();
+
+  /** Destructor; deletes the bound detectors */
+  ~FeatureDetectorRegistry();
+
+  /** Make another backend available under a name */
+  void RegisterBackend(const std::string& backend, FeatureDetectorCreator creator);
+
+  /** Names of the available backends */
+  std::vector<std::string> GetBackends() const;
+
+  /** Bind a feature to a new detector of the backend, loading the model. The previous
+  binding is kept if the backend is unknown or the model can't be loaded. */
+  bool Bind(const std::string& feature, const std::string& backend, const std::string& model);
+
+  /** The two halves of Bind(), so the slow one can run on another thread. Create() makes
+  and loads a detector without binding it, or returns 0; it only reads the backends and
+  the profile, so it may run while the detection thread uses the bound detectors.
+  Replace() binds a detector and returns the one it replaces, or 0, for the caller to delete. */
+  FeatureDetector* Create(const std::string& feature, const std::string& backend, const std::string& model) const;
+  FeatureDetector* Replace(const std::string& feature, FeatureDetector* detector);
+
+  /** Detector bound to a feature, or 0 */
+  FeatureDetector* Get(const std::string& feature) const;
+
+  /** Read bindings from a file; returns false if it can't be opened */
+  bool Load(const char* filename);
+
+  /** Detectors bound from now on take their settings from this profile */
+  void SetProfile(const DetectionProfile* profile) { m_Profile = profile; }
+
+  /** Give the bound detectors their settings from the profile again, after it changed */
+  void ApplyProfile();
+
+  /** The bound detectors, and those created from now on, borrow their scratch images
+  from this pool; 0 for none */
+  void SetImagePool(ImagePool* pool);
+
+  /** Per-frame cost of every bound detector to stdout */
+  void PrintCosts() const;
+
+protected:
+
+  std::map<std::string, FeatureDetectorCreator> m_Backends;
+  std::map<std::string, FeatureDetector*> m_Bindings;
+  const DetectionProfile* m_Profile;
+  ImagePool* m_ImagePool;
+};
+
+#endif
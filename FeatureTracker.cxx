@@ -0,0 +1,277 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "FeatureTracker.h"
+
+#include <algorithm>
+
+FeatureTracker
+::FeatureTracker()
+{
+  m_Feature = EyePairBig;
+
+  // The subject faces an unmirrored camera, so their left eye shows up on the right of the image
+  m_MirroredCamera = false;
+
+  m_NumberOfResults = 0;
+}
+
+
+bool
+FeatureTracker
+::BindDefaultDetectors()
+{
+  bool loaded = true;
+  loaded &= this->BindDetector("LeftEye", "haar", "haarcascade_mcs_lefteye.xml");
+  loaded &= this->BindDetector("RightEye", "haar", "haarcascade_mcs_righteye.xml");
+  loaded &= this->BindDetector("EyePairSmall", "haar", "haarcascade_mcs_eyepair_small.xml");
+  loaded &= this->BindDetector("EyePairBig", "haar", "haarcascade_mcs_eyepair_big.xml");
+  loaded &= this->BindDetector("FrontalFace", "haar", "haarcascade_frontalface_default.xml");
+  loaded &= this->BindDetector("Mouth", "haar", "haarcascade_mcs_mouth.xml");
+  loaded &= this->BindDetector("Nose", "haar", "haarcascade_mcs_nose.xml");
+  return loaded;
+}
+
+
+bool
+FeatureTracker
+::BindDetector(const std::string& feature, const std::string& backend, const std::string& model)
+{
+  // The old detector goes away, and with it the results remembered for it
+  if(!m_Detectors.Bind(feature, backend, model))
+    return false;
+  m_LastDetections.clear();
+  return true;
+}
+
+
+FeatureDetector*
+FeatureTracker
+::ReplaceDetector(const std::string& feature, FeatureDetector* detector)
+{
+  m_LastDetections.clear();
+  return m_Detectors.Replace(feature, detector);
+}
+
+
+void
+FeatureTracker
+::SetFeature(int feature)
+{
+  if(feature != m_Feature)
+    m_LastDetections.clear();
+  m_Feature = feature;
+}
+
+
+const char*
+FeatureTracker
+::GetDetectorName(int feature)
+{
+  switch(feature)
+  {
+    case EyePairBig: return "EyePairBig";
+    case EyePairSmall: return "EyePairSmall";
+    case FrontalFace: return "FrontalFace";
+    case Mouth: return "Mouth";
+    case Nose: return "Nose";
+    default: return "";
+  }
+}
+
+
+bool
+FeatureTracker
+::Track(IplImage* gray)
+{
+  if(m_Feature == LeftRightEye)
+    return this->TrackEyes(gray);
+
+  FeatureDetector* detector = m_Detectors.Get(GetDetectorName(m_Feature));
+  m_NumberOfResults = 1;
+  m_Results[0] = detector ? detector->Detect(gray) : cvRect(-1,-1,-1,-1);
+  if(detector)
+    m_LastDetections[detector] = m_Results[0];
+  return m_Results[0].width > 0;
+}
+
+
+void
+FeatureTracker
+::TrackBatch(IplImage* const* grays, int count, CvRect* results)
+{
+  if(m_Feature == LeftRightEye)
+  {
+    for(int i = 0; i < count; i++)
+    {
+      this->TrackEyes(grays[i]);
+      results[2 * i] = m_Results[0];
+      results[2 * i + 1] = m_Results[1];
+    }
+    return;
+  }
+
+  FeatureDetector* detector = m_Detectors.Get(GetDetectorName(m_Feature));
+  for(int i = 0; i < count; i++)
+  {
+    results[2 * i] = detector ? detector->Detect(grays[i]) : cvRect(-1,-1,-1,-1);
+    results[2 * i + 1] = cvRect(-1,-1,-1,-1);
+  }
+
+  m_NumberOfResults = 1;
+  if(count > 0)
+  {
+    m_Results[0] = results[2 * (count - 1)];
+    if(detector)
+      m_LastDetections[detector] = m_Results[0];
+  }
+}
+
+
+bool
+FeatureTracker
+::Carry()
+{
+  if(m_Feature == LeftRightEye)
+  {
+    m_NumberOfResults = 2;
+    m_Results[0] = this->GetLastDetection(m_Detectors.Get("LeftEye"));
+    m_Results[1] = this->GetLastDetection(m_Detectors.Get("RightEye"));
+    return m_Results[0].width > 0 && m_Results[1].width > 0;
+  }
+
+  m_NumberOfResults = 1;
+  m_Results[0] = this->GetLastDetection(m_Detectors.Get(GetDetectorName(m_Feature)));
+  return m_Results[0].width > 0;
+}
+
+
+CvRect
+FeatureTracker
+::GetLastDetection(FeatureDetector* detector) const
+{
+  std::map<FeatureDetector*, CvRect>::const_iterator it = m_LastDetections.find(detector);
+  return it == m_LastDetections.end() ? cvRect(-1,-1,-1,-1) : it->second;
+}
+
+
+// Both eyes in one pass over the detection image, each searched only where it can be
+bool
+FeatureTracker
+::TrackEyes(IplImage* gray)
+{
+  FeatureDetector* leftDetector = m_Detectors.Get("LeftEye");
+  FeatureDetector* rightDetector = m_Detectors.Get("RightEye");
+
+  // Split the search area down the middle, with a small shared strip so an eye
+  // sitting on the midline is still found by its own cascade
+  CvRect region = this->EyeSearchRegion(gray);
+  int half = region.width / 2;
+  int strip = region.width / 10;
+  CvRect imageLeft = cvRect(region.x, region.y, half + strip, region.height);
+  CvRect imageRight = cvRect(region.x + half - strip, region.y, region.width - half + strip, region.height);
+
+  CvRect leftEye = this->DetectInRegion(gray, leftDetector, m_MirroredCamera ? imageLeft : imageRight);
+  CvRect rightEye = this->DetectInRegion(gray, rightDetector, m_MirroredCamera ? imageRight : imageLeft);
+
+  // Both cascades can still land on the same eye inside the shared strip; keep the bigger hit
+  if(leftEye.width > 0 && rightEye.width > 0 && intersect(leftEye, rightEye).width > 0)
+  {
+    if(leftEye.width * leftEye.height >= rightEye.width * rightEye.height)
+      rightEye = cvRect(-1,-1,-1,-1);
+    else
+      leftEye = cvRect(-1,-1,-1,-1);
+  }
+
+  if(leftDetector) m_LastDetections[leftDetector] = leftEye;
+  if(rightDetector) m_LastDetections[rightDetector] = rightEye;
+
+  // Attending means both eyes are visible
+  m_NumberOfResults = 2;
+  m_Results[0] = leftEye;
+  m_Results[1] = rightEye;
+  return leftEye.width > 0 && rightEye.width > 0;
+}
+
+
+// Where to look for the eyes, in detection image coordinates
+CvRect
+FeatureTracker
+::EyeSearchRegion(IplImage* gray)
+{
+  CvRect frame = cvRect(0, 0, gray->width, gray->height);
+  CvRect leftEye = this->GetLastDetection(m_Detectors.Get("LeftEye"));
+  CvRect rightEye = this->GetLastDetection(m_Detectors.Get("RightEye"));
+  if(leftEye.width <= 0 || rightEye.width <= 0)
+    return frame;
+
+  // Both eyes were seen last time, so the face is around them: grow the pair's box by
+  // half its width to each side and by two eye heights up and down
+  int x0 = std::min(leftEye.x, rightEye.x);
+  int y0 = std::min(leftEye.y, rightEye.y);
+  int x1 = std::max(leftEye.x + leftEye.width, rightEye.x + rightEye.width);
+  int y1 = std::max(leftEye.y + leftEye.height, rightEye.y + rightEye.height);
+  int padX = (x1 - x0) / 2;
+  int padY = 2 * std::max(leftEye.height, rightEye.height);
+  CvRect face = cvRect(x0 - padX, y0 - padY, x1 - x0 + 2 * padX, y1 - y0 + 2 * padY);
+
+  face = intersect(face, frame);
+  return face.width > 0 ? face : frame;
+}
+
+
+// Run a detector on part of the image; the result is in full image coordinates
+CvRect
+FeatureTracker
+::DetectInRegion(IplImage* gray, FeatureDetector* detector, CvRect region)
+{
+  if(detector == 0)
+    return cvRect(-1,-1,-1,-1);
+
+  cvSetImageROI(gray, region);
+  CvRect rc = detector->Detect(gray);
+  cvResetImageROI(gray);
+
+  if(rc.width > 0)
+  {
+    rc.x += region.x;
+    rc.y += region.y;
+  }
+  return rc;
+}
+
+
+CvRect
+FeatureTracker
+::intersect(CvRect r1, CvRect r2) 
+{ 
+    CvRect intersection; 
+    
+    // find overlapping region 
+    intersection.x = (r1.x < r2.x) ? r2.x : r1.x; 
+    intersection.y = (r1.y < r2.y) ? r2.y : r1.y; 
+    intersection.width = (r1.x + r1.width < r2.x + r2.width) ? 
+        r1.x + r1.width : r2.x + r2.width; 
+    intersection.width -= intersection.x; 
+    intersection.height = (r1.y + r1.height < r2.y + r2.height) ? 
+        r1.y + r1.height : r2.y + r2.height; 
+    intersection.height -= intersection.y;     
+    
+    // check for non-overlapping regions 
+    if ((intersection.width <= 0) || (intersection.height <= 0)) { 
+        intersection = cvRect(0, 0, 0, 0); 
+    } 
+    
+    return intersection; 
+}
@@ -0,0 +1,107 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _FeatureTracker_h
+#define _FeatureTracker_h
+
+#include <map>
+
+#include <cv.h>
+
+#include "FeatureDetectorRegistry.h"
+
+/** Finds the selected feature in a gray detection image with whichever detectors are
+bound to it. This is the detection half of FinalProjectApp without the camera, display
+or log, so batch tools can run exactly what the app runs. Not thread safe: use one
+tracker per thread. */
+class FeatureTracker
+{
+public:
+
+  /** Feature numbers as written to the log */
+  enum Feature { EyePairBig = 1, EyePairSmall, FrontalFace, LeftRightEye, Mouth, Nose };
+
+  /** Constructor */
+  FeatureTracker();
+
+  /** Bind every feature to its stock Haar cascade; returns false if one can't be loaded */
+  bool BindDefaultDetectors();
+
+  /** Bind a feature to a backend and model; see FeatureDetectorRegistry::Bind() */
+  bool BindDetector(const std::string& feature, const std::string& backend, const std::string& model);
+
+  /** Bind an already loaded detector; returns the one it replaces, or 0, for the caller to delete */
+  FeatureDetector* ReplaceDetector(const std::string& feature, FeatureDetector* detector);
+
+  /** The detectors and available backends */
+  FeatureDetectorRegistry& GetDetectors() { return m_Detectors; }
+
+  /** Feature to look for; changing it forgets the previous results */
+  void SetFeature(int feature);
+  int GetFeature() const { return m_Feature; }
+
+  /** True if the camera image is mirrored, putting the subject's left eye on the left of the image */
+  void SetMirroredCamera(bool mirrored) { m_MirroredCamera = mirrored; }
+
+  /** Search the gray detection image; returns true if the feature was found */
+  bool Track(IplImage* gray);
+
+  /** Track() over a batch of gray detection images in order. This is the same work as
+  calling Track() on each; it only saves anything when the caller interleaves several
+  features, so that one cascade sweeps the batch before the next is loaded. results gets two rectangles per image, of which the first GetNumberOfResults() are
+  used; afterwards the tracker holds the last image's results. Left/right eye mode
+  searches where the previous image's eyes were, so it still goes image by image. */
+  void TrackBatch(IplImage* const* grays, int count, CvRect* results);
+
+  /** Repeat the last results instead of searching, e.g. when nothing moved */
+  bool Carry();
+
+  /** Rectangles of the last Track() or Carry() in detection image coordinates, one per
+  detector the feature uses; a rectangle without width was not found */
+  int GetNumberOfResults() const { return m_NumberOfResults; }
+  CvRect GetResult(int i) const { return m_Results[i]; }
+
+  /** Last search result of each detector */
+  const std::map<FeatureDetector*, CvRect>& GetLastDetections() const { return m_LastDetections; }
+  void ForgetLastDetections() { m_LastDetections.clear(); }
+
+  /** Name of the detector binding used for a feature number; left/right eye mode uses "LeftEye" and "RightEye" */
+  static const char* GetDetectorName(int feature);
+
+  /**  Check to make sure two eye regions are not the same one.  From http://opencv-users.1802565.n2.nabble.com/cvRect-overlap-td3836140.html */
+  static CvRect intersect(CvRect r1, CvRect r2);
+
+protected:
+
+  /** Left/right eye mode in a single pass: each eye is searched only in its half of the
+  frame (or of the face found last time), and overlapping hits are rejected with intersect() */
+  bool TrackEyes(IplImage* gray);
+  CvRect EyeSearchRegion(IplImage* gray);
+  CvRect DetectInRegion(IplImage* gray, FeatureDetector* detector, CvRect region);
+
+  /** Last result of a detector, or not found */
+  CvRect GetLastDetection(FeatureDetector* detector) const;
+
+  FeatureDetectorRegistry m_Detectors;
+  int m_Feature;
+  bool m_MirroredCamera;
+
+  /** Result of the last search for each detector, in detection image coordinates */
+  std::map<FeatureDetector*, CvRect> m_LastDetections;
+
+  int m_NumberOfResults;
+  CvRect m_Results[2];
+};
+
+#endif
@@ -15,9 +15,14 @@
 
 #include <time.h>
 #include "FinalProjectApp.h"
+#include <QThread>
 #include <string.h>
 #include <itkArray.h>
 #include <random>
+#include <algorithm>
+
+#include "PixelKernels.h"
+#include "Trace.h"
 
 FinalProjectApp
 ::FinalProjectApp()
@@ -26,44 +31,65 @@ FinalProjectApp
 
   // Initialize OpenCV things to null
   m_CameraImageOpenCV = 0;
-  m_OpenCVCapture = 0;
-
-  // We know the image size in advance. A better implementation would be
-  // to set this only after connecting to the camera and checking the
-  // actual image size.
-  m_ImageWidth = 640;
-  m_ImageHeight = 480;
+  m_FrameSource = 0;
+  m_LumaFrame = 0;
+
+  // Ask for a full HD stream for recording and display. The camera tells us
+  // what it really delivers in SetupCamera(), which is when the buffers are sized.
+  m_RequestedWidth = 1920;
+  m_RequestedHeight = 1080;
+  m_ImageWidth = m_RequestedWidth;
+  m_ImageHeight = m_RequestedHeight;
   m_NumPixels = m_ImageWidth * m_ImageHeight;
 
-  // Buffers to hold raw image data
-  m_CameraFrameRGBBuffer = new unsigned char[m_NumPixels*3];
-  m_TempRGBABuffer = new unsigned char[m_NumPixels*4];
-
   // Not yet connected to a camera
   m_ConnectedToCamera = false;
 
+  // Session video is opt-in; it needs disk space and an encoder core
+  m_RecordingEnabled = false;
+  m_RecordingSegment = 0;
+
+  // Process frames as they arrive; the timer then only runs a watchdog
+  m_EventDriven = true;
+  m_CaptureThread = 0;
+  m_Timer = 0;
+  m_DetectorWatcher = 0;
+  m_WatchdogInterval = 500;
+  m_LastFrameTime = 0;
+  m_LastDecisionTime = 0;
+
   // Filter parameter
   m_Threshold = 40;
-  m_EyePairBigEnabled = true;
   updateAttentionBar(m_Threshold);
 
   m_FilterEnabled = false;
 
-  //Start the counter
-  m_attentionCounter = 0;
-
-  // Load whichever Haar cascades we'll need so we don't have to read from file for every frame
-  m_HaarLeftEye = LoadHaarCascade("haarcascade_mcs_lefteye.xml");
-  m_HaarRightEye = LoadHaarCascade("haarcascade_mcs_righteye.xml");
-  m_HaarEyePairSmall = LoadHaarCascade("haarcascade_mcs_eyepair_small.xml");
-  m_HaarEyePairBig = LoadHaarCascade("haarcascade_mcs_eyepair_big.xml");
-  m_HaarFrontalFace = LoadHaarCascade("haarcascade_frontalface_default.xml");
-  m_HaarMouth = LoadHaarCascade("haarcascade_mcs_mouth.xml");
-  m_HaarNose = LoadHaarCascade("haarcascade_mcs_nose.xml");
+  // Detection settings, cascades, backend bindings and epoch budgets, all loaded up front
+  // so we don't have to read from file for every frame
+  if(!m_Attention.Initialize())
+    exit(1);
+  m_Attention.SetThreshold(m_Threshold);
+  m_Attention.GetEpochPolicy().Print();
+
+  // Later detector changes are loaded in the background
+  m_DetectorLoader = new DetectorLoader(m_Attention.GetTracker().GetDetectors());
+
+  // Pinning and priorities of the pipeline threads; each thread applies its own when it starts
+  if(m_ThreadPolicy.Load("ThreadPolicy.txt"))
+    m_ThreadPolicy.Print();
+  m_BufferPool.SetLockMemory(m_ThreadPolicy.GetLockMemory());
+  m_Attention.SetImagePool(&m_BufferPool);
+  m_Recorder = new SessionRecorder();
+  m_Recorder->SetThreadPolicy(&m_ThreadPolicy);
+  m_Recorder->SetImagePool(&m_BufferPool);
 
   // Initialize a log file with hard coded headers
   m_logFile = fopen("Log File.csv","w");
-  fprintf(m_logFile, "%s,%s,%s,%s,%s\n", "Time", "Trial", "Feature", "Detect", "Epoch");
+  fprintf(m_logFile, "%s,%s,%s,%s,%s,%s,%s,%s\n", "Time", "Trial", "Feature", "Detect", "Epoch", "Carried", "Interval", "Width");
+
+  // Per-trial summaries go to their own file so nobody has to rescan the frame log
+  m_SummaryFile = fopen("Trial Summary.csv","w");
+  AttentionStatistics::WriteHeader(m_SummaryFile);
 
   // Initialize the frame index for the arrays
   m_frame = 0;
@@ -75,15 +101,14 @@ FinalProjectApp
   m_Feature = new int [TotalFrames];
   m_Detect = new int [TotalFrames];
   m_Epoch = new int [TotalFrames];
-  m_CurrentEpoch = 0;
-  m_CurrentFeature = 1; //This is overrided with -1 if tracking is not enabled
+  m_Carried = new int [TotalFrames];
+  m_Interval = new int [TotalFrames];
+  m_Width = new int [TotalFrames];
   m_QTime.start();
-  m_CurrentTrial = 0;
-  m_SuccessfulTrials = 0;
-  m_FailedTrials = 0;
 
-  //initialize random number seed to randomly advance the Epoch
-  srand( time(NULL) );
+  // The trial schedule advances the epochs once the app is set up
+  connect(&m_Scheduler, SIGNAL( AdvanceEpoch(int) ), this, SLOT( AdvanceTrialEpoch(int) ));
+  connect(&m_Scheduler, SIGNAL( Finished() ), this, SLOT( OnScheduleFinished() ));
 }
 
 
@@ -92,28 +117,60 @@ FinalProjectApp
 {
   std::cout << "In FinalProjectApp destructor" << std::endl;
 
+  // Drops loads still queued; their detectors were never bound
+  delete m_DetectorLoader;
+
+  // Let the encoders finish the queued frames
+  delete m_Recorder;
+  for(size_t r = 0; r < m_FinishingRecorders.size(); r++)
+    delete m_FinishingRecorders[r];
+
+  // Compare these between event and timer driven runs
+  const char* mode = m_EventDriven ? "event driven" : "timer driven";
+  std::cout << "Frame processing was " << mode << std::endl;
+  m_GrabWait.Print("Wait for the driver in the grab");
+  m_CaptureLatency.Print("Capture to decision latency");
+  m_DecisionInterval.Print("Interval between decisions");
+
+  // Compare backends before binding them on a rig
+  m_Attention.GetTracker().GetDetectors().PrintCosts();
+
+  // Compare these between builds replaying the same schedule
+  m_Scheduler.Stop();
+  this->PrintRunSummary();
+
   if(m_ConnectedToCamera)
   {
     std::cout << "In FinalProjectApp destructor: disconnecting camera" << std::endl;
     this->DisconnectCamera();
   }
 
+  // Preemptions and CPU waits per thread show whether the isolation works
+  m_ThreadPolicy.PrintReport();
+
   // Automatically save a log file upon exiting the program
   SaveLog();
 
-  delete[] m_CameraFrameRGBBuffer;
-  delete[] m_TempRGBABuffer;
+  // Hand the frame buffers back before the pool goes away
+  m_BufferPool.Release(m_LumaFrame);
+  m_BufferPool.PrintStatistics();
 
   delete[] m_TimeStamp;
   delete[] m_Trial;
   delete[] m_Feature;
   delete[] m_Detect;
   delete[] m_Epoch;
+  delete[] m_Carried;
+  delete[] m_Interval;
+  delete[] m_Width;
 
   // Append feature definitions and Epoch numbers to the log file
   fprintf(m_logFile, "\n%s,\t%s,\t%s,\t%s,\t%s,\t%s", "bigEyePair = 1", "smallEyePair = 2", "frontalFace = 3", "leftRightEye = 4", "mouth = 5", "nose = 6");
   fprintf(m_logFile, "\n%s,\t%s,\t%s","Epoch 0 = Intertrial", "Epoch 1 = Button Press", "Epoch 2 = Reach");
+  fprintf(m_logFile, "\n%s,\t%s", "Carried 0 = Detected this frame", "Carried 1 = Previous detection reused (no motion, or between budgeted frames)");
+  fprintf(m_logFile, "\n%s,\t%s", "Interval n = Epoch budget detects every n-th frame", "Width = Detection image width in pixels");
   fclose(m_logFile);
+  fclose(m_SummaryFile);
 }
 
 
@@ -121,8 +178,222 @@ void
 FinalProjectApp
 ::SetupApp()
 {
+  // Detection, attention and the frame log run on the thread that calls this
+  m_ThreadPolicy.Apply(DetectionThreadRole);
+  TraceThreadName("app");
+
+  this->SetupSchedule();
+
   if( this->SetupCamera() )
+  {
+    this->AllocateFrameBuffers();
     this->SetupITKPipeline();
+    this->SetRecordingEnabled(m_RecordingEnabled);
+
+    // Let the camera drive processing
+    if(m_EventDriven)
+    {
+      m_CaptureThread = new CaptureThread(m_FrameSource);
+      m_CaptureThread->SetThreadPolicy(&m_ThreadPolicy);
+      m_CaptureThread->SetImagePool(&m_BufferPool);
+      connect(m_CaptureThread, SIGNAL( FrameArrived() ), this, SLOT( OnFrameArrived() ));
+      m_LastFrameTime = (double)cvGetTickCount();
+      m_CaptureThread->start();
+    }
+  }
+
+  // Detectors are swapped without stopping, when asked to or when FeatureDetectors.txt is saved
+  m_DetectorLoader->start(QThread::LowPriority);
+  m_DetectorWatcher = new QFileSystemWatcher(this);
+  m_DetectorWatcher->addPath("FeatureDetectors.txt");
+  connect(m_DetectorWatcher, SIGNAL( fileChanged(const QString&) ), this, SLOT( ReloadDetectors() ));
+
+  // Created here so it fires on the app's thread, not the GUI's. Event driven, new
+  // frames trigger processing and the timer only checks that they keep coming.
+  m_Timer = new QTimer(this);
+  connect(m_Timer, SIGNAL( timeout() ), this, SLOT( RealtimeUpdate() ));
+  m_Timer->start(m_EventDriven ? 500 : 33);
+}
+
+
+bool
+FinalProjectApp
+::QueueCommand(int type, int value)
+{
+  if(QThread::currentThread() == this->thread())
+    return false;
+
+  QMutexLocker lock(&m_CommandProducerMutex);
+  if(!m_Commands.Push(type, value))
+    std::cout << "Command queue full, dropping command " << type << std::endl;
+  return true;
+}
+
+
+void
+FinalProjectApp
+::ExecuteCommands()
+{
+  Command command;
+  while(m_Commands.Pop(command))
+  {
+    switch(command.Type)
+    {
+      case ApplyFilterCommand: this->SetApplyFilter(command.Value != 0); break;
+      case ThresholdCommand: this->SetThreshold(command.Value); break;
+      case FeatureCommand: this->SetFeature(command.Value); break;
+      case MotionGateCommand: this->SetMotionGateEnabled(command.Value != 0); break;
+      case RecordingCommand: this->SetRecordingEnabled(command.Value != 0); break;
+      case SaveLogCommand: this->SaveLog(); break;
+      case AdvanceEpochCommand: this->AdvanceTrialEpoch(command.Value); break;
+    }
+  }
+
+  // Recorders of finished segments are released once their encoders have closed the files
+  for(size_t r = 0; r < m_FinishingRecorders.size(); )
+  {
+    if(m_FinishingRecorders[r]->IsFinished())
+    {
+      delete m_FinishingRecorders[r];
+      m_FinishingRecorders.erase(m_FinishingRecorders.begin() + r);
+    }
+    else
+      r++;
+  }
+
+  // Between frames nothing uses the old detectors, so they can go right away
+  std::string feature;
+  while(FeatureDetector* detector = m_DetectorLoader->TakeLoaded(feature))
+  {
+    printf("Swapped in the %s detector for %s\n", detector->GetBackend(), feature.c_str());
+    delete m_Attention.ReplaceDetector(feature.c_str(), detector);
+  }
+}
+
+
+void
+FinalProjectApp
+::ReplaceDetector(const QString& feature, const QString& backend, const QString& model)
+{
+  // Warm up at the size the detectors will see; the size travels with the request
+  CvSize warmUpSize = cvSize(640, 480);
+  if(m_Attention.GetDetectionWidth() > 0)
+    warmUpSize = AttentionTracker::GetDetectionSize(cvSize(m_ImageWidth, m_ImageHeight), m_Attention.GetDetectionWidth());
+  m_DetectorLoader->Request(feature.toStdString(), backend.toStdString(), model.toStdString(), warmUpSize);
+}
+
+
+void
+FinalProjectApp
+::ReloadDetectors()
+{
+  // Editors often save by replacing the file, which ends the watch on it
+  if(m_DetectorWatcher && m_DetectorWatcher->files().empty())
+    m_DetectorWatcher->addPath("FeatureDetectors.txt");
+
+  FILE* file = fopen("FeatureDetectors.txt", "r");
+  if(file == 0)
+    return;
+
+  // Same format as FeatureDetectorRegistry::Load(); only changed bindings are reloaded
+  char line[2048], feature[256], backend[256], model[1024];
+  while(fgets(line, sizeof(line), file))
+  {
+    if(line[0] == '#' || sscanf(line, "%255s %255s %1023s", feature, backend, model) != 3)
+      continue;
+
+    FeatureDetector* bound = m_Attention.GetTracker().GetDetectors().Get(feature);
+    // Compared as bound: a pruned or tiled detector's file alone drops the "#K" part
+    if(bound && bound->GetSpec() == model && strcmp(bound->GetBackend(), backend) == 0)
+      continue;
+    this->ReplaceDetector(feature, backend, model);
+  }
+  fclose(file);
+}
+
+
+void
+FinalProjectApp
+::SetEventDriven(bool eventDriven)
+{
+  m_EventDriven = eventDriven;
+}
+
+
+void
+FinalProjectApp
+::SetRunOptions(const RunOptions& options)
+{
+  m_RunOptions = options;
+  m_EventDriven = options.EventDriven;
+  m_Attention.SetRequiredHitRate(options.RequiredHitRate);
+}
+
+
+void
+FinalProjectApp
+::SetupSchedule()
+{
+  // Replay a schedule, or make one up from a seed; either way the schedule of this
+  // run is written out so it can be replayed exactly
+  if(!m_RunOptions.Schedule.empty() && m_Scheduler.Load(m_RunOptions.Schedule.c_str()))
+    std::cout << "Replaying trial schedule " << m_RunOptions.Schedule << std::endl;
+  else
+  {
+    if(!m_RunOptions.Schedule.empty())
+      std::cout << "Couldnt read trial schedule " << m_RunOptions.Schedule << ", generating one" << std::endl;
+
+    unsigned int seed = m_RunOptions.Seed ? m_RunOptions.Seed : (unsigned int)time(NULL);
+    double duration = m_RunOptions.Duration > 0 ? m_RunOptions.Duration : 24 * 3600;
+    m_Scheduler.Generate(seed, duration);
+    std::cout << "Generated trial schedule from seed " << seed << std::endl;
+  }
+  m_Scheduler.Save("Trial Schedule.txt");
+
+  std::cout << m_Scheduler.GetNumberOfEvents() << " epoch changes over "
+            << m_Scheduler.GetDuration() << " s" << std::endl;
+  m_Scheduler.Start();
+}
+
+
+void
+FinalProjectApp
+::OnScheduleFinished()
+{
+  std::cout << "Trial schedule finished" << std::endl;
+  this->PrintRunSummary();
+  emit RunFinished();
+}
+
+
+void
+FinalProjectApp
+::PrintRunSummary()
+{
+  std::cout << "Trials: " << m_Attention.GetSuccessfulTrials() << " successful, "
+            << m_Attention.GetFailedTrials() << " failed" << std::endl;
+  m_Scheduler.GetLateness().Print("Epoch change lateness");
+}
+
+
+void
+FinalProjectApp
+::AllocateFrameBuffers()
+{
+  // Give back buffers sized for a previous geometry
+  m_BufferPool.Release(m_LumaFrame);
+  m_LumaFrame = 0;
+
+  m_NumPixels = m_ImageWidth * m_ImageHeight;
+  CvSize size = cvSize(m_ImageWidth, m_ImageHeight);
+
+  // Only YUYV luma has to be copied out of the frame
+  if(m_FrameSource && m_FrameSource->GetPixelFormat() == FrameSource::YuyvFormat)
+    m_LumaFrame = m_BufferPool.Acquire(size, 1);
+
+  std::cout << "Capturing at " << m_ImageWidth << "x" << m_ImageHeight
+            << ", detecting at most " << m_Attention.GetMaxDetectionWidth() << " wide" << std::endl;
+  std::cout << "Pixel kernels: " << GetPixelKernels().Name << std::endl;
 }
 
 
@@ -130,15 +401,53 @@ bool
 FinalProjectApp
 ::SetupCamera()
 {
-  // Try to get any open camera
-  m_OpenCVCapture = cvCaptureFromCAM(CV_CAP_ANY);
+  // Recorded or synthetic frames stand in for the camera in load tests
+  if(!m_RunOptions.Video.empty())
+  {
+    VideoFrameSource* video = new VideoFrameSource(m_RunOptions.Video);
+    if(video->IsOpen())
+      m_FrameSource = video;
+    else
+    {
+      std::cout << "Couldnt open video " << m_RunOptions.Video << std::endl;
+      delete video;
+    }
+  }
+  else if(m_RunOptions.Synthetic)
+    m_FrameSource = new SyntheticFrameSource(m_RequestedWidth, m_RequestedHeight, 30.0,
+      m_RunOptions.Seed ? m_RunOptions.Seed : 1);
+  else
+  {
+    // Try to get any open camera
+    CameraFrameSource* camera = new CameraFrameSource(m_RequestedWidth, m_RequestedHeight);
+    if(camera->IsOpen())
+      m_FrameSource = camera;
+    else
+      delete camera;
+  }
 
   // Proceed if we found a camera
-  if(m_OpenCVCapture != 0)
+  if(m_FrameSource != 0)
   {
-    // Set the width and height of the camera image
-    cvSetCaptureProperty(m_OpenCVCapture, CV_CAP_PROP_FRAME_HEIGHT, m_ImageHeight); 
-    cvSetCaptureProperty(m_OpenCVCapture, CV_CAP_PROP_FRAME_WIDTH, m_ImageWidth);
+    // Detection only needs the Y plane; sources that can't deliver it on its own stay BGR
+    if(m_RunOptions.LumaOnly && !m_FrameSource->SetLumaOnly(true))
+      std::cout << "The " << m_FrameSource->GetDescription() << " only delivers BGR, detecting on converted frames" << std::endl;
+
+    // The first frame tells us what size the camera agreed to
+    IplImage* firstFrame = m_FrameSource->QueryFrame();
+    if(firstFrame)
+    {
+      CvSize picture = FrameSource::GetPictureSize(firstFrame, m_FrameSource->GetPixelFormat());
+      m_ImageWidth = picture.width;
+      m_ImageHeight = picture.height;
+    }
+
+    static const char* formats[] = { "BGR", "gray", "YUYV", "NV12" };
+    std::cout << "Frames from " << m_FrameSource->GetDescription()
+              << " as " << formats[m_FrameSource->GetPixelFormat()] << std::endl;
+    if(m_ImageWidth != (unsigned int)m_RequestedWidth || m_ImageHeight != (unsigned int)m_RequestedHeight)
+      std::cout << "Asked the camera for " << m_RequestedWidth << "x" << m_RequestedHeight
+                << ", got " << m_ImageWidth << "x" << m_ImageHeight << std::endl;
 
     // Succesfully opened the camera
     m_ConnectedToCamera = true;
@@ -152,110 +461,165 @@ void
 FinalProjectApp
 ::DisconnectCamera()
 {
+  // The capture thread must be done with the camera first
+  if(m_CaptureThread)
+  {
+    m_CaptureThread->Stop();
+    delete m_CaptureThread;
+    m_CaptureThread = 0;
+  }
+
   // Free the video capture object
-  cvReleaseCapture(&m_OpenCVCapture); 
+  delete m_FrameSource;
+  m_FrameSource = 0;
 }
 
 void
 FinalProjectApp
 ::RealtimeUpdate()
 {
+  this->ExecuteCommands();
+
+  // When frames announce themselves, the timer only keeps watch over the camera
+  if(m_CaptureThread)
+  {
+    double silence = ((double)cvGetTickCount() - m_LastFrameTime) / (cvGetTickFrequency() * 1000.0);
+    if(silence > m_WatchdogInterval)
+      printf("Watchdog: no frame from the camera for %.0f ms\n", silence);
+    return;
+  }
+
   // If we're talking to the camera, we can do the cool stuff
   if(m_ConnectedToCamera)
   {
-    // Snap an image from the webcam
-    m_CameraImageOpenCV = cvQueryFrame(m_OpenCVCapture);
+    // Snap an image from the webcam. This waits for the driver, up to a frame period
+    // depending on where the tick falls against the camera's clock.
+    double grabStart = (double)cvGetTickCount();
+    IplImage* frame = m_FrameSource->QueryFrame();
+    double captureTime = (double)cvGetTickCount();
 
     // Did the capture fail?
-    if(m_CameraImageOpenCV == NULL)
+    if(frame == NULL)
       return;
 
-	/*  RGB extraction is not necessary for our purposes.  Keeping code just in case.
-    // Extract RGB data from captured image
-    unsigned char * openCVBuffer = (unsigned char*)(m_CameraImageOpenCV->imageData);
+    this->ProcessFrame(frame, grabStart, captureTime);
+  }
+}
 
-    // Store the RGB data in our local buffer
-    for(int b = 0; b < m_NumPixels * 3; b++)
-    {
-      m_CameraFrameRGBBuffer[b] = openCVBuffer[b];
-    }
-	
 
-    // Update the ITK image
-    this->CopyImageToITK();
-	*/
-    if(m_FilterEnabled)
-    {
-		  //Determine which radiobutton is selected and track appropriately
-		  if(m_EyePairBigEnabled)
-		  {
-			  CvRect m_EyePairBig = TrackFeature(m_CameraImageOpenCV, m_HaarEyePairBig);
-		  }
-		  else if(m_EyePairSmallEnabled)
-		  {
-			  CvRect m_EyePairSmall = TrackFeature(m_CameraImageOpenCV, m_HaarEyePairSmall);
-		  }
-		  else if(m_FrontalFaceEnabled)
-		  {
-			  CvRect m_FrontalFace = TrackFeature(m_CameraImageOpenCV, m_HaarFrontalFace);
-		  }
-		  else if(m_LeftRightEyeEnabled)
-		  {
-			  CvRect m_LeftEye = TrackFeature(m_CameraImageOpenCV, m_HaarLeftEye);
-			  CvRect m_RightEye = TrackFeature(m_CameraImageOpenCV, m_HaarRightEye);
-		  }
-		  else if(m_MouthEnabled)
-		  {
-			  CvRect m_Mouth = TrackFeature(m_CameraImageOpenCV, m_HaarMouth);
-		  }
-		  else if(m_NoseEnabled)
-		  {
-			  CvRect m_Nose = TrackFeature(m_CameraImageOpenCV, m_HaarNose);
-		  }
-		
+void
+FinalProjectApp
+::OnFrameArrived()
+{
+  this->ExecuteCommands();
 
-		  QImage processedImage = *IplImage2QImage(m_CameraImageOpenCV);
-		  emit SendImage( processedImage );
-		  emit updateAttentionBar( m_attentionCounter );
-		  m_Feature[m_frame] = m_CurrentFeature;
-    }
+  double grabStart, captureTime;
+  IplImage* frame = m_CaptureThread->TakeLatestFrame(&grabStart, &captureTime);
+  if(frame == 0)
+    return;
 
-    else
-    {
+  this->ProcessFrame(frame, grabStart, captureTime);
+}
+
+
+void
+FinalProjectApp
+::ProcessFrame(IplImage* frame, double grabStart, double captureTime)
+{
+  TraceScope trace("frame", m_frame);
+  m_CameraImageOpenCV = frame;
+
+  // The camera may not deliver the size we asked for; follow whatever it sends
+  CvSize picture = FrameSource::GetPictureSize(frame, m_FrameSource->GetPixelFormat());
+  if(picture.width != (int)m_ImageWidth || picture.height != (int)m_ImageHeight)
+  {
+    m_ImageWidth = picture.width;
+    m_ImageHeight = picture.height;
+    this->AllocateFrameBuffers();
+    this->SetupITKPipeline();
+
+    // The video file can only hold one frame size
+    if(m_Recorder->IsRecording())
+      this->SetRecordingEnabled(true);
+  }
+
+  // Luma frames are detected and recorded as their Y plane; BGR frames as they are
+  TraceEvent("luma", 'B');
+  IplImage* ingest = FrameSource::GetLuma(frame, m_FrameSource->GetPixelFormat(), &m_LumaHeader, m_LumaFrame);
+  TraceEvent("luma", 'E');
+
+  // Queue the raw frame for the recorder; detections are only ever drawn on the preview
+  if(m_Recorder->IsRecording())
+    m_Recorder->PushFrame(ingest);
+
+  // Seconds since the app started, for the log and the trial statistics
+  double time = ((double)m_QTime.elapsed())/1000;
+
+  if(m_FilterEnabled)
+  {
+		  //Track the selected feature with whichever detectors are bound to it
+		  TrackFeature(ingest, time);
+
+		  this->PublishPreview(frame);
+		  emit updateAttentionBar( m_Attention.GetAttention() );
+		  m_Feature[m_frame] = m_Attention.GetFeature();
+  }
+
+  else
+  {
 		
-      // Signify with -1 that no tracking is being conducted
-      m_Detect[m_frame] = -1;
+    // Signify with -1 that no tracking is being conducted
+    m_Detect[m_frame] = -1;
 	    m_Feature[m_frame] = -1;
-	    
-      // Log for the attention bar
-      if(m_attentionCounter >0) {
-				m_attentionCounter--;
-			}
+    m_Carried[m_frame] = 0;
+    m_Interval[m_frame] = 0;
+    m_Width[m_frame] = 0;
+
+    // Log for the attention bar; this also forces a fresh detection once tracking is switched back on
+    m_Attention.AddDecision(-1, time);
 		  
-      QImage processedImage = *IplImage2QImage(m_CameraImageOpenCV);
-		  // Send a copy of the image out via signals/slots
-		  emit SendImage( processedImage );
-		  emit updateAttentionBar( m_attentionCounter );
-    }
+    this->PublishPreview(frame);
+		  emit updateAttentionBar( m_Attention.GetAttention() );
+  }
 
-    // Within capture image but outside filter if statement
-    m_Trial[m_frame] = m_CurrentTrial;
-    m_Epoch[m_frame] = m_CurrentEpoch;
+  // Within capture image but outside filter if statement
+  m_Trial[m_frame] = m_Attention.GetTrial();
+  m_Epoch[m_frame] = m_Attention.GetEpoch();
 	
-	  m_TimeStamp[m_frame] = ((double)m_QTime.elapsed())/1000;
-    
-    // Create a frame index, make sure we don't overwrite the 
-    if(m_frame > 9998) SaveLog(); //m_frame will be reset to zero inside SaveLog()
+	  m_TimeStamp[m_frame] = time;
+  
+  // Create a frame index, make sure we don't overwrite the 
+  if(m_frame > 9998) SaveLog(); //m_frame will be reset to zero inside SaveLog()
 	  
-    // Proceed to the next frame index
-    else m_frame++;
-  }
- 
-  /** Randomly advance to the next Epoch.  This will be replaced by signals from 
-  the external controller program, but for now we want to make sure it's working **/
-  if(rand() % 10 == 1)AdvanceTrialEpoch( (m_CurrentEpoch+1)%3 ); 
-  // 10% chance to advance, set nextEpoch to next value, wrap from 2->0
+  // Proceed to the next frame index
+  else m_frame++;
+
+  // The attention decision for this frame is made; see how long it took since capture
+  double now = (double)cvGetTickCount();
+  double ticksPerMillisecond = cvGetTickFrequency() * 1000.0;
+  m_GrabWait.Add((captureTime - grabStart) / ticksPerMillisecond);
+  m_CaptureLatency.Add((now - captureTime) / ticksPerMillisecond);
+  if(m_LastDecisionTime > 0)
+    m_DecisionInterval.Add((now - m_LastDecisionTime) / ticksPerMillisecond);
+  m_LastDecisionTime = now;
+  m_LastFrameTime = captureTime;
+}
 
+
+void
+FinalProjectApp
+::SetRequestedCaptureSize(int width, int height)
+{
+  m_RequestedWidth = width;
+  m_RequestedHeight = height;
+}
+
+
+void
+FinalProjectApp
+::SetMaxDetectionWidth(int width)
+{
+  m_Attention.SetMaxDetectionWidth(width);
 }
 
 
@@ -302,218 +666,177 @@ FinalProjectApp
 }
 
 
+// The radio button functions to choose the tracked feature
 void
 FinalProjectApp
-::CopyImageToITK()
+::SetApplyFilter(bool useFilter)
 {
-  // Create the iterator
-  itk::ImageRegionIterator<ImageType> it = 
-    itk::ImageRegionIterator<ImageType>(m_Image, m_Image->GetLargestPossibleRegion() );
+  if(this->QueueCommand(ApplyFilterCommand, useFilter))
+    return;
 
-  // Move iterator to the start of the ITK image
-  it.GoToBegin();
-
-  unsigned int linearByteIndex = 0;
-  double r, g, b;
-
-  for(int p = 0; p < m_NumPixels; p++)
-  {
-    r = (double)(m_CameraFrameRGBBuffer[linearByteIndex]);
-    linearByteIndex++;
-    g = (double)(m_CameraFrameRGBBuffer[linearByteIndex]);
-    linearByteIndex++;
-    b = (double)(m_CameraFrameRGBBuffer[linearByteIndex]);
-    linearByteIndex++;
-    
-    /*Convert from RGB to grayscale
-      If you're wondering why the scale factors are the way they are, the answer
-      is that it's just one possible weighting. "Correct" perceptual values
-      depend on the interaction of camera and human eye response and 
-      will vary from individual to individual and camera to camera.
-
-      As an additional note, the OpenCV image is actually storing color data,
-      and the FLTK display image (see app.h/app.cxx) is capable of displaying
-      color data. I'm discarding it when copying to the ITK image because
-      grayscale data is easier to work with. If you want to do a project
-      involving color data, keep in mind that it's already here. You just
-      have to use it - nothing will change in the capture code. */
-    unsigned char grayscale = (unsigned char)(0.3*r + 0.59*g + 0.11*b);
-    it.Set(grayscale);
-
-    // Move to next ITK pixel
-    ++it;
-  }
+  m_FilterEnabled = useFilter;
 }
 
-
- QImage
- FinalProjectApp
-::RGBBufferToQImage(unsigned char* buffer)
+void
+FinalProjectApp
+::SetMotionGateEnabled(bool enabled)
 {
-  unsigned int rgbCounter = 0;
-  unsigned int rgbaCounter = 0;
-
-  for(int b = 0; b < m_NumPixels; b++)
-  {
-    // Red
-    m_TempRGBABuffer[rgbaCounter] = buffer[rgbCounter];
-    rgbCounter++;
-    rgbaCounter++;
-
-    // Green
-    m_TempRGBABuffer[rgbaCounter] = buffer[rgbCounter];
-    rgbCounter++;
-    rgbaCounter++;
-
-    // Blue
-    m_TempRGBABuffer[rgbaCounter] = buffer[rgbCounter];
-    rgbCounter++;
-    rgbaCounter++;
-
-    // Alpha
-    m_TempRGBABuffer[rgbaCounter] = 255;
-    rgbaCounter++;
-  }
+  if(this->QueueCommand(MotionGateCommand, enabled))
+    return;
 
-  // Convert to Qt format
-  QImage result(m_TempRGBABuffer, m_ImageWidth, m_ImageHeight, QImage::Format_RGB32);
-  return result;
+  m_Attention.SetMotionGateEnabled(enabled);
 }
 
-QImage
+void
 FinalProjectApp
-::MonoBufferToQImage(unsigned char* buffer)
+::SetRecordingEnabled(bool enabled)
 {
-  unsigned int rgbaCounter = 0;
-
-  for(int b = 0; b < m_NumPixels; b++)
-  {
-    // Red
-    m_TempRGBABuffer[rgbaCounter] = buffer[b];
-    rgbaCounter++;
-
-    // Green
-    m_TempRGBABuffer[rgbaCounter] = buffer[b];
-    rgbaCounter++;
+  if(this->QueueCommand(RecordingCommand, enabled))
+    return;
 
-    // Blue
-    m_TempRGBABuffer[rgbaCounter] = buffer[b];
-    rgbaCounter++;
+  m_RecordingEnabled = enabled;
 
-    // Alpha
-    m_TempRGBABuffer[rgbaCounter] = 128;
-    rgbaCounter++;
+  // The running recorder drains its queue and closes its file on its own thread while the
+  // frame loop carries on; a new segment gets a fresh recorder and its own file
+  if(m_Recorder->IsRecording())
+  {
+    m_Recorder->Finish();
+    m_FinishingRecorders.push_back(m_Recorder);
+    m_Recorder = new SessionRecorder();
+    m_Recorder->SetThreadPolicy(&m_ThreadPolicy);
+    m_Recorder->SetImagePool(&m_BufferPool);
   }
 
-  // Convert to Qt format
-  QImage result(m_TempRGBABuffer, m_ImageWidth, m_ImageHeight, QImage::Format_RGB32);
-  return result;
-}
-
-// The radio button functions to choose the tracked feature
-void
-FinalProjectApp
-::SetApplyFilter(bool useFilter)
-{
-  m_FilterEnabled = useFilter;
+  // Without a camera we only remember the setting for SetupApp()
+  if(enabled && m_ConnectedToCamera)
+  {
+    char filename[64] = "Session Video.avi";
+    if(++m_RecordingSegment > 1)
+      sprintf(filename, "Session Video %d.avi", m_RecordingSegment);
+    m_Recorder->Start(filename, cvSize(m_ImageWidth, m_ImageHeight), 30.0,
+      m_FrameSource->GetPixelFormat() == FrameSource::BgrFormat);
+  }
 }
 
+// Each radio button emits toggled() both when it is checked and when it is unchecked;
+// only the checked one selects the feature
 void
 FinalProjectApp
 ::SetRadioButtonEyePairBig(bool bigEyePair){
-	m_EyePairBigEnabled = bigEyePair;
-	m_CurrentFeature = 1;
+	if(bigEyePair) this->SetFeature(FeatureTracker::EyePairBig);
 }
 
 void 
 FinalProjectApp
 ::SetRadioButtonEyePairSmall(bool smallEyePair){
-	m_EyePairSmallEnabled = smallEyePair;
-	 m_CurrentFeature = 2;
-  }
+	if(smallEyePair) this->SetFeature(FeatureTracker::EyePairSmall);
+}
 
 void 
 FinalProjectApp
 ::SetRadioButtonFrontalFace(bool frontalFace){
-	m_FrontalFaceEnabled = frontalFace;
-	 m_CurrentFeature = 3;
+	if(frontalFace) this->SetFeature(FeatureTracker::FrontalFace);
 }
 
 void 
 FinalProjectApp
 ::SetRadioButtonLeftRightEye(bool leftRightEye){
-	m_LeftRightEyeEnabled = leftRightEye;
-	 m_CurrentFeature = 4;
+	if(leftRightEye) this->SetFeature(FeatureTracker::LeftRightEye);
 }
 
 void 
 FinalProjectApp
 ::SetRadioButtonMouth(bool mouth){
-	m_MouthEnabled = mouth;
-	 m_CurrentFeature = 5;
+	if(mouth) this->SetFeature(FeatureTracker::Mouth);
 }
 
 void 
 FinalProjectApp
 ::SetRadioButtonNose(bool nose){
-	m_NoseEnabled = nose;
-	 m_CurrentFeature = 6;
+	if(nose) this->SetFeature(FeatureTracker::Nose);
 }
 
-// Load the settings file for which ever feature was selected to be tracked
-CvHaarClassifierCascade* 
+void
 FinalProjectApp
-::LoadHaarCascade(char* m_CascadeFilename)
+::SetFeature(int feature)
 {
-	CvHaarClassifierCascade* m_Cascade = (CvHaarClassifierCascade*)cvLoad(m_CascadeFilename, 0, 0, 0);
-	if( !m_Cascade ) {
-		printf("Couldnt load Haar Cascade '%s'\n", m_CascadeFilename);
-		exit(1);
-	}
-	return m_Cascade;
+  if(this->QueueCommand(FeatureCommand, feature))
+    return;
+
+  m_Attention.SetFeature(feature);
+}
+
+// Bind a feature to a detector, e.g. BindDetector("FrontalFace", "lbp", "lbpcascade_frontalface.xml")
+bool
+FinalProjectApp
+::BindDetector(const char* feature, const char* backend, const char* model)
+{
+	return m_Attention.BindDetector(feature, backend, model);
 }
 
 // The function to actually track the feature
-CvRect
+bool
 FinalProjectApp
-::TrackFeature(IplImage* inputImg, CvHaarClassifierCascade* m_Cascade)
+::TrackFeature(IplImage* inputImg, double time)
 {
-	// Perform face detection on the input image, using the given Haar classifier
-	CvRect eyeRect = detectEyesInImage(inputImg, m_Cascade);
-
-  // Time stamp when the frame was taken
-  m_TimeStamp[m_frame] = m_frame;
-
-	// Make sure a valid face was detected.
-	if (eyeRect.width > 0) {
-    if(m_attentionCounter < m_Threshold) {
-				m_attentionCounter++;
-			}
-			
-    m_Detect[m_frame] = 1;
-	}
-  
-  // No valid face was detected
-  else {
-    if(m_attentionCounter >0) {
-				m_attentionCounter--;
-			}
+	// The tracker shrinks the frame, applies the epoch budget and motion gate, detects or
+	// reuses the last result, and keeps the attention counter
+	bool found = m_Attention.ProcessFrame(inputImg, time);
+
+	m_Detect[m_frame] = found ? 1 : 0;
+	m_Carried[m_frame] = m_Attention.GetCarried() ? 1 : 0;
+	m_Interval[m_frame] = m_Attention.GetFrameInterval();
+	m_Width[m_frame] = m_Attention.GetDetectionWidth();
+	return found;
+}
 
-    m_Detect[m_frame] = 0;
-  }
+void
+FinalProjectApp
+::PublishPreview(IplImage* frame)
+{
+	// A GUI that is behind will show the frame it is still due; converting this one would be wasted
+	if(m_Display.IsFrameWaiting())
+		return;
+
+	TraceScope trace("preview");
+	QImage& preview = m_Display.GetBackBuffer(m_ImageWidth, m_ImageHeight);
+	IplImage2QImage(frame, m_FrameSource->GetPixelFormat(), preview);
+
+	// Trace a red rectangle over each detected area; the tracker reports them in frame coordinates
+	if(m_FilterEnabled)
+	{
+		IplImage header;
+		cvInitImageHeader(&header, cvSize(preview.width(), preview.height()), IPL_DEPTH_8U, 4);
+		cvSetData(&header, preview.bits(), preview.bytesPerLine());
+
+		const CvRect* detections = m_Attention.GetDetections();
+		for(int r = 0; r < m_Attention.GetNumberOfDetections(); r++)
+		{
+			CvRect rect = detections[r];
+			if(rect.width <= 0)
+				continue;
+			cvRectangle(&header,cvPoint(rect.x,rect.y), cvPoint(rect.x+rect.width,rect.y+rect.height), CV_RGB(255,0,0), 1, 8, 0);
+		}
+	}
 
-	// Trace a red rectangle over the detected area
-	cvRectangle(inputImg,cvPoint(eyeRect.x,eyeRect.y), cvPoint(eyeRect.x+eyeRect.width,eyeRect.y+eyeRect.height), CV_RGB(255,0,0), 1, 8, 0);
-	return eyeRect;
+	// Hand the frame to the GUI, which has taken the last one
+	if(m_Display.Publish())
+	{
+		TraceEvent("FrameReady", 'i', m_frame);
+		emit FrameReady();
+	}
 }
 
 void
 FinalProjectApp
 ::SetThreshold(int threshold)
  {
+   if(this->QueueCommand(ThresholdCommand, threshold))
+     return;
+
    m_Threshold = threshold;
    m_ThresholdFilter->SetLowerThreshold( m_Threshold );
-   m_attentionCounter = 0;
+   m_Attention.SetThreshold( m_Threshold );
  }
 
  // Create a log file from the data arrays
@@ -521,13 +844,19 @@ void
 FinalProjectApp
 ::SaveLog()
 {
+  if(this->QueueCommand(SaveLogCommand, 0))
+    return;
+
+  TraceScope trace("SaveLog", m_frame);
   for(int i = 0; i < m_frame; i++) {
-      fprintf(m_logFile, "%f,%i,%i,%i,%i\n", m_TimeStamp[i], m_Trial[i], m_Feature[i], m_Detect[i], m_Epoch[i]);
+      fprintf(m_logFile, "%f,%i,%i,%i,%i,%i,%i,%i\n", m_TimeStamp[i], m_Trial[i], m_Feature[i], m_Detect[i], m_Epoch[i], m_Carried[i], m_Interval[i], m_Width[i]);
 	}
   // Reset the arrays to continue recording data
   m_frame = 0;
 
   std::cout << "Saved log file\n";
+  if(m_Recorder->IsRecording())
+    m_Recorder->PrintStatistics();
 }
 
 /** Create an artificial function to cycle through the epochs, simulating trials.
@@ -536,159 +865,35 @@ void
 FinalProjectApp
 ::AdvanceTrialEpoch(int nextEpoch)
 {
-	if(nextEpoch>=0 && nextEpoch<=2){
-		m_CurrentEpoch = nextEpoch;
-		//Since the Epoch has advanced, lets see if we should update the LCDs
-		if(m_CurrentEpoch == 0){
-			m_CurrentTrial++;
-			//Determine if we call this a success, subject to change
-			if(((double)m_attentionCounter) / ((double)m_Threshold) > 0.5) m_SuccessfulTrials++;
-			else m_FailedTrials++;
-			emit updateSuccessfulTrialsLCD(m_SuccessfulTrials);
-			emit updateFailedTrialsLCD(m_FailedTrials);
-		}
-	}
-	else printf("Error, invalid number for next Epoch (%i)",nextEpoch);
-}
+	// The tracker's state belongs to the app's thread, like every other setting
+	if(this->QueueCommand(AdvanceEpochCommand, nextEpoch))
+		return;
 
- //*******************  Copied Code   ****************************
- // Perform face detection on the input image, using the given Haar Cascade.
-// Returns a rectangle for the detected region in the given image.
-CvRect 
-FinalProjectApp
-::detectEyesInImage(IplImage *inputImg, CvHaarClassifierCascade* cascade)
-{
-	// Smallest face size.
-	CvSize minFeatureSize = cvSize(10, 10);
-	// Only search for 1 face.
-	int flags = CV_HAAR_FIND_BIGGEST_OBJECT | CV_HAAR_DO_ROUGH_SEARCH;
-	// How detailed should the search be.
-	float search_scale_factor = 1.1f; //default 1.1f
-	IplImage *detectImg;
-	IplImage *greyImg = 0;
-	CvMemStorage* storage;
-	CvRect rc;
-	double t;
-	CvSeq* rects;
-	CvSize size;
-	int i, ms, nFaces;
-
-	storage = cvCreateMemStorage(0);
-	cvClearMemStorage( storage );
-
-
-	// If the image is color, use a greyscale copy of the image.
-	detectImg = (IplImage*)inputImg;
-	if (inputImg->nChannels > 1) {
-		size = cvSize(inputImg->width, inputImg->height);
-		greyImg = cvCreateImage(size, IPL_DEPTH_8U, 1 );
-		cvCvtColor( inputImg, greyImg, CV_BGR2GRAY );
-		detectImg = greyImg;	// Use the greyscale image.
-	}
-
-	// Detect all the faces in the greyscale image.
-	t = (double)cvGetTickCount();
-	rects = cvHaarDetectObjects( detectImg, cascade, storage,
-			search_scale_factor, 3, flags, minFeatureSize);
-	t = (double)cvGetTickCount() - t;
-	ms = cvRound( t / ((double)cvGetTickFrequency() * 1000.0) );
-	nFaces = rects->total;
-	//uncomment for debugging
-	//printf("Face Detection took %d ms and found %d objects\n", ms, nFaces);
-
-	// Get the first detected face (the biggest).
-	if (nFaces > 0)
-		rc = *(CvRect*)cvGetSeqElem( rects, 0 );
-	else
-		rc = cvRect(-1,-1,-1,-1);	// Couldn't find the face.
+	double time = ((double)m_QTime.elapsed())/1000;
+	TraceEvent("epoch", 'i', nextEpoch);
 
-	if (greyImg)
-		cvReleaseImage( &greyImg );
-	cvReleaseMemStorage( &storage );
-	//Now that we have permanent cascades (to improve performance) we don't want to release them
-	//cvReleaseHaarClassifierCascade( &cascade );
+	// The tracker judges the trial on the attention counter when it returns to Intertrial
+	int outcome = m_Attention.AdvanceEpoch(nextEpoch, time);
 
-	return rc;	// Return the biggest face found, or (-1,-1,-1,-1).
-}
-
-QImage*
-FinalProjectApp
-::IplImage2QImage(IplImage *iplImg)
-{
-	int h = iplImg->height;
-	int w = iplImg->width;
-	int channels = iplImg->nChannels;
-	QImage *qimg = new QImage(w, h, QImage::Format_ARGB32);
-	char *data = iplImg->imageData;
+	//Since the trial has ended, lets update the LCDs
+	if(outcome >= 0){
+		emit updateSuccessfulTrialsLCD(m_Attention.GetSuccessfulTrials());
+		emit updateFailedTrialsLCD(m_Attention.GetFailedTrials());
 
-	for (int y = 0; y < h; y++, data += iplImg->widthStep)
-	{
-		for (int x = 0; x < w; x++)
-		{
-			char r, g, b, a = 0;
-			if (channels == 1)
-			{
-				r = data[x * channels];
-				g = data[x * channels];
-				b = data[x * channels];
-			}
-			else if (channels == 3 || channels == 4)
-			{
-				r = data[x * channels + 2];
-				g = data[x * channels + 1];
-				b = data[x * channels];
-			}
-
-			if (channels == 4)
-			{
-				a = data[x * channels + 3];
-				qimg->setPixel(x, y, qRgba(r, g, b, a));
-			}
-			else
-			{
-				qimg->setPixel(x, y, qRgb(r, g, b));
-			}
-		}
+		// Write out the finished trial's aggregates
+		AttentionStatistics::WriteRecord(m_SummaryFile, m_Attention.GetLastTrial());
+		fflush(m_SummaryFile);
 	}
-	return qimg;
-
 }
 
-IplImage* 
+void
 FinalProjectApp
-::QImage2IplImage(QImage *qimg)
+::IplImage2QImage(IplImage *iplImg, FrameSource::PixelFormat format, QImage& qimg)
 {
+	CvSize size = FrameSource::GetPictureSize(iplImg, format);
+	if (qimg.width() != size.width || qimg.height() != size.height)
+		qimg = QImage(size.width, size.height, QImage::Format_RGB32);
 
-	IplImage *imgHeader = cvCreateImageHeader( cvSize(qimg->width(), qimg->height()), IPL_DEPTH_8U, 4);
-	imgHeader->imageData = (char*) qimg->bits();
-
-	uchar* newdata = (uchar*) malloc(sizeof(uchar) * qimg->byteCount());
-	memcpy(newdata, qimg->bits(), qimg->byteCount());
-	imgHeader->imageData = (char*) newdata;
-	//cvClo
-	return imgHeader;
-}
-
-CvRect FinalProjectApp
-::intersect(CvRect r1, CvRect r2) 
-{ 
-    CvRect intersection; 
-    
-    // find overlapping region 
-    intersection.x = (r1.x < r2.x) ? r2.x : r1.x; 
-    intersection.y = (r1.y < r2.y) ? r2.y : r1.y; 
-    intersection.width = (r1.x + r1.width < r2.x + r2.width) ? 
-        r1.x + r1.width : r2.x + r2.width; 
-    intersection.width -= intersection.x; 
-    intersection.height = (r1.y + r1.height < r2.y + r2.height) ? 
-        r1.y + r1.height : r2.y + r2.height; 
-    intersection.height -= intersection.y;     
-    
-    // check for non-overlapping regions 
-    if ((intersection.width <= 0) || (intersection.height <= 0)) { 
-        intersection = cvRect(0, 0, 0, 0); 
-    } 
-    
-    return intersection; 
-} 
-
+	// Luma frames get their color back here, and only here
+	FrameSource::ToRGB32(iplImg, format, qimg.bits(), qimg.bytesPerLine());
+}
@@ -17,16 +17,60 @@
 #define _appBase_h
 
 #include <iostream>
+#include <map>
+#include <vector>
 
 #include <QImage>
 
 #include <cv.h>
 #include <highgui.h>
 #include <QTime>
+#include <QFileSystemWatcher>
+#include <QMutex>
+#include <QTimer>
 
 #include "itkImage.h"
 #include "itkBinaryThresholdImageFilter.h"
 
+#include "AttentionTracker.h"
+#include "CommandQueue.h"
+#include "DetectorLoader.h"
+#include "FrameBufferPool.h"
+#include "SessionRecorder.h"
+#include "ThreadPolicy.h"
+#include "CaptureThread.h"
+#include "LatencyStatistics.h"
+#include "FrameSource.h"
+#include "TrialScheduler.h"
+#include "TripleBuffer.h"
+
+/** Choices made on the command line, before the app starts */
+struct RunOptions
+{
+  RunOptions() : EventDriven(true), Seed(0), Duration(0), Synthetic(false), LumaOnly(false), RequiredHitRate(0), QuitAtEnd(false) {}
+
+  /** Process frames as they arrive rather than on a 33 ms timer */
+  bool EventDriven;
+
+  /** Trial schedule to replay; if empty, one is generated from Seed (0 = from the clock) covering Duration seconds (0 = a day) */
+  std::string Schedule;
+  unsigned int Seed;
+  double Duration;
+
+  /** Take frames from this video, looped, or generate them, instead of using the camera */
+  std::string Video;
+  bool Synthetic;
+
+  /** Capture luma only where the source can, so detection needs no color conversion */
+  bool LumaOnly;
+
+  /** Use the fastest DetectionProfile.txt setting with at least this hit rate; 0 for the most accurate */
+  double RequiredHitRate;
+
+  /** Close the app once the schedule has been played */
+  bool QuitAtEnd;
+};
+
 class FinalProjectApp : public QObject
 {
 Q_OBJECT
@@ -43,14 +87,50 @@ public:
   /** Destructor */
   virtual ~FinalProjectApp();
 
-  /** Setup the camera connection */
-  void SetupApp();
+  /** Process frames as the camera delivers them (default) rather than on every timer tick; call before SetupApp() */
+  void SetEventDriven(bool eventDriven);
+  bool IsEventDriven() const { return m_EventDriven; }
+
+  /** Frame source, trial schedule and processing mode; call before SetupApp() */
+  void SetRunOptions(const RunOptions& options);
+  const RunOptions& GetRunOptions() const { return m_RunOptions; }
+
+  /** Capture size to ask the camera for; call before SetupApp() */
+  void SetRequestedCaptureSize(int width, int height);
+
+  /** Frames wider than this are shrunk before detection */
+  void SetMaxDetectionWidth(int width);
+
+  /** Bind a feature ("FrontalFace", "LeftEye", ...) to a detection backend ("haar", "lbp",
+  "template") and model file. The old detector stays bound if the new one can't be loaded.
+  This loads synchronously; once frames are running use ReplaceDetector(). */
+  bool BindDetector(const char* feature, const char* backend, const char* model);
+
+  /** CPU, priority and memory locking of the capture, detection, logging and GUI threads,
+  from ThreadPolicy.txt; the window applies the GUI role to its own thread */
+  ThreadPolicy& GetThreadPolicy() { return m_ThreadPolicy; }
+
+  /** Display frames, newest first; the consumer side belongs to the GUI thread */
+  TripleBuffer& GetDisplayBuffer() { return m_Display; }
 
 public slots:
 
-  /** Function to update the application in response to an external timer loop*/
+  /** Setup the camera connection and start the update timer, on the thread the app lives in */
+  void SetupApp();
+
+  /** Function to update the application in response to its timer.
+  When event driven, this only checks that frames are still arriving. */
   void RealtimeUpdate();
 
+  /** Process the newest frame from the capture thread */
+  void OnFrameArrived();
+
+  /** The trial schedule has been played */
+  void OnScheduleFinished();
+
+  /** The control slots below may also be called directly from the GUI thread; they then
+  only queue the change, which the app applies before its next frame */
+
   /** Change from color to threshold image or vice versa */
   void SetApplyFilter(bool useFilter);
 
@@ -65,19 +145,35 @@ public slots:
   void SetRadioButtonMouth(bool mouth);
   void SetRadioButtonNose(bool nose);
 
+  /** Skip the Haar pass on frames where nothing moved near the last detection */
+  void SetMotionGateEnabled(bool enabled);
+
+  /** Start or stop recording the full resolution camera stream to the session video */
+  void SetRecordingEnabled(bool enabled);
+
   /** Write the frame variables to the log file */
   void SaveLog();
 
+  /** Swap a feature's detector while frames keep coming: the new one is loaded and warmed
+  up on a background thread and bound between two frames. Call it on the app's thread,
+  or from elsewhere through a queued signal. */
+  void ReplaceDetector(const QString& feature, const QString& backend, const QString& model);
+
+  /** Reread FeatureDetectors.txt and swap in every binding that changed. Runs by itself
+  when the file is saved. */
+  void ReloadDetectors();
+
   /** A slot that the external program can call to advance the trial Epoch.
-  0 = Intertrial	1 = Button Press	2 = Reach				**/
+  0 = Intertrial	1 = Button Press	2 = Reach
+  Calls from other threads are queued and take effect before the next frame. **/
   void AdvanceTrialEpoch(int nextEpoch);
 
 
 
 signals:
 
-  /** Send a QImage to a receiver */
-  void SendImage(QImage image);
+  /** A new frame waits in the display buffer; not emitted again until the GUI has taken it */
+  void FrameReady();
 
   /** update the attention bar */
   void updateAttentionBar(int attentionProgress);
@@ -86,25 +182,55 @@ signals:
   void updateSuccessfulTrialsLCD(int successTrials);
   void updateFailedTrialsLCD(int failTrials);
 
+  /** Every trial of the schedule has been run */
+  void RunFinished();
+
 protected:
 
+  /** Changes queued by the control slots */
+  enum CommandType
+  {
+    ApplyFilterCommand,
+    ThresholdCommand,
+    FeatureCommand,
+    MotionGateCommand,
+    RecordingCommand,
+    SaveLogCommand,
+    AdvanceEpochCommand
+  };
+
+  /** Called from a thread other than the app's: queue the change and return true.
+  On the app's thread return false, so the caller applies it right away. Any number
+  of threads may call it; they take turns at the queue's producer end. */
+  bool QueueCommand(int type, int value);
+
+  /** Apply the queued changes, in order, and bind the detectors that finished loading */
+  void ExecuteCommands();
+
+  /** Track this feature from now on */
+  void SetFeature(int feature);
+
   /** Setup the connection to the webcam */
   bool SetupCamera();
 
   /** Disconnect from the webcam */
   void DisconnectCamera();
 
-  /** Configure the ITK pipeline to filter the acquired image data */
-  void SetupITKPipeline();
+  /** Track, log and display one captured frame. grabStart is when the source was asked for
+  it and captureTime when it returned it, both in cvGetTickCount() ticks. */
+  void ProcessFrame(IplImage* frame, double grabStart, double captureTime);
+
+  /** Stand-in for the task controller: load or generate the trial schedule and start it */
+  void SetupSchedule();
 
-  /** Copy the acquired image data to the ITK image */
-  void CopyImageToITK();
+  /** Trial outcomes and schedule timing to stdout */
+  void PrintRunSummary();
 
-  /** Convert an unsigned char buffer containing RGB data to a QImage */
-  QImage RGBBufferToQImage(unsigned char* buffer);
+  /** Borrow the per-frame buffers for the current image size from the pool */
+  void AllocateFrameBuffers();
 
-  /** Convert an unsigned char buffer containing monochrome data to a QImage */
-  QImage MonoBufferToQImage(unsigned char* buffer);
+  /** Configure the ITK pipeline to filter the acquired image data */
+  void SetupITKPipeline();
 
   /** Width of the image (# columns) in pixels */
   unsigned int m_ImageWidth;
@@ -115,20 +241,78 @@ protected:
   /** The number of pixels in the image */
   unsigned int m_NumPixels;
 
-  /** OpenCV webcam capture structure */
-  CvCapture* m_OpenCVCapture;
+  /** Capture size we ask the camera for; the size it actually delivers ends up in m_ImageWidth/Height */
+  int m_RequestedWidth;
+  int m_RequestedHeight;
+
+  /** The camera, or a recorded or synthetic stand-in */
+  FrameSource* m_FrameSource;
+
+  /** Command line choices */
+  RunOptions m_RunOptions;
+
+  /** Replays the trial schedule into AdvanceTrialEpoch() */
+  TrialScheduler m_Scheduler;
 
   /** Flag to indicate camera connection; true if connected */
   bool m_ConnectedToCamera;
 
-  /** The image in OpenCV format */
+  /** Capture thread announcing new frames; 0 when timer driven */
+  CaptureThread* m_CaptureThread;
+  bool m_EventDriven;
+
+  /** Complain when no frame arrived for this many milliseconds */
+  int m_WatchdogInterval;
+
+  /** cvGetTickCount() of the last captured frame and of the last attention decision */
+  double m_LastFrameTime;
+  double m_LastDecisionTime;
+
+  /** Time blocked in the grab waiting for the driver, capture-to-decision latency and
+  decision interval, for comparing event and timer driven runs */
+  LatencyStatistics m_GrabWait;
+  LatencyStatistics m_CaptureLatency;
+  LatencyStatistics m_DecisionInterval;
+
+  /** The image in OpenCV format, laid out as the frame source says */
   IplImage* m_CameraImageOpenCV;
 
-  /** Buffer containing RGB data from the camera */
-  unsigned char* m_CameraFrameRGBBuffer;
+  /** The frame's Y plane: a header over it, or for YUYV frames a pooled copy */
+  IplImage m_LumaHeader;
+  IplImage* m_LumaFrame;
+
+  /** Isolation settings and per-thread scheduling counters */
+  ThreadPolicy m_ThreadPolicy;
+
+  /** Every per-frame image buffer is borrowed from this pool: the capture thread's, the
+  recorders', the tracker's detection images and its detectors' scratch images. Declared
+  before m_Attention, so it outlives the tracker's buffers. */
+  FrameBufferPool m_BufferPool;
+
+  /** Display frames handed to the GUI thread without either side waiting */
+  TripleBuffer m_Display;
 
-  /** Temporary buffer used to store RGBA data for forming a QImage */
-  unsigned char* m_TempRGBABuffer;
+  /** Control changes from the GUI thread and any external controller */
+  CommandQueue m_Commands;
+
+  /** Held while pushing, so the queue sees one producer at a time. The app's thread
+  only pops, so it never waits on this. */
+  QMutex m_CommandProducerMutex;
+
+  /** Drives RealtimeUpdate() on the app's thread */
+  QTimer* m_Timer;
+
+  /** Loads replacement detectors in the background, and watches FeatureDetectors.txt */
+  DetectorLoader* m_DetectorLoader;
+  QFileSystemWatcher* m_DetectorWatcher;
+
+  /** Optional session video recorder, fed the unannotated full resolution frames */
+  SessionRecorder* m_Recorder;
+  bool m_RecordingEnabled;
+
+  /** Recorders of earlier segments still closing their files on their own threads */
+  std::vector<SessionRecorder*> m_FinishingRecorders;
+  int m_RecordingSegment;
 
   /** The captured image in ITK format */
   ImageType::Pointer m_Image;
@@ -142,40 +326,24 @@ protected:
   /** Is the filter enabled? */
   bool m_FilterEnabled;
 
-  /** Radio Button Values */
-  bool m_EyePairBigEnabled;
-  bool m_EyePairSmallEnabled;
-  bool m_FrontalFaceEnabled;
-  bool m_LeftRightEyeEnabled;
-  bool m_MouthEnabled;
-  bool m_NoseEnabled;
-
-  /** Haar Cascades for finding different Features */
-  CvHaarClassifierCascade* m_HaarLeftEye;
-  CvHaarClassifierCascade* m_HaarRightEye;
-  CvHaarClassifierCascade* m_HaarEyePairSmall;
-  CvHaarClassifierCascade* m_HaarEyePairBig;
-  CvHaarClassifierCascade* m_HaarFrontalFace;
-  CvHaarClassifierCascade* m_HaarMouth;
-  CvHaarClassifierCascade* m_HaarNose;
-
-  /** Find faces or eyes in an image using code from http://www.shervinemami.co.cc/faceRecognition.html */
-  CvRect detectEyesInImage(IplImage *inputImg, CvHaarClassifierCascade* cascade);
-
-  /** Convert IplImage to QtImage and vice-versa from http://umanga.wordpress.com/2010/04/19/how-to-covert-qt-qimage-into-opencv-iplimage-and-wise-versa/ */
-  QImage* IplImage2QImage(IplImage *iplImg);
-  IplImage* QImage2IplImage(QImage *qimg);
+  /** Detection, tracking and attention accounting, shared with the batch tools and the C API */
+  AttentionTracker m_Attention;
+
+  /** Convert IplImage to QtImage from http://umanga.wordpress.com/2010/04/19/how-to-covert-qt-qimage-into-opencv-iplimage-and-wise-versa/
+  The frame, in the given layout, is written into qimg, which is resized to fit if needed. */
+  void IplImage2QImage(IplImage *iplImg, FrameSource::PixelFormat format, QImage& qimg);
 
   /** Wrapper to reduce the amount of code we need to add into RealtimeUpdate for tracking. 
-  Send in an image and haar template, and get a rectangle back (and drawn on the image)*/
-  CvRect TrackFeature(IplImage* inputImg, CvHaarClassifierCascade* m_Cascade);
-  CvHaarClassifierCascade* LoadHaarCascade(char* m_CascadeFilename);
+  The tracker decides the frame, which may be luma only; what was found is logged.
+  time is in seconds since the app started. Returns true if the feature was found. */
+  bool TrackFeature(IplImage* inputImg, double time);
 
-  /**  Check to make sure two eye regions are not the same one.  From http://opencv-users.1802565.n2.nabble.com/cvRect-overlap-td3836140.html */
-  CvRect intersect(CvRect r1, CvRect r2);
+  /** Convert the frame for the GUI, with the detections drawn on when tracking, unless
+  the GUI hasn't shown the previous one yet; color is only rebuilt for frames that get shown */
+  void PublishPreview(IplImage* frame);
 
-  /** Counter to see how much we've been successfully tracking */
-  int m_attentionCounter;
+  /** One summary record per finished trial */
+  FILE *m_SummaryFile;
 
   /** Initialize a frame index for the arrays */
   int m_frame;
@@ -189,15 +357,10 @@ protected:
   int *m_Trial;
   int *m_Feature;
   int *m_Epoch;
-  /*Switched to this method so instead of checking what Epoch/feature we're using each time,
-  we simply reference the current state.  It saves a few if statements, and makes it easier to
-  reference these variables in the future, instead of having to look into the array (if we make them dynamic)
-  or having to run an if statement */
-  int m_CurrentEpoch;
-  int m_CurrentFeature;
-  int m_CurrentTrial;
+  int *m_Carried;
+  int *m_Interval;
+  int *m_Width;
   QTime m_QTime;
-  int m_SuccessfulTrials, m_FailedTrials;
   
 };
 
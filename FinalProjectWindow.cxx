@@ -18,8 +18,10 @@
 #include <QtGui>
 #include <QPixmap>
 
+#include "Trace.h"
+
 FinalProjectWindow
-::FinalProjectWindow(QWidget* parent)
+::FinalProjectWindow(QWidget* parent, const RunOptions& options)
 {
   std::cout << "In FinalProjectWindow constructor" << std::endl;
 
@@ -36,10 +38,14 @@ FinalProjectWindow
   
   graphicsView->setScene(m_GraphicsScene);
   graphicsView->scale(1.0, 1.0);
+  m_DisplayedWidth = 640;
 
-  // Create the app
-  m_App = new FinalProjectApp;
-  m_App->SetupApp();
+  // Create the app on its own thread, so capture, detection and logging never wait on the GUI
+  m_AppThread = new AppThread;
+  m_App = m_AppThread->StartApp();
+  m_App->SetRunOptions(options);
+  m_App->GetThreadPolicy().Apply(GuiThreadRole);
+  TraceThreadName("gui");
 
   // Connect signals/slots within the GUI
   connect(thresholdSlider, SIGNAL( valueChanged(int) ), thresholdSpinBox, SLOT( setValue(int) ) );
@@ -48,25 +54,34 @@ FinalProjectWindow
   connect(thresholdSpinBox, SIGNAL( valueChanged(int) ), attentionBar, SLOT( setMaximum(int) ) );
 
   //My additions
-  connect(radioButtonEyePairBig, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonEyePairBig(bool)) );
-  connect(radioButtonEyePairSmall, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonEyePairSmall(bool)) );
-  connect(radioButtonFrontalFace, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonFrontalFace(bool)) );
-  connect(radioButtonLeftRightEye, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonLeftRightEye(bool)) );
-  connect(radioButtonMouth, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonMouth(bool)) );
-  connect(radioButtonNose, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonNose(bool)) );
+  // Controls call the app directly; from this thread its slots only queue the change
+  connect(radioButtonEyePairBig, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonEyePairBig(bool)), Qt::DirectConnection );
+  connect(radioButtonEyePairSmall, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonEyePairSmall(bool)), Qt::DirectConnection );
+  connect(radioButtonFrontalFace, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonFrontalFace(bool)), Qt::DirectConnection );
+  connect(radioButtonLeftRightEye, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonLeftRightEye(bool)), Qt::DirectConnection );
+  connect(radioButtonMouth, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonMouth(bool)), Qt::DirectConnection );
+  connect(radioButtonNose, SIGNAL( toggled(bool) ), m_App, SLOT( SetRadioButtonNose(bool)), Qt::DirectConnection );
   
   connect(m_App, SIGNAL( updateAttentionBar(int)), attentionBar , SLOT( setValue(int) ));
   connect(m_App, SIGNAL( updateSuccessfulTrialsLCD(int) ), lcdSuccessfulTrials,SLOT( display(int) ));
   connect(m_App, SIGNAL( updateFailedTrialsLCD(int) ), lcdFailedTrials,SLOT( display(int) ));
 
   // Connect signals/slots to the app
-  connect(m_App, SIGNAL( SendImage(QImage) ), this, SLOT( OnReceiveImage(QImage) ));
-  connect(applyThresholdCheckBox, SIGNAL( toggled(bool) ), m_App, SLOT( SetApplyFilter(bool) ));
-  connect(thresholdSpinBox, SIGNAL( valueChanged(int) ), m_App, SLOT( SetThreshold(int) ));
-  connect(saveButton, SIGNAL( clicked() ), m_App, SLOT( SaveLog() ));
+  connect(m_App, SIGNAL( FrameReady() ), this, SLOT( OnFrameReady() ));
+  connect(applyThresholdCheckBox, SIGNAL( toggled(bool) ), m_App, SLOT( SetApplyFilter(bool) ), Qt::DirectConnection);
+  connect(thresholdSpinBox, SIGNAL( valueChanged(int) ), m_App, SLOT( SetThreshold(int) ), Qt::DirectConnection);
+  connect(saveButton, SIGNAL( clicked() ), m_App, SLOT( SaveLog() ), Qt::DirectConnection);
+
+  // F5 rereads FeatureDetectors.txt; changed detectors load in the background and swap in between frames
+  QShortcut* reloadShortcut = new QShortcut(QKeySequence(Qt::Key_F5), this);
+  connect(reloadShortcut, SIGNAL( activated() ), m_App, SLOT( ReloadDetectors() ));
+
+  // Unattended load tests end with the schedule
+  if(options.QuitAtEnd)
+    connect(m_App, SIGNAL( RunFinished() ), this, SLOT( close() ));
 
-  // Start the event timer
-  m_TimerID = startTimer(33);
+  // Everything is connected, so the app can start on its own thread
+  QMetaObject::invokeMethod(m_App, "SetupApp", Qt::QueuedConnection);
 }
 
 
@@ -83,8 +98,10 @@ FinalProjectWindow
 {
   std::cout << "In FinalProjectWindow::closeEvent" << std::endl;
 
-  // Delete the app, which also stops the camera capture process
-  delete m_App;
+  // Stop the app's thread, which deletes the app there and so also stops the camera capture process
+  delete m_AppThread;
+  m_AppThread = 0;
+  m_App = 0;
 
   // Since we've closed the window, we also want to quit the app
   // Note that qApp is a global variable that refers to the overall
@@ -95,33 +112,34 @@ FinalProjectWindow
 
 void
 FinalProjectWindow
-::timerEvent(QTimerEvent* event)
+::OnReceiveImage(QImage image)
 {
-  // If the timer event applied to this window, process it
-  // Otherwise pass the event to the base class handler
-  if (event->timerId() == m_TimerID)
-  {
-    this->RealtimeUpdate();
-  }
-  else
+  // Display the image
+  m_PixmapItem->setPixmap(QPixmap::fromImage(image));
+
+  // Full resolution frames can be larger than the view, so scale them to fit
+  if(image.width() != m_DisplayedWidth)
   {
-    QWidget::timerEvent(event);
+    m_DisplayedWidth = image.width();
+    m_GraphicsScene->setSceneRect(m_PixmapItem->boundingRect());
+    graphicsView->fitInView(m_PixmapItem, Qt::KeepAspectRatio);
   }
 }
 
-void
-FinalProjectWindow
-::RealtimeUpdate()
-{
-  // Update the app
-  m_App->RealtimeUpdate();
-}
-
 
 void
 FinalProjectWindow
-::OnReceiveImage(QImage image)
+::OnFrameReady()
 {
-  // Display the image
-  m_PixmapItem->setPixmap(QPixmap::fromImage(image));
+  // A notification can still be queued after the app was closed
+  if(!m_App)
+    return;
+
+  // The app may already have moved on to a newer frame; that's the one we get
+  TripleBuffer& display = m_App->GetDisplayBuffer();
+  if(display.Acquire())
+  {
+    TraceScope trace("OnReceiveImage");
+    this->OnReceiveImage(display.GetFrontBuffer());
+  }
 }
@@ -26,6 +26,7 @@
 
 // These two are files I wrote
 #include "FinalProjectApp.h"
+#include "AppThread.h"
 
 // This is an example of multiple inheritance. The FinalProjectWindow class derives
 // from BOTH QMainWindow and the Ui_MainWindow class defined in the UI file
@@ -35,8 +36,8 @@ Q_OBJECT
 
 public:
 
-  /** Constructor */
-  FinalProjectWindow(QWidget* parent = 0);
+  /** Constructor; the options choose frame source, trial schedule and processing mode */
+  FinalProjectWindow(QWidget* parent = 0, const RunOptions& options = RunOptions());
 
   /** Destructor */
   ~FinalProjectWindow();
@@ -46,27 +47,25 @@ public slots:
   /** Receive an image to display */
   void OnReceiveImage(QImage image);
 
+  /** Take the newest frame from the app's display buffer and show it */
+  void OnFrameReady();
+
 protected:
 
   /** Handle closing the main window */
   void closeEvent(QCloseEvent *event);
 
-  /** Timer event handler - lowercase name is overload */
-  void timerEvent(QTimerEvent* event);
-
-  /** Realtime update function called in response to timer events */
-  void RealtimeUpdate();
-
-  /** Event timer */
-  int m_TimerID;
-
     /** Viewfinder graphics scene */
   QGraphicsScene* m_GraphicsScene;
 
   /** Viewfinder image for display */
   QGraphicsPixmapItem* m_PixmapItem;
 
-  /** App */
+  /** Width of the last displayed image, to refit the view when it changes */
+  int m_DisplayedWidth;
+
+  /** App, living on its own thread */
+  AppThread* m_AppThread;
   FinalProjectApp* m_App;
 };
 
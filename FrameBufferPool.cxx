@@ -0,0 +1,189 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "FrameBufferPool.h"
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+FrameBufferPool
+::FrameBufferPool()
+{
+  // The recorder's ring alone takes 15 buffers and every stage adds a few; reserving
+  // keeps the list itself off the heap later
+  m_Buffers.reserve(64);
+
+  m_InUse = 0;
+  m_PeakInUse = 0;
+  m_Allocations = 0;
+  m_Acquisitions = 0;
+  m_BytesAllocated = 0;
+  m_BytesInUse = 0;
+  m_PeakBytesInUse = 0;
+  m_LockMemory = false;
+}
+
+
+FrameBufferPool
+::~FrameBufferPool()
+{
+  for(size_t b = 0; b < m_Buffers.size(); b++)
+  {
+    if(m_Buffers[b].InUse)
+      printf("Frame buffer %dx%dx%d still borrowed when the pool was destroyed\n",
+        m_Buffers[b].Image->width, m_Buffers[b].Image->height, m_Buffers[b].Image->nChannels);
+    if(m_LockMemory)
+      UnlockImage(m_Buffers[b].Image);
+    cvReleaseImage(&m_Buffers[b].Image);
+  }
+}
+
+
+IplImage*
+FrameBufferPool
+::Acquire(CvSize size, int channels)
+{
+  QMutexLocker lock(&m_Mutex);
+
+  m_Acquisitions++;
+
+  // Reuse a free buffer with the same geometry if there is one
+  Buffer* buffer = 0;
+  for(size_t b = 0; b < m_Buffers.size(); b++)
+  {
+    IplImage* image = m_Buffers[b].Image;
+    if(!m_Buffers[b].InUse && image->width == size.width && image->height == size.height
+      && image->nChannels == channels)
+    {
+      buffer = &m_Buffers[b];
+      break;
+    }
+  }
+
+  // Otherwise grow the pool
+  if(buffer == 0)
+  {
+    Buffer newBuffer;
+    newBuffer.Image = cvCreateImage(size, IPL_DEPTH_8U, channels);
+    newBuffer.InUse = false;
+    if(m_LockMemory)
+      LockImage(newBuffer.Image);
+    m_Buffers.push_back(newBuffer);
+    buffer = &m_Buffers.back();
+
+    m_Allocations++;
+    m_BytesAllocated += buffer->Image->imageSize;
+  }
+
+  // Borrowers may have left a region of interest behind
+  cvResetImageROI(buffer->Image);
+  buffer->InUse = true;
+
+  m_InUse++;
+  m_BytesInUse += buffer->Image->imageSize;
+  if(m_InUse > m_PeakInUse)
+    m_PeakInUse = m_InUse;
+  if(m_BytesInUse > m_PeakBytesInUse)
+    m_PeakBytesInUse = m_BytesInUse;
+
+  return buffer->Image;
+}
+
+
+void
+FrameBufferPool
+::Release(IplImage* image)
+{
+  if(image == 0)
+    return;
+
+  QMutexLocker lock(&m_Mutex);
+
+  for(size_t b = 0; b < m_Buffers.size(); b++)
+  {
+    if(m_Buffers[b].Image == image && m_Buffers[b].InUse)
+    {
+      m_Buffers[b].InUse = false;
+      m_InUse--;
+      m_BytesInUse -= image->imageSize;
+      return;
+    }
+  }
+
+  printf("Released an image that doesn't belong to the frame buffer pool\n");
+}
+
+
+void
+FrameBufferPool
+::PrintStatistics() const
+{
+  printf("Frame buffer pool: %d buffers (%lu bytes), %ld borrows, %d in use, peak %d in use (%lu bytes)\n",
+    (int)m_Buffers.size(), (unsigned long)m_BytesAllocated, m_Acquisitions, m_InUse, m_PeakInUse,
+    (unsigned long)m_PeakBytesInUse);
+}
+
+
+void
+FrameBufferPool
+::SetLockMemory(bool lock)
+{
+  QMutexLocker locker(&m_Mutex);
+  if(lock == m_LockMemory)
+    return;
+
+  m_LockMemory = lock;
+  for(size_t b = 0; b < m_Buffers.size(); b++)
+  {
+    if(lock)
+      LockImage(m_Buffers[b].Image);
+    else
+      UnlockImage(m_Buffers[b].Image);
+  }
+}
+
+
+bool
+FrameBufferPool
+::LockImage(IplImage* image)
+{
+#ifndef _WIN32
+  // Usually limited by RLIMIT_MEMLOCK; say so once rather than for every buffer
+  if(mlock(image->imageDataOrigin, image->imageSize) != 0)
+  {
+    static bool warned = false;
+    if(!warned)
+      printf("Couldnt lock frame buffers in memory; raise the locked memory limit (ulimit -l)\n");
+    warned = true;
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+void
+FrameBufferPool
+::UnlockImage(IplImage* image)
+{
+#ifndef _WIN32
+  munlock(image->imageDataOrigin, image->imageSize);
+#endif
+}
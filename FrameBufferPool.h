@@ -0,0 +1,90 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef _FrameBufferPool_h
+#define _FrameBufferPool_h
+
+#include <vector>
+
+#include <cv.h>
+#include <QMutex>
+
+#include "ImagePool.h"
+
+/** Pool of 8-bit images shared by every stage of the frame loop: the capture thread's
+buffers, the detection streams, the motion gate, the detectors' scratch images and the
+recorder's queue all borrow from the app's pool.
+Images are allocated the first time a size/channel combination is asked for and
+are recycled afterwards, so in steady state borrowing a buffer never touches the heap. */
+class FrameBufferPool : public ImagePool
+{
+public:
+
+  /** Constructor */
+  FrameBufferPool();
+
+  /** Destructor; frees every buffer the pool ever allocated */
+  ~FrameBufferPool();
+
+  /** Borrow an image, allocating one only if no free buffer of this geometry exists */
+  virtual IplImage* Acquire(CvSize size, int channels);
+
+  /** Give a borrowed image back to the pool */
+  virtual void Release(IplImage* image);
+
+  /** Pool usage counters */
+  int GetNumberOfBuffers() const { return (int)m_Buffers.size(); }
+  int GetNumberInUse() const { return m_InUse; }
+  int GetPeakInUse() const { return m_PeakInUse; }
+  int GetNumberOfAllocations() const { return m_Allocations; }
+  long GetNumberOfAcquisitions() const { return m_Acquisitions; }
+  size_t GetBytesAllocated() const { return m_BytesAllocated; }
+  size_t GetPeakBytesInUse() const { return m_PeakBytesInUse; }
+
+  /** Print the counters to stdout */
+  void PrintStatistics() const;
+
+  /** Keep every buffer of the pool, present and future, locked in memory */
+  void SetLockMemory(bool lock);
+
+  /** Lock or unlock one image's pixels in memory; returns false if the system refuses */
+  static bool LockImage(IplImage* image);
+  static void UnlockImage(IplImage* image);
+
+protected:
+
+  struct Buffer
+  {
+    IplImage* Image;
+    bool InUse;
+  };
+
+  std::vector<Buffer> m_Buffers;
+
+  /** Borrowing may happen from helper threads */
+  QMutex m_Mutex;
+
+  int m_InUse;
+  int m_PeakInUse;
+  int m_Allocations;
+  long m_Acquisitions;
+  size_t m_BytesAllocated;
+  size_t m_BytesInUse;
+  size_t m_PeakBytesInUse;
+
+  bool m_LockMemory;
+};
+
+#endif
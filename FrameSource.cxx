@@ -0,0 +1,280 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "FrameSource.h"
+
+#include "PixelKernels.h"
+
+#include <math.h>
+
+CvSize
+FrameSource
+::GetPictureSize(const IplImage* frame, PixelFormat format)
+{
+  if(format == Nv12Format)
+    return cvSize(frame->width, frame->height * 2 / 3);
+  return cvSize(frame->width, frame->height);
+}
+
+
+IplImage*
+FrameSource
+::GetLuma(IplImage* frame, PixelFormat format, IplImage* header, IplImage* scratch)
+{
+  switch(format)
+  {
+    case GrayFormat:
+      return frame;
+
+    case Nv12Format:
+      // The Y plane is the top of the buffer, so a shorter header over it is all it takes
+      cvInitImageHeader(header, GetPictureSize(frame, format), IPL_DEPTH_8U, 1);
+      cvSetData(header, frame->imageData, frame->widthStep);
+      return header;
+
+    case YuyvFormat:
+    {
+      // Every other byte is a Y sample; picking them out is a copy, not a conversion
+      const PixelKernels& kernels = GetPixelKernels();
+      for(int y = 0; y < frame->height; y++)
+      {
+        const unsigned char* in = (const unsigned char*)frame->imageData + y * frame->widthStep;
+        unsigned char* out = (unsigned char*)scratch->imageData + y * scratch->widthStep;
+        kernels.YuyvToLuma(in, out, frame->width);
+      }
+      return scratch;
+    }
+
+    default:
+      return frame;
+  }
+}
+
+
+void
+FrameSource
+::ToRGB32(const IplImage* frame, PixelFormat format, unsigned char* out, int outStep)
+{
+  // The row loops live in PixelKernels, built for each instruction set
+  const PixelKernels& kernels = GetPixelKernels();
+  CvSize size = GetPictureSize(frame, format);
+  for(int y = 0; y < size.height; y++, out += outStep)
+  {
+    const unsigned char* in = (const unsigned char*)frame->imageData + y * frame->widthStep;
+    if(format == YuyvFormat)
+      kernels.YuyvToRGB32(in, out, size.width);
+    else if(format == Nv12Format)
+    {
+      // Each U,V row covers two rows of pixels
+      const unsigned char* chroma = (const unsigned char*)frame->imageData + (size.height + y / 2) * frame->widthStep;
+      kernels.Nv12ToRGB32(in, chroma, out, size.width);
+    }
+    // Format_RGB32 is stored as B,G,R,X bytes, the same order OpenCV uses for its color images
+    else if(frame->nChannels == 1)
+      kernels.GrayToRGB32(in, out, size.width);
+    else if(frame->nChannels == 4)
+      kernels.BgraToRGB32(in, out, size.width);
+    else
+      kernels.BgrToRGB32(in, out, size.width);
+  }
+}
+
+
+CameraFrameSource
+::CameraFrameSource(int requestedWidth, int requestedHeight)
+{
+  // Try to get any open camera
+  m_Capture = cvCaptureFromCAM(CV_CAP_ANY);
+
+  // Ask for the width and height we'd like; the frames tell what the camera agreed to
+  if(m_Capture != 0)
+  {
+    cvSetCaptureProperty(m_Capture, CV_CAP_PROP_FRAME_WIDTH, requestedWidth);
+    cvSetCaptureProperty(m_Capture, CV_CAP_PROP_FRAME_HEIGHT, requestedHeight); 
+  }
+}
+
+
+bool
+CameraFrameSource
+::SetLumaOnly(bool luma)
+{
+  m_Format = BgrFormat;
+  cvSetCaptureProperty(m_Capture, CV_CAP_PROP_CONVERT_RGB, luma ? 0 : 1);
+  if(!luma)
+    return true;
+
+  // The backends don't report the raw layout, so tell it from what an unconverted frame
+  // looks like. Only a frame of the capture's size counts: some backends hand out raw
+  // YUYV as one long row of bytes, which must not pass for a one pixel high gray image.
+  IplImage* probe = cvQueryFrame(m_Capture);
+  int width = (int)cvGetCaptureProperty(m_Capture, CV_CAP_PROP_FRAME_WIDTH);
+  int height = (int)cvGetCaptureProperty(m_Capture, CV_CAP_PROP_FRAME_HEIGHT);
+  if(probe && probe->depth == IPL_DEPTH_8U && width > 0 && height > 0 && probe->width == width)
+  {
+    if(probe->nChannels == 2 && probe->height == height)
+      m_Format = YuyvFormat;
+    else if(probe->nChannels == 1 && probe->height == height * 3 / 2)
+      m_Format = Nv12Format;
+    else if(probe->nChannels == 1 && probe->height == height)
+      m_Format = GrayFormat;
+  }
+
+  // Still BGR, or a compressed or unknown layout: let the backend convert as before
+  if(m_Format == BgrFormat)
+    cvSetCaptureProperty(m_Capture, CV_CAP_PROP_CONVERT_RGB, 1);
+  return m_Format != BgrFormat;
+}
+
+
+CameraFrameSource
+::~CameraFrameSource()
+{
+  if(m_Capture) cvReleaseCapture(&m_Capture);
+}
+
+
+IplImage*
+CameraFrameSource
+::QueryFrame()
+{
+  return cvQueryFrame(m_Capture);
+}
+
+
+VideoFrameSource
+::VideoFrameSource(const std::string& filename)
+{
+  m_Filename = filename;
+  m_Capture = cvCreateFileCapture(filename.c_str());
+  m_FramesPerSecond = m_Capture ? cvGetCaptureProperty(m_Capture, CV_CAP_PROP_FPS) : 0;
+  if(m_FramesPerSecond <= 0)
+    m_FramesPerSecond = 30;
+}
+
+
+VideoFrameSource
+::~VideoFrameSource()
+{
+  if(m_Capture) cvReleaseCapture(&m_Capture);
+}
+
+
+IplImage*
+VideoFrameSource
+::QueryFrame()
+{
+  IplImage* frame = cvQueryFrame(m_Capture);
+  if(frame == 0)
+  {
+    // Start over; reopening is more reliable than seeking back with every codec
+    cvReleaseCapture(&m_Capture);
+    m_Capture = cvCreateFileCapture(m_Filename.c_str());
+    frame = m_Capture ? cvQueryFrame(m_Capture) : 0;
+  }
+  return frame;
+}
+
+
+/** Small portable generator, so a seed gives the same frames on every machine */
+static unsigned int NextRandom(unsigned int& state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+
+SyntheticFrameSource
+::SyntheticFrameSource(int width, int height, double framesPerSecond, unsigned int seed)
+{
+  m_FramesPerSecond = framesPerSecond > 0 ? framesPerSecond : 30;
+  m_Seed = seed ? seed : 1;
+  m_FrameNumber = 0;
+
+  // A fixed background of random gray blocks gives the detectors something to reject
+  m_Background = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 3);
+  m_Frame = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 3);
+  unsigned int state = m_Seed;
+  int block = width / 32 > 0 ? width / 32 : 1;
+  for(int y = 0; y < height; y += block)
+    for(int x = 0; x < width; x += block)
+    {
+      int gray = 64 + NextRandom(state) % 128;
+      cvSetImageROI(m_Background, cvRect(x, y, block, block));
+      cvSet(m_Background, cvScalarAll(gray));
+    }
+  cvResetImageROI(m_Background);
+}
+
+
+bool
+SyntheticFrameSource
+::SetLumaOnly(bool luma)
+{
+  int channels = luma ? 1 : 3;
+  if(m_Frame->nChannels != channels)
+  {
+    // The background is gray already, so converting it once loses nothing
+    IplImage* background = cvCreateImage(cvGetSize(m_Background), IPL_DEPTH_8U, channels);
+    cvCvtColor(m_Background, background, luma ? CV_BGR2GRAY : CV_GRAY2BGR);
+    cvReleaseImage(&m_Background);
+    cvReleaseImage(&m_Frame);
+    m_Background = background;
+    m_Frame = cvCreateImage(cvGetSize(m_Background), IPL_DEPTH_8U, channels);
+  }
+  m_Format = luma ? GrayFormat : BgrFormat;
+  return true;
+}
+
+
+SyntheticFrameSource
+::~SyntheticFrameSource()
+{
+  cvReleaseImage(&m_Background);
+  cvReleaseImage(&m_Frame);
+}
+
+
+IplImage*
+SyntheticFrameSource
+::QueryFrame()
+{
+  cvCopy(m_Background, m_Frame);
+
+  // The face drifts along a slow Lissajous path whose phase depends on the seed
+  double t = m_FrameNumber / m_FramesPerSecond;
+  double phase = (m_Seed % 628) / 100.0;
+  int width = m_Frame->width, height = m_Frame->height;
+  int faceWidth = width / 6, faceHeight = faceWidth * 4 / 3;
+  CvPoint center = cvPoint(cvRound(width * (0.5 + 0.3 * sin(0.31 * t + phase))),
+    cvRound(height * (0.5 + 0.25 * sin(0.23 * t))));
+
+  // For two seconds out of every fifteen the subject looks away
+  bool present = fmod(t + phase, 15.0) < 13.0;
+  if(present)
+  {
+    cvEllipse(m_Frame, center, cvSize(faceWidth / 2, faceHeight / 2), 0, 0, 360, CV_RGB(200, 170, 150), -1, 8, 0);
+    int eyeY = center.y - faceHeight / 8;
+    int eyeRadius = faceWidth / 12;
+    cvCircle(m_Frame, cvPoint(center.x - faceWidth / 5, eyeY), eyeRadius, CV_RGB(30, 30, 30), -1, 8, 0);
+    cvCircle(m_Frame, cvPoint(center.x + faceWidth / 5, eyeY), eyeRadius, CV_RGB(30, 30, 30), -1, 8, 0);
+    cvEllipse(m_Frame, cvPoint(center.x, center.y + faceHeight / 4), cvSize(faceWidth / 5, faceHeight / 16),
+      0, 0, 360, CV_RGB(120, 60, 60), -1, 8, 0);
+  }
+
+  m_FrameNumber++;
+  return m_Frame;
+}
@@ -0,0 +1,154 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _FrameSource_h
+#define _FrameSource_h
+
+#include <string>
+
+#include <cv.h>
+#include <highgui.h>
+
+/** Where the app's frames come from: the camera, a recorded session video or a
+synthetic generator. The last two make load tests repeatable without a subject.
+
+Detection only looks at brightness, so a source can be asked for luma only. It then
+hands out frames in whatever layout carries the Y plane without a color conversion:
+plain gray, packed YUYV or planar NV12. GetLuma() gets at the Y plane of such a frame
+and ToRGB32() rebuilds color, which is only worth doing for frames that get shown. */
+class FrameSource
+{
+public:
+
+  /** Layout of the frames QueryFrame() returns */
+  enum PixelFormat
+  {
+    /** 3 channel BGR, as OpenCV converts to by default */
+    BgrFormat,
+    /** 1 channel luma */
+    GrayFormat,
+    /** 2 channel Y,U / Y,V pairs, as most webcams send */
+    YuyvFormat,
+    /** 1 channel image 3/2 the picture height: the Y plane, then interleaved U,V rows at half resolution */
+    Nv12Format
+  };
+
+  FrameSource() : m_Format(BgrFormat) {}
+  virtual ~FrameSource() {}
+
+  /** Next frame, owned by the source and valid until the next call; 0 if none */
+  virtual IplImage* QueryFrame() = 0;
+
+  /** Ask for luma instead of BGR frames, before the first QueryFrame(). Returns false
+  if the source can only deliver BGR, which it then keeps doing. */
+  virtual bool SetLumaOnly(bool luma) { return !luma; }
+
+  /** Layout of the frames QueryFrame() returns */
+  PixelFormat GetPixelFormat() const { return m_Format; }
+
+  /** Size of the picture in a frame of this layout */
+  static CvSize GetPictureSize(const IplImage* frame, PixelFormat format);
+
+  /** The frame's Y plane as a 1 channel image. Gray and NV12 frames are wrapped in
+  header without copying; YUYV luma is copied into scratch, a 1 channel image of the
+  picture size. BGR frames are returned as they are. */
+  static IplImage* GetLuma(IplImage* frame, PixelFormat format, IplImage* header, IplImage* scratch);
+
+  /** Convert a frame to B,G,R,X bytes, e.g. the bits of a Format_RGB32 QImage */
+  static void ToRGB32(const IplImage* frame, PixelFormat format, unsigned char* out, int outStep);
+
+  /** Seconds between frames a reader should pace itself at; 0 if QueryFrame()
+  already waits for the next frame, as a camera does */
+  virtual double GetFrameInterval() const { return 0; }
+
+  /** For the console */
+  virtual std::string GetDescription() const = 0;
+
+protected:
+  PixelFormat m_Format;
+};
+
+
+/** A camera through cvCaptureFromCAM */
+class CameraFrameSource : public FrameSource
+{
+public:
+
+  /** Open any camera and ask it for a capture size; check IsOpen() */
+  CameraFrameSource(int requestedWidth, int requestedHeight);
+  virtual ~CameraFrameSource();
+
+  bool IsOpen() const { return m_Capture != 0; }
+
+  /** Turns off the backend's RGB conversion and looks at what the driver then sends;
+  falls back to BGR if that isn't a layout we can take the Y plane from */
+  virtual bool SetLumaOnly(bool luma);
+
+  virtual IplImage* QueryFrame();
+  virtual std::string GetDescription() const { return "camera"; }
+
+protected:
+  CvCapture* m_Capture;
+};
+
+
+/** A recorded video, played at its own frame rate and looped, so a short
+recording can drive an arbitrarily long run */
+class VideoFrameSource : public FrameSource
+{
+public:
+
+  /** Open a video file; check IsOpen() */
+  VideoFrameSource(const std::string& filename);
+  virtual ~VideoFrameSource();
+
+  bool IsOpen() const { return m_Capture != 0; }
+
+  virtual IplImage* QueryFrame();
+  virtual double GetFrameInterval() const { return 1.0 / m_FramesPerSecond; }
+  virtual std::string GetDescription() const { return "video " + m_Filename; }
+
+protected:
+  std::string m_Filename;
+  CvCapture* m_Capture;
+  double m_FramesPerSecond;
+};
+
+
+/** Generated frames: a face-like pattern (an oval with two eyes and a mouth) that
+wanders over a textured background and now and then leaves the frame. Every frame
+depends only on the seed and the frame number. */
+class SyntheticFrameSource : public FrameSource
+{
+public:
+
+  SyntheticFrameSource(int width, int height, double framesPerSecond, unsigned int seed);
+  virtual ~SyntheticFrameSource();
+
+  /** Luma frames are drawn in gray directly */
+  virtual bool SetLumaOnly(bool luma);
+
+  virtual IplImage* QueryFrame();
+  virtual double GetFrameInterval() const { return 1.0 / m_FramesPerSecond; }
+  virtual std::string GetDescription() const { return "synthetic frames"; }
+
+protected:
+  IplImage* m_Background;
+  IplImage* m_Frame;
+  double m_FramesPerSecond;
+  unsigned int m_Seed;
+  int m_FrameNumber;
+};
+
+#endif
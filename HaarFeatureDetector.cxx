@@ -0,0 +1,75 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "HaarFeatureDetector.h"
+
+HaarFeatureDetector
+::HaarFeatureDetector()
+{
+  m_Cascade = 0;
+  m_Storage = cvCreateMemStorage(0);
+}
+
+
+HaarFeatureDetector
+::~HaarFeatureDetector()
+{
+  if(m_Cascade) cvReleaseHaarClassifierCascade(&m_Cascade);
+  cvReleaseMemStorage(&m_Storage);
+}
+
+
+bool
+HaarFeatureDetector
+::Load(const std::string& filename)
+{
+  CvHaarClassifierCascade* cascade = (CvHaarClassifierCascade*)cvLoad(filename.c_str(), 0, 0, 0);
+  if(cascade == 0)
+    return false;
+
+  if(m_Cascade) cvReleaseHaarClassifierCascade(&m_Cascade);
+  m_Cascade = cascade;
+  m_Model = filename;
+  return true;
+}
+
+
+// Detection code originally from http://www.shervinemami.co.cc/faceRecognition.html
+CvRect
+HaarFeatureDetector
+::DetectObject(IplImage* gray)
+{
+  if(m_Cascade == 0)
+    return cvRect(-1,-1,-1,-1);
+
+  cvClearMemStorage(m_Storage);
+
+  // Some cascades are accurate enough on an even smaller image
+  IplImage* detectImg = this->ApplyInputScale(gray);
+
+  // Detect the feature; with the default flags only the biggest one is searched for
+  CvSeq* rects = cvHaarDetectObjects(detectImg, m_Cascade, m_Storage, m_Parameters.ScaleFactor,
+    m_Parameters.MinNeighbors, m_Parameters.Flags, cvSize(m_Parameters.MinSize, m_Parameters.MinSize));
+
+  // Keep the biggest one found
+  CvRect best = cvRect(-1,-1,-1,-1);
+  for(int r = 0; r < (rects ? rects->total : 0); r++)
+  {
+    CvRect rect = *(CvRect*)cvGetSeqElem(rects, r);
+    if(rect.width * rect.height > best.width * best.height)
+      best = rect;
+  }
+
+  return this->UndoInputScale(best);
+}
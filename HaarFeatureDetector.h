@@ -0,0 +1,47 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _HaarFeatureDetector_h
+#define _HaarFeatureDetector_h
+
+#include "FeatureDetector.h"
+
+/** The app's original backend: an OpenCV 1.x Haar cascade run with cvHaarDetectObjects */
+class HaarFeatureDetector : public FeatureDetector
+{
+public:
+
+  /** Constructor */
+  HaarFeatureDetector();
+
+  /** Destructor */
+  virtual ~HaarFeatureDetector();
+
+  virtual const char* GetBackend() const { return "haar"; }
+  virtual bool Load(const std::string& filename);
+
+  /** The loaded cascade; cvHaarDetectObjects keeps state in it, so use it from one thread only */
+  CvHaarClassifierCascade* GetCascade() const { return m_Cascade; }
+
+protected:
+
+  virtual CvRect DetectObject(IplImage* gray);
+
+  CvHaarClassifierCascade* m_Cascade;
+
+  /** Scratch storage for cvHaarDetectObjects, cleared rather than recreated every call */
+  CvMemStorage* m_Storage;
+};
+
+#endif
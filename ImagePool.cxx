@@ -0,0 +1,39 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "ImagePool.h"
+
+IplImage*
+ImagePool
+::Create(ImagePool* pool, CvSize size, int channels)
+{
+  if(pool)
+    return pool->Acquire(size, channels);
+  return cvCreateImage(size, IPL_DEPTH_8U, channels);
+}
+
+
+void
+ImagePool
+::Free(ImagePool* pool, IplImage** image)
+{
+  if(*image == 0)
+    return;
+  if(pool)
+    pool->Release(*image);
+  else
+    cvReleaseImage(image);
+  *image = 0;
+}
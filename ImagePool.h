@@ -0,0 +1,44 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef _ImagePool_h
+#define _ImagePool_h
+
+#include <cv.h>
+
+/** Where the detection library's classes get their 8-bit image buffers. The library has
+no locks of its own, so it leaves recycling to the host program: the app hands its
+FrameBufferPool to the tracker, the detectors and its own threads, which then borrow
+instead of allocating. Without a pool they allocate plainly, as in the tools. */
+class ImagePool
+{
+public:
+
+  /** Destructor */
+  virtual ~ImagePool() {}
+
+  /** Borrow an image; may be called from several threads at once */
+  virtual IplImage* Acquire(CvSize size, int channels) = 0;
+
+  /** Give a borrowed image back */
+  virtual void Release(IplImage* image) = 0;
+
+  /** Borrow from the pool if there is one, or create a plain image. Free() gives back
+  what Create() gave out, to the same pool or to none, and clears the pointer. */
+  static IplImage* Create(ImagePool* pool, CvSize size, int channels);
+  static void Free(ImagePool* pool, IplImage** image);
+};
+
+#endif
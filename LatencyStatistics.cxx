@@ -0,0 +1,100 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "LatencyStatistics.h"
+
+#include <math.h>
+#include <stdio.h>
+
+LatencyStatistics
+::LatencyStatistics(double maxMilliseconds)
+{
+  m_BinWidth = 0.1;
+  m_Histogram.assign((int)(maxMilliseconds / m_BinWidth) + 1, 0);
+  this->Reset();
+}
+
+
+void
+LatencyStatistics
+::Reset()
+{
+  m_Count = 0;
+  m_Mean = 0;
+  m_M2 = 0;
+  m_Minimum = 0;
+  m_Maximum = 0;
+  m_Histogram.assign(m_Histogram.size(), 0);
+}
+
+
+void
+LatencyStatistics
+::Add(double milliseconds)
+{
+  // Welford's update keeps the variance numerically stable over long sessions
+  m_Count++;
+  double delta = milliseconds - m_Mean;
+  m_Mean += delta / m_Count;
+  m_M2 += delta * (milliseconds - m_Mean);
+
+  if(m_Count == 1 || milliseconds < m_Minimum)
+    m_Minimum = milliseconds;
+  if(m_Count == 1 || milliseconds > m_Maximum)
+    m_Maximum = milliseconds;
+
+  int bin = (int)(milliseconds / m_BinWidth);
+  if(bin < 0) bin = 0;
+  if(bin >= (int)m_Histogram.size()) bin = (int)m_Histogram.size() - 1;
+  m_Histogram[bin]++;
+}
+
+
+double
+LatencyStatistics
+::GetStandardDeviation() const
+{
+  return m_Count > 1 ? sqrt(m_M2 / (m_Count - 1)) : 0;
+}
+
+
+double
+LatencyStatistics
+::GetPercentile(double fraction) const
+{
+  if(m_Count == 0)
+    return 0;
+
+  // Walk the histogram until enough samples are covered; report the bin's upper edge
+  int target = (int)ceil(fraction * m_Count);
+  int seen = 0;
+  for(size_t b = 0; b < m_Histogram.size(); b++)
+  {
+    seen += m_Histogram[b];
+    if(seen >= target)
+      return (b + 1) * m_BinWidth;
+  }
+  return m_Maximum;
+}
+
+
+void
+LatencyStatistics
+::Print(const char* name) const
+{
+  printf("%s: %d samples, mean %.2f ms, jitter (sd) %.2f ms, p50 %.1f ms, p99 %.1f ms, min %.2f ms, max %.2f ms\n",
+    name, m_Count, m_Mean, this->GetStandardDeviation(), this->GetPercentile(0.5), this->GetPercentile(0.99),
+    m_Minimum, m_Maximum);
+}
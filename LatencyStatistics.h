@@ -0,0 +1,61 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef _LatencyStatistics_h
+#define _LatencyStatistics_h
+
+#include <vector>
+
+/** Running mean, standard deviation (jitter), extremes and percentiles of a
+series of durations in milliseconds. Percentiles come from a fixed histogram
+of 0.1 ms bins, so adding a sample costs O(1) and never allocates. */
+class LatencyStatistics
+{
+public:
+
+  /** Constructor; samples above maxMilliseconds land in the last bin */
+  LatencyStatistics(double maxMilliseconds = 1000.0);
+
+  /** Forget all samples */
+  void Reset();
+
+  /** Add one duration */
+  void Add(double milliseconds);
+
+  int GetCount() const { return m_Count; }
+  double GetMean() const { return m_Mean; }
+  double GetStandardDeviation() const;
+  double GetMinimum() const { return m_Minimum; }
+  double GetMaximum() const { return m_Maximum; }
+
+  /** Duration below which the given fraction (0..1) of samples fall */
+  double GetPercentile(double fraction) const;
+
+  /** One line summary to stdout */
+  void Print(const char* name) const;
+
+protected:
+
+  int m_Count;
+  double m_Mean;
+  double m_M2;
+  double m_Minimum;
+  double m_Maximum;
+
+  double m_BinWidth;
+  std::vector<int> m_Histogram;
+};
+
+#endif
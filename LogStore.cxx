@@ -0,0 +1,117 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <QTime>
+
+#include "SessionLogStore.h"
+
+// Command line front end for the session log store:
+//
+//   LogStore <store> ingest "Log File.csv" ...
+//   LogStore <store> query [-epoch e] [-trials first last] [-feature f] [-session s]
+//   LogStore <store> info
+//
+// e.g. the detection rate during the Reach epoch of trials 100-500 in every session:
+//   LogStore sessions.store query -epoch 2 -trials 100 500
+static void PrintUsage()
+{
+  printf("Usage: LogStore <store directory> ingest <log file> [<log file> ...]\n");
+  printf("       LogStore <store directory> query [-epoch e] [-trials first last] [-feature f] [-session s]\n");
+  printf("       LogStore <store directory> info\n");
+}
+
+int main( int argc, char** argv )
+{
+  if(argc < 3)
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  SessionLogStore store(argv[1]);
+  const char* command = argv[2];
+
+  if(strcmp(command, "ingest") == 0)
+  {
+    int failed = 0;
+    for(int i = 3; i < argc; i++)
+      if(!store.Ingest(argv[i]))
+        failed++;
+    return failed > 0 ? 1 : 0;
+  }
+
+  else if(strcmp(command, "info") == 0)
+  {
+    QStringList sessions = store.GetSessions();
+    printf("%lld rows in %i sessions\n", (long long)store.GetNumberOfRows(), sessions.count());
+    for(int s = 0; s < sessions.count(); s++)
+      printf("%4i  %s\n", s, sessions.at(s).toLocal8Bit().constData());
+    return 0;
+  }
+
+  else if(strcmp(command, "query") == 0)
+  {
+    SessionLogStore::Query query;
+    for(int i = 3; i < argc; i++)
+    {
+      if(strcmp(argv[i], "-epoch") == 0 && i + 1 < argc)
+        query.Epoch = atoi(argv[++i]);
+      else if(strcmp(argv[i], "-feature") == 0 && i + 1 < argc)
+        query.Feature = atoi(argv[++i]);
+      else if(strcmp(argv[i], "-session") == 0 && i + 1 < argc)
+        query.Session = atoi(argv[++i]);
+      else if(strcmp(argv[i], "-trials") == 0 && i + 2 < argc)
+      {
+        query.FirstTrial = atoi(argv[++i]);
+        query.LastTrial = atoi(argv[++i]);
+      }
+      else
+      {
+        PrintUsage();
+        return 1;
+      }
+    }
+
+    QTime timer;
+    timer.start();
+    QVector<SessionLogStore::Result> results = store.Run(query);
+    int elapsed = timer.elapsed();
+
+    // Per session lines, then the total over all sessions
+    SessionLogStore::Result total;
+    printf("%s,%s,%s,%s,%s\n", "Session", "Rows", "Tracked", "Detected", "Rate");
+    for(int s = 0; s < results.count(); s++)
+    {
+      const SessionLogStore::Result& r = results[s];
+      if(r.Rows == 0)
+        continue;
+
+      printf("%i,%lld,%lld,%lld,%f\n", s, (long long)r.Rows, (long long)r.Tracked, (long long)r.Detected, r.DetectionRate());
+      total.Rows += r.Rows;
+      total.Tracked += r.Tracked;
+      total.Detected += r.Detected;
+    }
+    printf("%s,%lld,%lld,%lld,%f\n", "All", (long long)total.Rows, (long long)total.Tracked, (long long)total.Detected, total.DetectionRate());
+    printf("Query took %i ms\n", elapsed);
+    return 0;
+  }
+
+  PrintUsage();
+  return 1;
+}
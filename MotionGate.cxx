@@ -0,0 +1,187 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "MotionGate.h"
+
+#include <stdlib.h>
+
+#include "ImagePool.h"
+
+MotionGate
+::MotionGate()
+{
+  // A 640x480 frame becomes an 80x60 thumbnail made of 10x8 blocks
+  m_Scale = 8;
+  m_BlockSize = 8;
+  m_BlocksX = 0;
+  m_BlocksY = 0;
+  m_FrameSize = cvSize(0, 0);
+
+  m_SmallColor = 0;
+  m_SmallGray = 0;
+  m_Reference = 0;
+  m_HasReference = false;
+  m_ImagePool = 0;
+
+  // Sensor noise on a still scene stays well below this after downscaling
+  m_Threshold = 6;
+  m_Margin = 0.25;
+  m_LastUpdateTime = 0;
+}
+
+
+MotionGate
+::~MotionGate()
+{
+  this->ReleaseImages();
+}
+
+
+void
+MotionGate
+::ReleaseImages()
+{
+  ImagePool::Free(m_ImagePool, &m_SmallColor);
+  ImagePool::Free(m_ImagePool, &m_SmallGray);
+  ImagePool::Free(m_ImagePool, &m_Reference);
+
+  m_HasReference = false;
+}
+
+
+void
+MotionGate
+::SetImagePool(ImagePool* pool)
+{
+  this->ReleaseImages();
+  m_FrameSize = cvSize(0, 0);
+  m_ImagePool = pool;
+}
+
+
+void
+MotionGate
+::Update(IplImage* frame)
+{
+  double t = (double)cvGetTickCount();
+
+  // (Re)allocate the thumbnails the first time we see a frame of this size
+  if(frame->width != m_FrameSize.width || frame->height != m_FrameSize.height)
+  {
+    this->ReleaseImages();
+    m_FrameSize = cvSize(frame->width, frame->height);
+
+    CvSize smallSize = cvSize(m_FrameSize.width / m_Scale, m_FrameSize.height / m_Scale);
+    m_SmallColor = ImagePool::Create(m_ImagePool, smallSize, 3);
+    m_SmallGray = ImagePool::Create(m_ImagePool, smallSize, 1);
+    m_Reference = ImagePool::Create(m_ImagePool, smallSize, 1);
+
+    m_BlocksX = (smallSize.width + m_BlockSize - 1) / m_BlockSize;
+    m_BlocksY = (smallSize.height + m_BlockSize - 1) / m_BlockSize;
+    m_BlockDifference.assign(m_BlocksX * m_BlocksY, 0);
+  }
+
+  // Shrink first, then convert, so the color conversion only touches the thumbnail
+  if(frame->nChannels > 1)
+  {
+    cvResize(frame, m_SmallColor, CV_INTER_NN);
+    cvCvtColor(m_SmallColor, m_SmallGray, CV_BGR2GRAY);
+  }
+  else
+    cvResize(frame, m_SmallGray, CV_INTER_NN);
+
+  if(m_HasReference)
+  {
+    for(int by = 0; by < m_BlocksY; by++)
+    {
+      int yEnd = (by + 1) * m_BlockSize;
+      if(yEnd > m_SmallGray->height) yEnd = m_SmallGray->height;
+
+      for(int bx = 0; bx < m_BlocksX; bx++)
+      {
+        int xEnd = (bx + 1) * m_BlockSize;
+        if(xEnd > m_SmallGray->width) xEnd = m_SmallGray->width;
+
+        // Sum of absolute differences over the block
+        int sad = 0;
+        int count = 0;
+        for(int y = by * m_BlockSize; y < yEnd; y++)
+        {
+          unsigned char* cur = (unsigned char*)(m_SmallGray->imageData + y * m_SmallGray->widthStep);
+          unsigned char* ref = (unsigned char*)(m_Reference->imageData + y * m_Reference->widthStep);
+          for(int x = bx * m_BlockSize; x < xEnd; x++)
+            sad += abs((int)cur[x] - (int)ref[x]);
+          count += xEnd - bx * m_BlockSize;
+        }
+
+        m_BlockDifference[by * m_BlocksX + bx] = count > 0 ? sad / count : 0;
+      }
+    }
+  }
+
+  t = (double)cvGetTickCount() - t;
+  m_LastUpdateTime = t / ((double)cvGetTickFrequency() * 1000.0);
+}
+
+
+void
+MotionGate
+::SetReference()
+{
+  if(m_SmallGray == 0)
+    return;
+
+  cvCopy(m_SmallGray, m_Reference);
+  m_HasReference = true;
+}
+
+
+bool
+MotionGate
+::HasMotion(CvRect region) const
+{
+  // Without a reference we can't tell, so ask for a full detection
+  if(!m_HasReference)
+    return true;
+
+  // Grow the region so that motion just outside the last box also counts
+  int x0 = 0, y0 = 0;
+  int x1 = m_FrameSize.width, y1 = m_FrameSize.height;
+  if(region.width > 0 && region.height > 0)
+  {
+    int mx = (int)(region.width * m_Margin);
+    int my = (int)(region.height * m_Margin);
+    x0 = region.x - mx;
+    y0 = region.y - my;
+    x1 = region.x + region.width + mx;
+    y1 = region.y + region.height + my;
+  }
+
+  // Convert from frame pixels to block indices
+  int blockPixels = m_Scale * m_BlockSize;
+  int bx0 = x0 / blockPixels, by0 = y0 / blockPixels;
+  int bx1 = (x1 - 1) / blockPixels, by1 = (y1 - 1) / blockPixels;
+  if(bx0 < 0) bx0 = 0;
+  if(by0 < 0) by0 = 0;
+  if(bx1 >= m_BlocksX) bx1 = m_BlocksX - 1;
+  if(by1 >= m_BlocksY) by1 = m_BlocksY - 1;
+
+  for(int by = by0; by <= by1; by++)
+    for(int bx = bx0; bx <= bx1; bx++)
+      if(m_BlockDifference[by * m_BlocksX + bx] > m_Threshold)
+        return true;
+
+  return false;
+}
@@ -0,0 +1,99 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef _MotionGate_h
+#define _MotionGate_h
+
+#include <vector>
+
+#include <cv.h>
+
+class ImagePool;
+
+/** Cheap motion detector used to decide whether a Haar pass is needed at all.
+Frames are shrunk to a small gray thumbnail and compared block by block (sum of
+absolute differences) against the thumbnail of the frame on which detection last ran. */
+class MotionGate
+{
+public:
+
+  /** Constructor */
+  MotionGate();
+
+  /** Destructor */
+  ~MotionGate();
+
+  /** Shrink the new frame and compute the block differences against the reference */
+  void Update(IplImage* frame);
+
+  /** Remember the current thumbnail as the reference; call after a full detection */
+  void SetReference();
+
+  /** Has anything in or near the region (full frame coordinates) changed since the
+  reference was taken? A region with no width means the whole frame. */
+  bool HasMotion(CvRect region) const;
+
+  /** Mean absolute gray level difference per pixel above which a block counts as moving */
+  void SetThreshold(int threshold) { m_Threshold = threshold; }
+
+  /** Fraction of the region size added on every side when looking for motion */
+  void SetMargin(double margin) { m_Margin = margin; }
+
+  /** Time spent in the last Update() call, in milliseconds */
+  double GetLastUpdateTime() const { return m_LastUpdateTime; }
+
+  /** Borrow the thumbnails from this pool rather than allocating them; 0 for none.
+  The current thumbnails are given back, so the next Update() starts afresh. */
+  void SetImagePool(ImagePool* pool);
+
+protected:
+
+  /** Release the thumbnails, e.g. when the frame size changes */
+  void ReleaseImages();
+
+  /** Downscale factor from the camera frame to the thumbnail */
+  int m_Scale;
+
+  /** Block edge length in thumbnail pixels */
+  int m_BlockSize;
+
+  /** Number of blocks in each direction */
+  int m_BlocksX, m_BlocksY;
+
+  /** Size of the frames the thumbnails were made for */
+  CvSize m_FrameSize;
+
+  /** Small color and gray copies of the current frame */
+  IplImage* m_SmallColor;
+  IplImage* m_SmallGray;
+
+  /** Thumbnail of the frame detection last ran on */
+  IplImage* m_Reference;
+
+  /** Where the thumbnails come from, or 0 */
+  ImagePool* m_ImagePool;
+
+  /** False until SetReference() has been called for the current frame size */
+  bool m_HasReference;
+
+  /** Mean absolute difference per pixel, one entry per block */
+  std::vector<int> m_BlockDifference;
+
+  int m_Threshold;
+  double m_Margin;
+  double m_LastUpdateTime;
+};
+
+#endif
@@ -0,0 +1,39 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "ParallelFor.h"
+
+static void SerialFor(int count, ParallelForBody body, void* data)
+{
+  for(int i = 0; i < count; i++)
+    body(data, i);
+}
+
+static ParallelForFunction InstalledFor = SerialFor;
+
+
+void SetParallelFor(ParallelForFunction function)
+{
+  InstalledFor = function ? function : SerialFor;
+}
+
+
+void ParallelFor(int count, ParallelForBody body, void* data)
+{
+  // A single item isn't worth a thread hop
+  if(count == 1)
+    body(data, 0);
+  else if(count > 1)
+    InstalledFor(count, body, data);
+}
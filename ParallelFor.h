@@ -0,0 +1,32 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _ParallelFor_h
+#define _ParallelFor_h
+
+/** Body of a parallel loop; called once for every index, possibly on several threads at once */
+typedef void (*ParallelForBody)(void* data, int index);
+
+/** Runs body for the indices 0 .. count-1 and returns when all of them are done */
+typedef void (*ParallelForFunction)(int count, ParallelForBody body, void* data);
+
+/** The detection library has no threads of its own. Detectors that can split their work
+hand it to ParallelFor(), which runs it serially unless the host program installs a
+function that runs it on its threads, e.g. QtParallelFor. Install it before detection starts. */
+void SetParallelFor(ParallelForFunction function);
+
+/** Run a loop with the installed function */
+void ParallelFor(int count, ParallelForBody body, void* data);
+
+#endif
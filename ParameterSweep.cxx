@@ -0,0 +1,353 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cv.h>
+#include <highgui.h>
+
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QtConcurrentMap>
+
+#include "AttentionTracker.h"
+#include "DetectionProfile.h"
+
+// Runs every cascade of an annotated frame corpus over a grid of detection
+// settings and writes the speed/accuracy Pareto front of each cascade as a
+// detection profile the app loads at startup.
+//
+//   ParameterSweep <corpus> [-o DetectionProfile.txt] [-threads n] [-width pixels]
+//
+// The corpus has one annotation per line:
+//   <image file> <cascade file> <x> <y> <width> <height>
+// with -1 -1 -1 -1 for frames in which the feature is not visible.
+//
+// Every image is first shrunk to at most -width pixels wide (640 by default,
+// the width the app and BatchReprocess detect at) with its annotations scaled
+// to match, so MinSize and InputScale are picked at the scale they are used.
+// Sweep a second profile with -width 320 for the intertrial detection width.
+
+// The grid
+static const double ScaleFactors[] = { 1.05, 1.1, 1.2, 1.3 };
+static const int MinNeighbors[] = { 1, 2, 3, 4 };
+static const int MinSizes[] = { 10, 20, 30 };
+static const int Flags[] = {
+  CV_HAAR_FIND_BIGGEST_OBJECT | CV_HAAR_DO_ROUGH_SEARCH,
+  CV_HAAR_FIND_BIGGEST_OBJECT,
+  CV_HAAR_DO_CANNY_PRUNING,
+  0 };
+static const double InputScales[] = { 1.0, 0.75, 0.5 };
+
+#define GRID_SIZE(a) ((int)(sizeof(a) / sizeof(a[0])))
+
+// A detection counts as a hit if it overlaps the annotation by at least this much
+static const double MinOverlap = 0.5;
+
+
+/** One annotated frame, pre-shrunk to every input scale of the grid */
+struct Frame
+{
+  std::vector<IplImage*> Scaled;
+  CvRect Truth;
+};
+
+/** One cascade/setting combination and its measured performance */
+struct SweepTask
+{
+  std::string Cascade;
+  DetectionParameters Parameters;
+  int ScaleIndex;
+  const std::vector<Frame>* Frames;
+};
+
+
+/** cvHaarDetectObjects keeps per-image state inside the cascade, so each worker thread loads its own copies */
+struct CascadeCache
+{
+  ~CascadeCache()
+  {
+    std::map<std::string, CvHaarClassifierCascade*>::iterator it;
+    for(it = Cascades.begin(); it != Cascades.end(); ++it)
+      cvReleaseHaarClassifierCascade(&it->second);
+  }
+
+  std::map<std::string, CvHaarClassifierCascade*> Cascades;
+};
+
+static QThreadStorage<CascadeCache*> ThreadCascades;
+
+static CvHaarClassifierCascade* GetThreadCascade(const std::string& name)
+{
+  if(!ThreadCascades.hasLocalData())
+    ThreadCascades.setLocalData(new CascadeCache);
+
+  CvHaarClassifierCascade*& cascade = ThreadCascades.localData()->Cascades[name];
+  if(cascade == 0)
+    cascade = (CvHaarClassifierCascade*)cvLoad(name.c_str(), 0, 0, 0);
+  return cascade;
+}
+
+
+/** Intersection over union of two rectangles */
+static double Overlap(CvRect a, CvRect b)
+{
+  int x0 = std::max(a.x, b.x), y0 = std::max(a.y, b.y);
+  int x1 = std::min(a.x + a.width, b.x + b.width), y1 = std::min(a.y + a.height, b.y + b.height);
+  if(x1 <= x0 || y1 <= y0)
+    return 0;
+
+  double intersection = (double)(x1 - x0) * (y1 - y0);
+  return intersection / ((double)a.width * a.height + (double)b.width * b.height - intersection);
+}
+
+
+/** Run one setting over all frames of its cascade */
+static void RunTask(SweepTask& task)
+{
+  CvHaarClassifierCascade* cascade = GetThreadCascade(task.Cascade);
+  if(cascade == 0)
+    return;
+
+  const DetectionParameters& p = task.Parameters;
+  CvMemStorage* storage = cvCreateMemStorage(0);
+  const std::vector<Frame>& frames = *task.Frames;
+
+  double ticks = 0;
+  int correct = 0;
+  for(size_t f = 0; f < frames.size(); f++)
+  {
+    cvClearMemStorage(storage);
+
+    double t = (double)cvGetTickCount();
+    CvSeq* rects = cvHaarDetectObjects(frames[f].Scaled[task.ScaleIndex], cascade, storage,
+      p.ScaleFactor, p.MinNeighbors, p.Flags, cvSize(p.MinSize, p.MinSize));
+    ticks += (double)cvGetTickCount() - t;
+
+    // The app keeps the biggest object, so do the same here
+    CvRect best = cvRect(-1, -1, -1, -1);
+    for(int r = 0; r < (rects ? rects->total : 0); r++)
+    {
+      CvRect rect = *(CvRect*)cvGetSeqElem(rects, r);
+      if(rect.width * rect.height > best.width * best.height)
+        best = rect;
+    }
+
+    const CvRect& truth = frames[f].Truth;
+    if(truth.width <= 0)
+    {
+      if(best.width <= 0)
+        correct++;
+    }
+    else if(best.width > 0)
+    {
+      CvRect found = cvRect(cvRound(best.x / p.InputScale), cvRound(best.y / p.InputScale),
+        cvRound(best.width / p.InputScale), cvRound(best.height / p.InputScale));
+      if(Overlap(found, truth) >= MinOverlap)
+        correct++;
+    }
+  }
+
+  cvReleaseMemStorage(&storage);
+
+  task.Parameters.Latency = ticks / (cvGetTickFrequency() * 1000.0) / frames.size();
+  task.Parameters.HitRate = (double)correct / frames.size();
+}
+
+
+static bool FasterFirst(const SweepTask& a, const SweepTask& b)
+{
+  if(a.Parameters.Latency != b.Parameters.Latency)
+    return a.Parameters.Latency < b.Parameters.Latency;
+  return a.Parameters.HitRate > b.Parameters.HitRate;
+}
+
+
+int main( int argc, char** argv )
+{
+  if(argc < 2)
+  {
+    printf("Usage: ParameterSweep <corpus> [-o DetectionProfile.txt] [-threads n] [-width pixels]\n");
+    return 1;
+  }
+
+  const char* profileName = "DetectionProfile.txt";
+  int detectionWidth = 640;
+  for(int i = 2; i + 1 < argc; i++)
+  {
+    if(strcmp(argv[i], "-o") == 0)
+      profileName = argv[++i];
+    else if(strcmp(argv[i], "-threads") == 0)
+      QThreadPool::globalInstance()->setMaxThreadCount(atoi(argv[++i]));
+    else if(strcmp(argv[i], "-width") == 0)
+      detectionWidth = atoi(argv[++i]);
+  }
+  if(detectionWidth <= 0)
+  {
+    printf("-width must be positive\n");
+    return 1;
+  }
+
+  FILE* corpus = fopen(argv[1], "r");
+  if(corpus == 0)
+  {
+    printf("Couldnt open corpus '%s'\n", argv[1]);
+    return 1;
+  }
+
+  // Read the annotations, loading and shrinking every image only once
+  std::map<std::string, std::vector<IplImage*> > images;
+  std::map<std::string, double> shrinks;
+  std::map<std::string, std::vector<Frame> > frames;
+  char line[2048], imageName[1024], cascadeName[1024];
+  while(fgets(line, sizeof(line), corpus))
+  {
+    Frame frame;
+    if(line[0] == '#' || sscanf(line, "%1023s %1023s %d %d %d %d", imageName, cascadeName,
+      &frame.Truth.x, &frame.Truth.y, &frame.Truth.width, &frame.Truth.height) != 6)
+      continue;
+
+    std::vector<IplImage*>& scaled = images[imageName];
+    if(scaled.empty())
+    {
+      IplImage* image = cvLoadImage(imageName, CV_LOAD_IMAGE_GRAYSCALE);
+      if(image == 0)
+      {
+        printf("Couldnt load image '%s'\n", imageName);
+        images.erase(imageName);
+        continue;
+      }
+
+      // Down to the width the app detects at, as ShrinkFrame does
+      CvSize detectionSize = AttentionTracker::GetDetectionSize(cvGetSize(image), detectionWidth);
+      shrinks[imageName] = (double)detectionSize.width / image->width;
+      if(detectionSize.width != image->width)
+      {
+        IplImage* detection = cvCreateImage(detectionSize, IPL_DEPTH_8U, 1);
+        cvResize(image, detection, CV_INTER_LINEAR);
+        cvReleaseImage(&image);
+        image = detection;
+      }
+
+      scaled.push_back(image);
+      for(int s = 1; s < GRID_SIZE(InputScales); s++)
+      {
+        CvSize size = cvSize(cvRound(image->width * InputScales[s]), cvRound(image->height * InputScales[s]));
+        IplImage* small = cvCreateImage(size, IPL_DEPTH_8U, 1);
+        cvResize(image, small, CV_INTER_LINEAR);
+        scaled.push_back(small);
+      }
+    }
+
+    // The annotation is in the coordinates of the full-size image
+    double shrink = shrinks[imageName];
+    if(frame.Truth.width > 0 && shrink != 1.0)
+      frame.Truth = cvRect(cvRound(frame.Truth.x * shrink), cvRound(frame.Truth.y * shrink),
+        cvRound(frame.Truth.width * shrink), cvRound(frame.Truth.height * shrink));
+
+    frame.Scaled = scaled;
+    frames[cascadeName].push_back(frame);
+  }
+  fclose(corpus);
+
+  // Every cascade against every point of the grid
+  std::vector<SweepTask> tasks;
+  std::map<std::string, std::vector<Frame> >::iterator it;
+  for(it = frames.begin(); it != frames.end(); ++it)
+  {
+    printf("%s: %d annotated frames\n", it->first.c_str(), (int)it->second.size());
+
+    for(int s = 0; s < GRID_SIZE(ScaleFactors); s++)
+      for(int n = 0; n < GRID_SIZE(MinNeighbors); n++)
+        for(int m = 0; m < GRID_SIZE(MinSizes); m++)
+          for(int f = 0; f < GRID_SIZE(Flags); f++)
+            for(int i = 0; i < GRID_SIZE(InputScales); i++)
+            {
+              SweepTask task;
+              task.Cascade = it->first;
+              task.Parameters.ScaleFactor = ScaleFactors[s];
+              task.Parameters.MinNeighbors = MinNeighbors[n];
+              task.Parameters.MinSize = MinSizes[m];
+              task.Parameters.Flags = Flags[f];
+              task.Parameters.InputScale = InputScales[i];
+              task.ScaleIndex = i;
+              task.Frames = &it->second;
+              tasks.push_back(task);
+            }
+  }
+
+  printf("Running %d settings on %d threads\n", (int)tasks.size(), QThreadPool::globalInstance()->maxThreadCount());
+  QtConcurrent::blockingMap(tasks, RunTask);
+
+  // Keep the existing entries of cascades that weren't swept
+  DetectionProfile profile;
+  profile.Load(profileName);
+
+  // Full results for later inspection
+  FILE* results = fopen("ParameterSweep.csv", "w");
+  fprintf(results, "%s,%s,%s,%s,%s,%s,%s,%s,%s\n", "Cascade", "ScaleFactor", "MinNeighbors", "MinSize",
+    "Flags", "InputScale", "Latency", "HitRate", "Pareto");
+
+  // Walking each cascade's settings from fastest to slowest, a setting is on the
+  // Pareto front if it is more accurate than everything faster than it
+  std::sort(tasks.begin(), tasks.end(), FasterFirst);
+  for(it = frames.begin(); it != frames.end(); ++it)
+  {
+    profile.Clear(it->first);
+    printf("\n%s\n  %8s %5s %4s %5s %5s %10s %8s\n", it->first.c_str(), "scale", "neigh", "size", "flags", "input", "latency", "hitrate");
+
+    double bestHitRate = -1;
+    for(size_t t = 0; t < tasks.size(); t++)
+    {
+      const SweepTask& task = tasks[t];
+      if(task.Cascade != it->first)
+        continue;
+
+      const DetectionParameters& p = task.Parameters;
+      bool pareto = p.HitRate > bestHitRate;
+      fprintf(results, "%s,%g,%d,%d,%d,%g,%f,%f,%d\n", task.Cascade.c_str(), p.ScaleFactor, p.MinNeighbors,
+        p.MinSize, p.Flags, p.InputScale, p.Latency, p.HitRate, pareto ? 1 : 0);
+
+      if(pareto)
+      {
+        bestHitRate = p.HitRate;
+        profile.Add(task.Cascade, p);
+        printf("  %8g %5d %4d %5d %5g %8.2fms %8.3f\n", p.ScaleFactor, p.MinNeighbors, p.MinSize,
+          p.Flags, p.InputScale, p.Latency, p.HitRate);
+      }
+    }
+  }
+  fclose(results);
+
+  if(!profile.Save(profileName))
+  {
+    printf("Couldnt write profile '%s'\n", profileName);
+    return 1;
+  }
+  printf("\nWrote Pareto fronts to '%s' and all results to ParameterSweep.csv\n", profileName);
+
+  for(std::map<std::string, std::vector<IplImage*> >::iterator im = images.begin(); im != images.end(); ++im)
+    for(size_t s = 0; s < im->second.size(); s++)
+      cvReleaseImage(&im->second[s]);
+
+  return 0;
+}
@@ -0,0 +1,220 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <cv.h>
+
+#include "PixelKernels.h"
+
+// Checks the pixel kernels of every instruction set this CPU can run against the
+// scalar baseline, byte for byte, then times them on full frames:
+//
+//   PixelKernelBenchmark [-width 1920] [-height 1080] [-seconds 0.25]
+//
+// The check covers odd and unaligned widths, where vector loops hand over to their
+// scalar tails. Exits with 1 if any variant differs from the baseline, so a compiler
+// or flag change that breaks one shows up before it reaches the lab machines.
+
+/** Frame buffers for one kernel call per row; input rows are followed by as many
+again so the NV12 kernel finds its chroma rows below the luma */
+struct Frame
+{
+  int Width;
+  int Height;
+  int Step;
+  std::vector<unsigned char> In;
+  std::vector<unsigned char> Out;
+};
+
+typedef void (*RunKernel)(const PixelKernels& kernels, Frame& frame);
+
+static void RunBgr(const PixelKernels& kernels, Frame& frame)
+{
+  for(int y = 0; y < frame.Height; y++)
+    kernels.BgrToRGB32(&frame.In[y * frame.Step], &frame.Out[y * frame.Step], frame.Width);
+}
+
+static void RunBgra(const PixelKernels& kernels, Frame& frame)
+{
+  for(int y = 0; y < frame.Height; y++)
+    kernels.BgraToRGB32(&frame.In[y * frame.Step], &frame.Out[y * frame.Step], frame.Width);
+}
+
+static void RunGray(const PixelKernels& kernels, Frame& frame)
+{
+  for(int y = 0; y < frame.Height; y++)
+    kernels.GrayToRGB32(&frame.In[y * frame.Step], &frame.Out[y * frame.Step], frame.Width);
+}
+
+static void RunYuyv(const PixelKernels& kernels, Frame& frame)
+{
+  for(int y = 0; y < frame.Height; y++)
+    kernels.YuyvToRGB32(&frame.In[y * frame.Step], &frame.Out[y * frame.Step], frame.Width);
+}
+
+static void RunNv12(const PixelKernels& kernels, Frame& frame)
+{
+  for(int y = 0; y < frame.Height; y++)
+    kernels.Nv12ToRGB32(&frame.In[y * frame.Step], &frame.In[(frame.Height + y / 2) * frame.Step],
+      &frame.Out[y * frame.Step], frame.Width);
+}
+
+static void RunLuma(const PixelKernels& kernels, Frame& frame)
+{
+  for(int y = 0; y < frame.Height; y++)
+    kernels.YuyvToLuma(&frame.In[y * frame.Step], &frame.Out[y * frame.Step], frame.Width);
+}
+
+static const struct { const char* Name; RunKernel Run; } Kernels[] =
+{
+  { "BgrToRGB32", RunBgr },
+  { "BgraToRGB32", RunBgra },
+  { "GrayToRGB32", RunGray },
+  { "YuyvToRGB32", RunYuyv },
+  { "Nv12ToRGB32", RunNv12 },
+  { "YuyvToLuma", RunLuma }
+};
+static const int NumberOfKernels = sizeof(Kernels) / sizeof(Kernels[0]);
+
+
+static unsigned int NextRandom(unsigned int& state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+
+/** Random input, and output filled with a marker so bytes a kernel must leave alone are compared too */
+static void InitFrame(Frame& frame, int width, int height, unsigned int seed)
+{
+  frame.Width = width;
+  frame.Height = height;
+  frame.Step = 4 * width + 4;
+  frame.In.resize(2 * height * frame.Step);
+  frame.Out.assign(height * frame.Step, 0xcd);
+  for(size_t i = 0; i < frame.In.size(); i++)
+    frame.In[i] = (unsigned char)(NextRandom(seed) >> 24);
+}
+
+
+/** Every available variant against the baseline; returns the number of mismatches */
+static int CheckKernels(const PixelKernels& baseline)
+{
+  static const int Widths[] = { 1, 2, 3, 7, 15, 16, 17, 31, 33, 63, 64, 65, 640, 641, 1920 };
+  int mismatches = 0;
+  for(int isa = BaselineIsa + 1; isa < NumberOfPixelIsas; isa++)
+  {
+    const PixelKernels* kernels = GetPixelKernels((PixelIsa)isa);
+    if(kernels == 0)
+      continue;
+
+    for(int k = 0; k < NumberOfKernels; k++)
+      for(size_t w = 0; w < sizeof(Widths) / sizeof(Widths[0]); w++)
+      {
+        // Both get the same input from the same seed
+        Frame expected, actual;
+        InitFrame(expected, Widths[w], 4, 12345 + Widths[w]);
+        InitFrame(actual, Widths[w], 4, 12345 + Widths[w]);
+        Kernels[k].Run(baseline, expected);
+        Kernels[k].Run(*kernels, actual);
+        if(expected.Out != actual.Out)
+        {
+          printf("MISMATCH %s %s at width %d\n", kernels->Name, Kernels[k].Name, Widths[w]);
+          mismatches++;
+        }
+      }
+  }
+  return mismatches;
+}
+
+
+/** Milliseconds per frame, running for at least the given time */
+static double TimeKernel(const PixelKernels& kernels, RunKernel run, Frame& frame, double seconds)
+{
+  double ticksPerSecond = cvGetTickFrequency() * 1000000.0;
+  run(kernels, frame);
+
+  int runs = 0;
+  double start = (double)cvGetTickCount();
+  double elapsed = 0;
+  while(runs < 3 || elapsed < seconds)
+  {
+    run(kernels, frame);
+    runs++;
+    elapsed = ((double)cvGetTickCount() - start) / ticksPerSecond;
+  }
+  return elapsed * 1000.0 / runs;
+}
+
+
+int main( int argc, char** argv )
+{
+  int width = 1920;
+  int height = 1080;
+  double seconds = 0.25;
+  for(int i = 1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-width") == 0 && i + 1 < argc)
+      width = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-height") == 0 && i + 1 < argc)
+      height = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-seconds") == 0 && i + 1 < argc)
+      seconds = atof(argv[++i]);
+    else
+    {
+      printf("Usage: PixelKernelBenchmark [-width 1920] [-height 1080] [-seconds 0.25]\n");
+      return 1;
+    }
+  }
+
+  const PixelKernels& baseline = *GetPixelKernels(BaselineIsa);
+  printf("Available:");
+  for(int isa = BaselineIsa; isa < NumberOfPixelIsas; isa++)
+    if(GetPixelKernels((PixelIsa)isa))
+      printf(" %s", GetPixelKernels((PixelIsa)isa)->Name);
+  printf(", the app uses %s\n", GetPixelKernels().Name);
+
+  int mismatches = CheckKernels(baseline);
+  if(mismatches)
+  {
+    printf("%d kernel and width combinations differ from the baseline\n", mismatches);
+    return 1;
+  }
+  printf("All variants match the baseline\n\n");
+
+  Frame frame;
+  InitFrame(frame, width, height, 1);
+  printf("%-12s %-9s %10s %8s   (%dx%d)\n", "Kernel", "ISA", "ms/frame", "Speedup", width, height);
+  for(int k = 0; k < NumberOfKernels; k++)
+  {
+    double baselineTime = TimeKernel(baseline, Kernels[k].Run, frame, seconds);
+    printf("%-12s %-9s %10.3f %7.2fx\n", Kernels[k].Name, baseline.Name, baselineTime, 1.0);
+    for(int isa = BaselineIsa + 1; isa < NumberOfPixelIsas; isa++)
+    {
+      const PixelKernels* kernels = GetPixelKernels((PixelIsa)isa);
+      if(kernels == 0)
+        continue;
+      double time = TimeKernel(*kernels, Kernels[k].Run, frame, seconds);
+      printf("%-12s %-9s %10.3f %7.2fx\n", Kernels[k].Name, kernels->Name, time, baselineTime / time);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+// The pixel kernels themselves, included once by each PixelKernels*.cxx, which are
+// compiled with their own instruction set flags. Define PIXEL_KERNELS_TABLE and
+// PIXEL_KERNELS_NAME before including.
+//
+// The loops are kept plain so the compiler vectorizes them for the target, and use
+// integer arithmetic only, so every instruction set gives the same bytes. Everything
+// here has internal linkage and nothing calls into inline library code: a shared
+// inline function compiled with AVX2 flags could otherwise be picked by the linker
+// for every caller and crash older CPUs. memcpy is a compiler builtin and safe.
+
+#include <string.h>
+
+namespace
+{
+
+inline int ClampByte(int value)
+{
+  return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+
+/** One pixel, in fixed point with 8 fractional bits */
+inline void YuvToRGB32(int y, int d, int e, unsigned char* out)
+{
+  int c = 298 * (y - 16) + 128;
+  out[0] = (unsigned char)ClampByte((c + 516 * d) >> 8);
+  out[1] = (unsigned char)ClampByte((c - 100 * d - 208 * e) >> 8);
+  out[2] = (unsigned char)ClampByte((c + 409 * e) >> 8);
+  out[3] = 255;
+}
+
+
+void BgrToRGB32(const unsigned char* __restrict in, unsigned char* __restrict out, int width)
+{
+  for(int x = 0; x < width; x++)
+  {
+    out[4 * x] = in[3 * x];
+    out[4 * x + 1] = in[3 * x + 1];
+    out[4 * x + 2] = in[3 * x + 2];
+    out[4 * x + 3] = 255;
+  }
+}
+
+
+void BgraToRGB32(const unsigned char* __restrict in, unsigned char* __restrict out, int width)
+{
+  // Copying the row and then setting alpha beats a byte shuffle without SSSE3
+  memcpy(out, in, 4 * width);
+  for(int x = 0; x < width; x++)
+    out[4 * x + 3] = 255;
+}
+
+
+void GrayToRGB32(const unsigned char* __restrict in, unsigned char* __restrict out, int width)
+{
+  for(int x = 0; x < width; x++)
+  {
+    out[4 * x] = in[x];
+    out[4 * x + 1] = in[x];
+    out[4 * x + 2] = in[x];
+    out[4 * x + 3] = 255;
+  }
+}
+
+
+void YuyvToRGB32(const unsigned char* __restrict in, unsigned char* __restrict out, int width)
+{
+  // Y0,U,Y1,V: two pixels share each chroma pair
+  int pairs = width / 2;
+  for(int i = 0; i < pairs; i++)
+  {
+    int d = in[4 * i + 1] - 128;
+    int e = in[4 * i + 3] - 128;
+    YuvToRGB32(in[4 * i], d, e, out + 8 * i);
+    YuvToRGB32(in[4 * i + 2], d, e, out + 8 * i + 4);
+  }
+}
+
+
+void Nv12ToRGB32(const unsigned char* __restrict luma, const unsigned char* __restrict chroma,
+  unsigned char* __restrict out, int width)
+{
+  // Each U,V pair covers two pixels of this row and two of the next
+  int pairs = width / 2;
+  for(int i = 0; i < pairs; i++)
+  {
+    int d = chroma[2 * i] - 128;
+    int e = chroma[2 * i + 1] - 128;
+    YuvToRGB32(luma[2 * i], d, e, out + 8 * i);
+    YuvToRGB32(luma[2 * i + 1], d, e, out + 8 * i + 4);
+  }
+  if(width & 1)
+    YuvToRGB32(luma[width - 1], chroma[width - 1] - 128, chroma[width] - 128, out + 4 * (width - 1));
+}
+
+
+void YuyvToLuma(const unsigned char* __restrict in, unsigned char* __restrict out, int width)
+{
+  for(int x = 0; x < width; x++)
+    out[x] = in[2 * x];
+}
+
+}
+
+extern const PixelKernels PIXEL_KERNELS_TABLE;
+const PixelKernels PIXEL_KERNELS_TABLE =
+{
+  PIXEL_KERNELS_NAME,
+  BgrToRGB32,
+  BgraToRGB32,
+  GrayToRGB32,
+  YuyvToRGB32,
+  Nv12ToRGB32,
+  YuyvToLuma
+};
@@ -0,0 +1,138 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "PixelKernels.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PIXEL_KERNELS_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// The scalar reference; the build keeps the compiler from vectorizing this copy
+#define PIXEL_KERNELS_TABLE BaselinePixelKernels
+#define PIXEL_KERNELS_NAME "baseline"
+#include "PixelKernelRows.h"
+
+#ifdef PIXEL_KERNELS_X86
+extern const PixelKernels Sse2PixelKernels;
+extern const PixelKernels Avx2PixelKernels;
+extern const PixelKernels Avx512PixelKernels;
+#endif
+
+static const char* IsaNames[NumberOfPixelIsas] = { "baseline", "sse2", "avx2", "avx512" };
+
+
+/** Whether the CPU, and the OS for the wider registers, supports an instruction set */
+static bool CpuSupports(PixelIsa isa)
+{
+#if !defined(PIXEL_KERNELS_X86)
+  return isa == BaselineIsa;
+#elif defined(__GNUC__)
+  __builtin_cpu_init();
+  switch(isa)
+  {
+    case BaselineIsa: return true;
+    case Sse2Isa: return __builtin_cpu_supports("sse2") != 0;
+    case Avx2Isa: return __builtin_cpu_supports("avx2") != 0;
+    case Avx512Isa: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    default: return false;
+  }
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  int maxLeaf = info[0];
+  __cpuid(info, 1);
+  bool sse2 = (info[3] & (1 << 26)) != 0;
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx = (info[2] & (1 << 28)) != 0;
+  int leaf7 = 0;
+  if(maxLeaf >= 7)
+  {
+    __cpuidex(info, 7, 0);
+    leaf7 = info[1];
+  }
+
+  // The OS has to save the YMM (and for AVX-512 the ZMM and mask) registers too
+  unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  bool ymm = (xcr0 & 0x06) == 0x06;
+  bool zmm = (xcr0 & 0xe6) == 0xe6;
+  switch(isa)
+  {
+    case BaselineIsa: return true;
+    case Sse2Isa: return sse2;
+    case Avx2Isa: return avx && ymm && (leaf7 & (1 << 5));
+    case Avx512Isa: return zmm && (leaf7 & (1 << 16)) && (leaf7 & (1 << 30));
+    default: return false;
+  }
+#else
+  return isa == BaselineIsa;
+#endif
+}
+
+
+const PixelKernels*
+GetPixelKernels(PixelIsa isa)
+{
+  if(!CpuSupports(isa))
+    return 0;
+
+  switch(isa)
+  {
+    case BaselineIsa: return &BaselinePixelKernels;
+#ifdef PIXEL_KERNELS_X86
+    case Sse2Isa: return &Sse2PixelKernels;
+    case Avx2Isa: return &Avx2PixelKernels;
+    case Avx512Isa: return &Avx512PixelKernels;
+#endif
+    default: return 0;
+  }
+}
+
+
+static const PixelKernels* ChoosePixelKernels()
+{
+  int highest = NumberOfPixelIsas - 1;
+  const char* cap = getenv("PIXEL_KERNELS");
+  if(cap)
+  {
+    for(highest = NumberOfPixelIsas - 1; highest > 0; highest--)
+      if(strcmp(cap, IsaNames[highest]) == 0)
+        break;
+    if(highest == 0 && strcmp(cap, IsaNames[0]) != 0)
+    {
+      fprintf(stderr, "Unknown PIXEL_KERNELS %s, using the best available\n", cap);
+      highest = NumberOfPixelIsas - 1;
+    }
+  }
+
+  for(int isa = highest; isa > BaselineIsa; isa--)
+  {
+    const PixelKernels* kernels = GetPixelKernels((PixelIsa)isa);
+    if(kernels)
+      return kernels;
+  }
+  return &BaselinePixelKernels;
+}
+
+
+const PixelKernels&
+GetPixelKernels()
+{
+  // The first call comes from the app or tool's own setup, before the worker threads
+  static const PixelKernels* kernels = ChoosePixelKernels();
+  return *kernels;
+}
@@ -0,0 +1,54 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _PixelKernels_h
+#define _PixelKernels_h
+
+/** Instruction sets the pixel kernels are built for */
+enum PixelIsa { BaselineIsa, Sse2Isa, Avx2Isa, Avx512Isa, NumberOfPixelIsas };
+
+/** The pixel loops the app runs on every frame, one image row per call. The same
+source (PixelKernelRows.h) is compiled once per instruction set, so every variant
+produces identical bytes, and GetPixelKernels() picks the best one the CPU can run.
+Output rows are B,G,R,X bytes, the layout of a Format_RGB32 QImage. The rectangle
+overlap checks (FeatureTracker::intersect()) aren't here: they compare one or two
+pairs of rectangles a frame, which an indirect call would cost more than it saves. */
+struct PixelKernels
+{
+  /** For the console, e.g. "avx2" */
+  const char* Name;
+
+  /** 3 channel BGR, 4 channel BGRA and 1 channel gray to B,G,R,X */
+  void (*BgrToRGB32)(const unsigned char* in, unsigned char* out, int width);
+  void (*BgraToRGB32)(const unsigned char* in, unsigned char* out, int width);
+  void (*GrayToRGB32)(const unsigned char* in, unsigned char* out, int width);
+
+  /** BT.601 video range YUV to B,G,R,X, from packed Y,U,Y,V pairs (an odd last pixel
+  is left alone), or from an NV12 luma row and the interleaved U,V row that covers it */
+  void (*YuyvToRGB32)(const unsigned char* in, unsigned char* out, int width);
+  void (*Nv12ToRGB32)(const unsigned char* luma, const unsigned char* chroma, unsigned char* out, int width);
+
+  /** The Y samples of a packed YUYV row */
+  void (*YuyvToLuma)(const unsigned char* in, unsigned char* out, int width);
+};
+
+/** Kernels for the best instruction set this CPU supports, chosen on the first call.
+The PIXEL_KERNELS environment variable (baseline, sse2, avx2 or avx512) caps the
+choice, e.g. to rule the kernels out when chasing a problem on one machine. */
+const PixelKernels& GetPixelKernels();
+
+/** Kernels for one instruction set, or 0 if they weren't built or this CPU can't run them */
+const PixelKernels* GetPixelKernels(PixelIsa isa);
+
+#endif
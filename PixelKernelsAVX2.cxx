@@ -0,0 +1,20 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "PixelKernels.h"
+
+// Built with AVX2 code generation; only called on CPUs that have it
+#define PIXEL_KERNELS_TABLE Avx2PixelKernels
+#define PIXEL_KERNELS_NAME "avx2"
+#include "PixelKernelRows.h"
@@ -0,0 +1,265 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "PreprocessCache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include "AttentionTracker.h"
+
+// Flags and frames start on page boundaries
+static const long long PageSize = 4096;
+static const char Magic[8] = { 'A', 'T', 'C', 'A', 'C', 'H', 'E', 0 };
+static const int Version = 1;
+
+static long long RoundUpToPage(long long bytes)
+{
+  return (bytes + PageSize - 1) / PageSize * PageSize;
+}
+
+
+PreprocessCache::Range
+::Range()
+{
+  m_Cache = 0;
+  m_Data = 0;
+  m_Begin = 0;
+  m_End = 0;
+}
+
+
+PreprocessCache::Range
+::~Range()
+{
+  this->Unmap();
+}
+
+
+bool
+PreprocessCache::Range
+::Map(const PreprocessCache& cache, int begin, int end)
+{
+  this->Unmap();
+  begin = std::max(begin, 0);
+  end = std::min(end, cache.GetNumberOfFrames());
+  if(!cache.IsOpen() || begin >= end)
+    return false;
+
+  // Every range has its own file, as QFile's mappings aren't thread safe
+  m_File.setFileName(QString::fromStdString(cache.m_Filename));
+  if(!m_File.open(QFile::ReadWrite))
+    return false;
+
+  long long frameBytes = cache.m_Header.FrameBytes;
+  m_Data = m_File.map(cache.m_Header.DataOffset + begin * frameBytes, (long long)(end - begin) * frameBytes);
+  if(m_Data == 0)
+  {
+    m_File.close();
+    return false;
+  }
+
+  m_Cache = &cache;
+  m_Begin = begin;
+  m_End = end;
+  return true;
+}
+
+
+void
+PreprocessCache::Range
+::Unmap()
+{
+  if(m_Data == 0)
+    return;
+
+  m_File.unmap(m_Data);
+  m_File.close();
+  m_Data = 0;
+  m_Cache = 0;
+  m_Begin = m_End = 0;
+}
+
+
+void
+PreprocessCache::Range
+::GetLevel(int frame, int level, IplImage* header) const
+{
+  const Header& h = m_Cache->m_Header;
+  cvInitImageHeader(header, cvSize(h.Widths[level], h.Heights[level]), IPL_DEPTH_8U, 1);
+  cvSetData(header, m_Data + (frame - m_Begin) * h.FrameBytes + m_Cache->GetLevelOffset(level), h.Widths[level]);
+}
+
+
+void
+PreprocessCache::Range
+::StoreLevel(int frame, int level, const IplImage* gray)
+{
+  IplImage stored;
+  this->GetLevel(frame, level, &stored);
+  cvCopy(gray, &stored);
+}
+
+
+PreprocessCache
+::PreprocessCache()
+{
+  memset(&m_Header, 0, sizeof(m_Header));
+  m_Mapped = 0;
+  m_Stored = 0;
+  m_FramesAtOpen = 0;
+}
+
+
+PreprocessCache
+::~PreprocessCache()
+{
+  this->Close();
+}
+
+
+long long
+PreprocessCache
+::GetLevelOffset(int level) const
+{
+  long long offset = 0;
+  for(int l = 0; l < level; l++)
+    offset += (long long)m_Header.Widths[l] * m_Header.Heights[l];
+  return offset;
+}
+
+
+bool
+PreprocessCache
+::Open(const std::string& filename, const std::string& video, int frames, CvSize frameSize,
+  const std::vector<int>& widths)
+{
+  this->Close();
+  if(frames <= 0 || widths.empty())
+    return false;
+
+  // What the cache must have been made from and with
+  QFileInfo videoInfo(QString::fromStdString(video));
+  Header expected;
+  memset(&expected, 0, sizeof(expected));
+  memcpy(expected.Magic, Magic, sizeof(Magic));
+  expected.Version = Version;
+  expected.Frames = frames;
+  expected.FrameWidth = frameSize.width;
+  expected.FrameHeight = frameSize.height;
+  expected.VideoSize = videoInfo.size();
+  expected.VideoTime = videoInfo.lastModified().toTime_t();
+  expected.Levels = std::min((int)widths.size(), (int)MaxLevels);
+  for(int l = 0; l < expected.Levels; l++)
+  {
+    CvSize size = AttentionTracker::GetDetectionSize(frameSize, widths[l]);
+    expected.Limits[l] = widths[l];
+    expected.Widths[l] = size.width;
+    expected.Heights[l] = size.height;
+    expected.FrameBytes += (long long)size.width * size.height;
+  }
+  expected.DataOffset = PageSize + RoundUpToPage(frames);
+
+  m_File.setFileName(QString::fromStdString(filename));
+  if(!m_File.open(QFile::ReadWrite))
+  {
+    printf("Couldnt open preprocessing cache '%s'\n", filename.c_str());
+    return false;
+  }
+
+  Header found;
+  bool reuse = m_File.size() >= (qint64)sizeof(found) && m_File.read((char*)&found, sizeof(found)) == (qint64)sizeof(found)
+    && memcmp(&found, &expected, sizeof(found)) == 0;
+  if(!reuse)
+  {
+    // Start over; the frames stay sparse on disk until they are written
+    long long bytes = expected.DataOffset + frames * expected.FrameBytes;
+    if(!m_File.resize(0) || !m_File.resize(bytes) || !m_File.seek(0)
+      || m_File.write((const char*)&expected, sizeof(expected)) != (qint64)sizeof(expected) || !m_File.flush())
+    {
+      printf("Couldnt create preprocessing cache '%s' (%lld bytes)\n", filename.c_str(), bytes);
+      m_File.close();
+      return false;
+    }
+  }
+
+  m_Mapped = m_File.map(0, expected.DataOffset);
+  if(m_Mapped == 0)
+  {
+    m_File.close();
+    return false;
+  }
+  m_Header = expected;
+  m_Stored = m_Mapped + PageSize;
+  m_Filename = filename;
+
+  m_FramesAtOpen = 0;
+  for(int f = 0; f < frames; f++)
+    m_FramesAtOpen += m_Stored[f] ? 1 : 0;
+  return true;
+}
+
+
+void
+PreprocessCache
+::Close()
+{
+  if(m_Mapped == 0)
+    return;
+
+  m_File.unmap(m_Mapped);
+  m_File.close();
+  m_Mapped = 0;
+  m_Stored = 0;
+}
+
+
+int
+PreprocessCache
+::FindLevel(int width) const
+{
+  for(int l = 0; l < m_Header.Levels; l++)
+    if(m_Header.Limits[l] == width)
+      return l;
+  return -1;
+}
+
+
+bool
+PreprocessCache
+::HasFrames(int begin, int end) const
+{
+  if(m_Stored == 0 || begin < 0 || end > m_Header.Frames)
+    return false;
+
+  for(int f = begin; f < end; f++)
+    if(!m_Stored[f])
+      return false;
+  return true;
+}
+
+
+void
+PreprocessCache
+::MarkFrame(int frame)
+{
+  // Threads mark different frames, and each flag is a byte of its own
+  if(m_Stored && frame >= 0 && frame < m_Header.Frames)
+    m_Stored[frame] = 1;
+}
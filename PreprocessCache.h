@@ -0,0 +1,131 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _PreprocessCache_h
+#define _PreprocessCache_h
+
+#include <string>
+#include <vector>
+
+#include <cv.h>
+
+#include <QFile>
+
+/** Decoded and converted frames of one video, kept on disk so offline reruns that only
+change detection settings skip decoding and color conversion. Each frame is stored as
+its gray detection image at a few detection widths, halving from a base width, exactly
+as AttentionTracker::PrepareDetectionGray() makes them. Frames are fixed size records
+at offsets computed from their index, so the file is memory mapped rather than read,
+and threads fill and read different ranges of it at the same time. The file is sparse
+until written, and is rebuilt when the video's size or time stamp changes. */
+class PreprocessCache
+{
+public:
+
+  enum { MaxLevels = 8 };
+
+  /** One thread's mapping of a range of frames; map only what a task needs, so address space stays bounded */
+  class Range
+  {
+  public:
+
+    Range();
+    ~Range();
+
+    /** Map frames [begin, end) of the cache, clamped to the frames it holds; false if nothing could be mapped */
+    bool Map(const PreprocessCache& cache, int begin, int end);
+    void Unmap();
+
+    /** Header over a cached level of a mapped frame, valid while mapped */
+    void GetLevel(int frame, int level, IplImage* header) const;
+
+    /** Copy a gray detection image into a level of a mapped frame */
+    void StoreLevel(int frame, int level, const IplImage* gray);
+
+    int GetBegin() const { return m_Begin; }
+    int GetEnd() const { return m_End; }
+
+  private:
+    Range(const Range&);
+    void operator=(const Range&);
+
+    const PreprocessCache* m_Cache;
+    QFile m_File;
+    uchar* m_Data;
+    int m_Begin;
+    int m_End;
+  };
+
+  /** Constructor */
+  PreprocessCache();
+
+  /** Destructor; closes the file */
+  ~PreprocessCache();
+
+  /** Open the cache of a video, or start a new one if it belongs to another version of
+  the video or to other detection widths. widths are the detection width limits of the levels. */
+  bool Open(const std::string& filename, const std::string& video, int frames, CvSize frameSize,
+    const std::vector<int>& widths);
+  void Close();
+  bool IsOpen() const { return m_Mapped != 0; }
+
+  /** Level made with this detection width limit, or -1 */
+  int FindLevel(int width) const;
+  int GetNumberOfLevels() const { return m_Header.Levels; }
+  int GetLevelWidth(int level) const { return m_Header.Limits[level]; }
+  int GetNumberOfFrames() const { return m_Header.Frames; }
+
+  /** Are all frames of [begin, end) stored? */
+  bool HasFrames(int begin, int end) const;
+
+  /** All levels of a frame are stored; call after the last StoreLevel() of the frame */
+  void MarkFrame(int frame);
+
+  /** Frames stored when the cache was opened */
+  int GetFramesAtOpen() const { return m_FramesAtOpen; }
+
+protected:
+
+  /** Describes the video and the layout; a cache is reused only if all of it matches */
+  struct Header
+  {
+    char Magic[8];
+    int Version;
+    int Frames;
+    int FrameWidth;
+    int FrameHeight;
+    long long VideoSize;
+    long long VideoTime;
+    int Levels;
+    int Limits[MaxLevels];
+    int Widths[MaxLevels];
+    int Heights[MaxLevels];
+    long long FrameBytes;
+    long long DataOffset;
+  };
+
+  /** Where a level starts within a frame record */
+  long long GetLevelOffset(int level) const;
+
+  std::string m_Filename;
+  Header m_Header;
+
+  /** Header and one stored flag per frame, mapped for as long as the cache is open */
+  QFile m_File;
+  uchar* m_Mapped;
+  unsigned char* m_Stored;
+  int m_FramesAtOpen;
+};
+
+#endif
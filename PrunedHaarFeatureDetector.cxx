@@ -0,0 +1,268 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "PrunedHaarFeatureDetector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "ImagePool.h"
+#include "ParallelFor.h"
+
+static bool BiggerFirst(const CvRect& a, const CvRect& b)
+{
+  return a.width * a.height > b.width * b.height;
+}
+
+PrunedHaarFeatureDetector
+::PrunedHaarFeatureDetector()
+{
+  m_Fast = 0;
+  m_FastStages = 0;
+  m_LoadedStages = 0;
+  m_Small = 0;
+  m_FastScale = 0.5;
+  m_Margin = 0.25;
+  m_MaxCandidates = 4;
+  m_NumberOfCandidates = 0;
+}
+
+
+PrunedHaarFeatureDetector
+::~PrunedHaarFeatureDetector()
+{
+  this->ReleaseCandidates();
+  if(m_Fast)
+  {
+    Untruncate(m_Fast, m_LoadedStages);
+    cvReleaseHaarClassifierCascade(&m_Fast);
+  }
+  ImagePool::Free(m_ImagePool, &m_Small);
+}
+
+
+void
+PrunedHaarFeatureDetector
+::SetImagePool(ImagePool* pool)
+{
+  ImagePool::Free(m_ImagePool, &m_Small);
+  HaarFeatureDetector::SetImagePool(pool);
+}
+
+
+void
+PrunedHaarFeatureDetector
+::ReleaseCandidates()
+{
+  // The first candidate borrows the detector's own full cascade
+  for(size_t c = 0; c < m_Candidates.size(); c++)
+  {
+    if(c > 0 && m_Candidates[c].Cascade) cvReleaseHaarClassifierCascade(&m_Candidates[c].Cascade);
+    if(m_Candidates[c].Storage) cvReleaseMemStorage(&m_Candidates[c].Storage);
+  }
+  m_Candidates.clear();
+}
+
+
+int
+PrunedHaarFeatureDetector
+::Truncate(CvHaarClassifierCascade* cascade, int stages)
+{
+  int loaded = cascade->count;
+  for(int s = 0; s < loaded; s++)
+    if(cascade->stage_classifier[s].next != -1)
+      return 0;
+
+  // Linear cascades chain each stage to the next through child; the last kept one has none
+  if(stages > 0 && stages < loaded)
+  {
+    cascade->stage_classifier[stages - 1].child = -1;
+    cascade->count = stages;
+  }
+  return loaded;
+}
+
+
+void
+PrunedHaarFeatureDetector
+::Untruncate(CvHaarClassifierCascade* cascade, int stages)
+{
+  if(cascade->count < stages)
+    cascade->stage_classifier[cascade->count - 1].child = cascade->count;
+  cascade->count = stages;
+}
+
+
+bool
+PrunedHaarFeatureDetector
+::Load(const std::string& model)
+{
+  // "<cascade file>#<K>"
+  std::string file = model;
+  int stages = 0;
+  size_t hash = model.rfind('#');
+  if(hash != std::string::npos)
+  {
+    file = model.substr(0, hash);
+    stages = atoi(model.c_str() + hash + 1);
+  }
+
+  if(!HaarFeatureDetector::Load(file))
+    return false;
+
+  // The first candidate borrowed the full cascade the base class just freed, and the others
+  // are copies of the old file; they are made again from the new one on first use. So is
+  // the fast cascade, which must not be paired with the new full one if its load fails.
+  this->ReleaseCandidates();
+  if(m_Fast)
+  {
+    Untruncate(m_Fast, m_LoadedStages);
+    cvReleaseHaarClassifierCascade(&m_Fast);
+  }
+
+  // The fast cascade is a second copy, cut short before it is ever used
+  CvHaarClassifierCascade* fast = (CvHaarClassifierCascade*)cvLoad(file.c_str(), 0, 0, 0);
+  if(fast == 0)
+    return false;
+  if(stages <= 0)
+    stages = std::max(1, fast->count / 3);
+  stages = std::min(stages, fast->count);
+
+  int loadedStages = Truncate(fast, stages);
+  if(loadedStages == 0)
+  {
+    printf("'%s' is a tree cascade and can't be truncated\n", file.c_str());
+    cvReleaseHaarClassifierCascade(&fast);
+    return false;
+  }
+
+  m_Fast = fast;
+  m_FastStages = stages;
+  m_LoadedStages = loadedStages;
+  m_CascadeFile = file;
+  return true;
+}
+
+
+CvRect
+PrunedHaarFeatureDetector
+::DetectObject(IplImage* gray)
+{
+  m_NumberOfCandidates = 0;
+  if(m_Cascade == 0 || m_Fast == 0)
+    return cvRect(-1,-1,-1,-1);
+
+  // Results are relative to the ROI, like every detector's
+  CvSize size = cvGetSize(gray);
+  CvRect roi = gray->roi ? cvGetImageROI(gray) : cvRect(0, 0, gray->width, gray->height);
+
+  // Tier one: the fast cascade over the whole search area at reduced resolution.
+  // Every grouped hit is a candidate, not just the biggest.
+  CvSize smallSize = cvSize(std::max(1, cvRound(size.width * m_FastScale)), std::max(1, cvRound(size.height * m_FastScale)));
+  if(m_Small == 0 || m_Small->width != smallSize.width || m_Small->height != smallSize.height)
+  {
+    ImagePool::Free(m_ImagePool, &m_Small);
+    m_Small = ImagePool::Create(m_ImagePool, smallSize, 1);
+  }
+  cvResize(gray, m_Small, CV_INTER_LINEAR);
+
+  cvClearMemStorage(m_Storage);
+  int minSize = std::max(1, cvRound(m_Parameters.MinSize * m_FastScale));
+  CvSeq* rects = cvHaarDetectObjects(m_Small, m_Fast, m_Storage, m_Parameters.ScaleFactor,
+    1, 0, cvSize(minSize, minSize));
+
+  std::vector<CvRect> hits;
+  for(int r = 0; r < (rects ? rects->total : 0); r++)
+    hits.push_back(*(CvRect*)cvGetSeqElem(rects, r));
+  if(hits.empty())
+    return cvRect(-1,-1,-1,-1);
+  std::stable_sort(hits.begin(), hits.end(), BiggerFirst);
+
+  // Back to full resolution, grown so the full cascade sees the object at every scale it may need
+  int candidates = std::min((int)hits.size(), m_MaxCandidates);
+  if((int)m_Candidates.size() < candidates)
+  {
+    // Each candidate gets its own cascade: cvHaarDetectObjects keeps per-image state in it
+    size_t c = m_Candidates.size();
+    m_Candidates.resize(candidates);
+    for(; c < m_Candidates.size(); c++)
+    {
+      m_Candidates[c].Cascade = c == 0 ? m_Cascade : (CvHaarClassifierCascade*)cvLoad(m_CascadeFile.c_str(), 0, 0, 0);
+      m_Candidates[c].Storage = cvCreateMemStorage(0);
+    }
+  }
+
+  CvSize window = m_Cascade->orig_window_size;
+  m_NumberOfCandidates = 0;
+  for(int h = 0; h < candidates; h++)
+  {
+    Candidate& candidate = m_Candidates[m_NumberOfCandidates];
+    if(candidate.Cascade == 0)
+      break;
+
+    CvRect hit = hits[h];
+    int x0 = cvRound(hit.x / m_FastScale - hit.width / m_FastScale * m_Margin);
+    int y0 = cvRound(hit.y / m_FastScale - hit.height / m_FastScale * m_Margin);
+    int x1 = cvRound((hit.x + hit.width) / m_FastScale + hit.width / m_FastScale * m_Margin);
+    int y1 = cvRound((hit.y + hit.height) / m_FastScale + hit.height / m_FastScale * m_Margin);
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, size.width);
+    y1 = std::min(y1, size.height);
+    if(x1 - x0 < window.width || y1 - y0 < window.height)
+      continue;
+
+    // A header over the caller's pixels, so the candidates don't fight over the ROI
+    candidate.Bounds = cvRect(x0, y0, x1 - x0, y1 - y0);
+    cvInitImageHeader(&candidate.Region, cvSize(candidate.Bounds.width, candidate.Bounds.height), IPL_DEPTH_8U, 1);
+    cvSetData(&candidate.Region, gray->imageData + (roi.y + y0) * gray->widthStep + roi.x + x0, gray->widthStep);
+    m_NumberOfCandidates++;
+  }
+
+  // Tier two: the full cascade on every candidate at once
+  ParallelFor(m_NumberOfCandidates, VerifyCandidate, this);
+
+  CvRect best = cvRect(-1,-1,-1,-1);
+  for(int c = 0; c < m_NumberOfCandidates; c++)
+  {
+    CvRect found = m_Candidates[c].Found;
+    if(found.width * found.height > best.width * best.height)
+      best = cvRect(found.x + m_Candidates[c].Bounds.x, found.y + m_Candidates[c].Bounds.y, found.width, found.height);
+  }
+  return best;
+}
+
+
+void
+PrunedHaarFeatureDetector
+::VerifyCandidate(void* data, int index)
+{
+  PrunedHaarFeatureDetector* self = (PrunedHaarFeatureDetector*)data;
+  Candidate& candidate = self->m_Candidates[index];
+  const DetectionParameters& p = self->m_Parameters;
+
+  cvClearMemStorage(candidate.Storage);
+  CvSeq* rects = cvHaarDetectObjects(&candidate.Region, candidate.Cascade, candidate.Storage,
+    p.ScaleFactor, p.MinNeighbors, p.Flags, cvSize(p.MinSize, p.MinSize));
+
+  candidate.Found = cvRect(-1,-1,-1,-1);
+  for(int r = 0; r < (rects ? rects->total : 0); r++)
+  {
+    CvRect rect = *(CvRect*)cvGetSeqElem(rects, r);
+    if(rect.width * rect.height > candidate.Found.width * candidate.Found.height)
+      candidate.Found = rect;
+  }
+}
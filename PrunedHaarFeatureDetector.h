@@ -0,0 +1,102 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _PrunedHaarFeatureDetector_h
+#define _PrunedHaarFeatureDetector_h
+
+#include <vector>
+
+#include "HaarFeatureDetector.h"
+
+/** Two-tier Haar detection. A fast cascade made of the first K stages of the full one
+runs over the whole search area at reduced resolution; almost every window is rejected
+there. The full cascade then runs only on the few candidate regions that survive, in
+parallel through ParallelFor(), each with its own copy of the cascade. The model is
+"<cascade file>" or "<cascade file>#<K>"; without K a third of the stages are used.
+The TruncateCascades tool reports recall and latency against K for each cascade.
+InputScale is not used; the fast pass has its own scale. */
+class PrunedHaarFeatureDetector : public HaarFeatureDetector
+{
+public:
+
+  /** Constructor */
+  PrunedHaarFeatureDetector();
+
+  /** Destructor */
+  virtual ~PrunedHaarFeatureDetector();
+
+  virtual const char* GetBackend() const { return "pruned"; }
+  virtual bool Load(const std::string& model);
+  virtual void SetImagePool(ImagePool* pool);
+
+  /** Stages in the fast and in the full cascade */
+  int GetFastStages() const { return m_FastStages; }
+  int GetNumberOfStages() const { return m_Cascade ? m_Cascade->count : 0; }
+
+  /** Fraction of the search area's size the fast pass runs at */
+  void SetFastScale(double scale) { m_FastScale = scale; }
+
+  /** At most this many candidates, the biggest, go on to the full cascade */
+  void SetMaxCandidates(int candidates) { m_MaxCandidates = candidates; }
+
+  /** Candidates the full cascade ran on in the last call */
+  int GetNumberOfCandidates() const { return m_NumberOfCandidates; }
+
+  /** Cut a loaded linear cascade down to its first stages; returns the original number of
+  stages, or 0 if the cascade is a tree and can't be cut. Undo with Untruncate() before
+  releasing the cascade, or its later stages leak. */
+  static int Truncate(CvHaarClassifierCascade* cascade, int stages);
+  static void Untruncate(CvHaarClassifierCascade* cascade, int stages);
+
+protected:
+
+  virtual CvRect DetectObject(IplImage* gray);
+
+  /** Run the full cascade on one candidate; the ParallelForBody */
+  static void VerifyCandidate(void* data, int index);
+
+  /** A candidate region and the cascade copy that checks it */
+  struct Candidate
+  {
+    CvHaarClassifierCascade* Cascade;
+    CvMemStorage* Storage;
+
+    /** Header over the candidate's pixels in the caller's image */
+    IplImage Region;
+    CvRect Bounds;
+    CvRect Found;
+  };
+
+  void ReleaseCandidates();
+
+  std::string m_CascadeFile;
+
+  /** The fast cascade, and the number of stages it was loaded with */
+  CvHaarClassifierCascade* m_Fast;
+  int m_FastStages;
+  int m_LoadedStages;
+
+  /** The search area shrunk for the fast pass */
+  IplImage* m_Small;
+  double m_FastScale;
+
+  /** Grow candidates by this fraction of their size on every side before the full pass */
+  double m_Margin;
+
+  int m_MaxCandidates;
+  int m_NumberOfCandidates;
+  std::vector<Candidate> m_Candidates;
+};
+
+#endif
@@ -0,0 +1,45 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "QtParallelFor.h"
+
+#include <vector>
+
+#include <QtConcurrentMap>
+
+/** One index of the loop, as QtConcurrent wants a sequence to map over */
+struct ParallelForItem
+{
+  ParallelForBody Body;
+  void* Data;
+  int Index;
+};
+
+static void RunItem(ParallelForItem& item)
+{
+  item.Body(item.Data, item.Index);
+}
+
+
+void QtParallelFor(int count, ParallelForBody body, void* data)
+{
+  std::vector<ParallelForItem> items(count);
+  for(int i = 0; i < count; i++)
+  {
+    items[i].Body = body;
+    items[i].Data = data;
+    items[i].Index = i;
+  }
+  QtConcurrent::blockingMap(items, RunItem);
+}
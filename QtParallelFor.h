@@ -0,0 +1,24 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _QtParallelFor_h
+#define _QtParallelFor_h
+
+#include "ParallelFor.h"
+
+/** ParallelForFunction running the loop on Qt's global thread pool; the calling thread waits.
+Install it with SetParallelFor(QtParallelFor). */
+void QtParallelFor(int count, ParallelForBody body, void* data);
+
+#endif
@@ -0,0 +1,425 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "SessionLogStore.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrentMap>
+
+// Column files, one value per log row
+static const char* TimeColumn = "time.f64";
+static const char* TrialColumn = "trial.i32";
+static const char* FeatureColumn = "feature.i8";
+static const char* DetectColumn = "detect.i8";
+static const char* EpochColumn = "epoch.i8";
+static const char* CarriedColumn = "carried.i8";
+
+static const int NumberOfColumns = 6;
+static const char* ColumnFiles[NumberOfColumns] = { TimeColumn, TrialColumn, FeatureColumn, DetectColumn, EpochColumn, CarriedColumn };
+static const int ColumnBytes[NumberOfColumns] = { 8, 4, 1, 1, 1, 1 };
+
+// Run index and list of ingested sessions
+static const char* IndexFile = "index.bin";
+static const char* SessionsFile = "sessions.txt";
+
+// Longest row range a single scan task maps at once, so address space stays bounded
+static const qint64 MaxRowsPerTask = 1 << 24;
+
+
+/** Matching row ranges of one session that lie close together, scanned by one worker */
+struct ScanTask
+{
+  QString DetectFile;
+  int Session;
+  qint64 Begin;
+  qint64 End;
+  QVector<qint64> Ranges;
+  SessionLogStore::Result Result;
+};
+
+
+/** Count tracked and detected rows by mapping only this task's span of the detect column */
+static void ScanRows(ScanTask& task)
+{
+  QFile file(task.DetectFile);
+  if(!file.open(QFile::ReadOnly))
+    return;
+
+  uchar* mapped = file.map(task.Begin, task.End - task.Begin);
+  if(mapped == 0)
+    return;
+
+  // Ranges are stored as begin/end row pairs; the mapping starts at task.Begin
+  const signed char* detect = (const signed char*)mapped;
+  qint64 rows = 0, tracked = 0, detected = 0;
+  for(int r = 0; r + 1 < task.Ranges.count(); r += 2)
+  {
+    for(qint64 i = task.Ranges[r] - task.Begin; i < task.Ranges[r + 1] - task.Begin; i++)
+    {
+      if(detect[i] >= 0)
+      {
+        tracked++;
+        if(detect[i] > 0)
+          detected++;
+      }
+    }
+    rows += task.Ranges[r + 1] - task.Ranges[r];
+  }
+
+  task.Result.Rows = rows;
+  task.Result.Tracked = tracked;
+  task.Result.Detected = detected;
+
+  file.unmap(mapped);
+}
+
+
+SessionLogStore
+::SessionLogStore(const QString& directory)
+{
+  m_Directory = directory;
+  QDir().mkpath(m_Directory);
+}
+
+
+QString
+SessionLogStore
+::FilePath(const char* name) const
+{
+  return QDir(m_Directory).filePath(name);
+}
+
+
+void
+SessionLogStore
+::WriteIndexEntry(FILE* index, const IndexEntry& entry)
+{
+  if(entry.End > entry.Begin)
+    fwrite(&entry, sizeof(IndexEntry), 1, index);
+}
+
+
+qint64
+SessionLogStore
+::GetNumberOfRows()
+{
+  return this->GetCommittedRows();
+}
+
+
+QStringList
+SessionLogStore
+::GetSessions()
+{
+  QStringList sessions;
+
+  FILE* file = fopen(this->FilePath(SessionsFile).toLocal8Bit().constData(), "r");
+  if(file == 0)
+    return sessions;
+
+  // Each line: first row, end row, source path
+  char line[4096];
+  while(fgets(line, sizeof(line), file))
+  {
+    char* path = strchr(line, ' ');
+    if(path) path = strchr(path + 1, ' ');
+    if(path == 0)
+      continue;
+
+    path++;
+    path[strcspn(path, "\r\n")] = 0;
+    sessions << QString::fromLocal8Bit(path);
+  }
+
+  fclose(file);
+  return sessions;
+}
+
+
+qint64
+SessionLogStore
+::GetCommittedRows()
+{
+  FILE* file = fopen(this->FilePath(SessionsFile).toLocal8Bit().constData(), "r");
+  if(file == 0)
+    return 0;
+
+  // The end row of the last listed session
+  long long first, end;
+  qint64 rows = 0;
+  char line[4096];
+  while(fgets(line, sizeof(line), file))
+    if(sscanf(line, "%lld %lld", &first, &end) == 2)
+      rows = end;
+
+  fclose(file);
+  return rows;
+}
+
+
+bool
+SessionLogStore
+::Truncate(int sessions, qint64 rows)
+{
+  for(int n = 0; n < NumberOfColumns; n++)
+  {
+    QFile column(this->FilePath(ColumnFiles[n]));
+    if(column.exists() && column.size() > rows * ColumnBytes[n] && !column.resize(rows * ColumnBytes[n]))
+      return false;
+  }
+
+  // Index entries are written in session order, so the uncommitted ones are at the end
+  QFile indexFile(this->FilePath(IndexFile));
+  if(!indexFile.exists())
+    return true;
+  if(!indexFile.open(QFile::ReadOnly))
+    return false;
+  qint64 keep = indexFile.size() / sizeof(IndexEntry);
+  IndexEntry entry;
+  while(keep > 0 && indexFile.seek((keep - 1) * sizeof(IndexEntry))
+    && indexFile.read((char*)&entry, sizeof(entry)) == sizeof(entry) && entry.Session >= sessions)
+    keep--;
+  indexFile.close();
+  return indexFile.size() == keep * (qint64)sizeof(IndexEntry) || indexFile.resize(keep * sizeof(IndexEntry));
+}
+
+
+bool
+SessionLogStore
+::Ingest(const QString& logFileName)
+{
+  FILE* in = fopen(logFileName.toLocal8Bit().constData(), "r");
+  if(in == 0)
+  {
+    printf("Couldnt open log file '%s'\n", logFileName.toLocal8Bit().constData());
+    return false;
+  }
+
+  // Find out where each column lives from the header; older logs have no Carried column
+  char line[1024];
+  int column[6] = { -1, -1, -1, -1, -1, -1 };
+  const char* names[6] = { "Time", "Trial", "Feature", "Detect", "Epoch", "Carried" };
+  if(fgets(line, sizeof(line), in))
+  {
+    int c = 0;
+    for(char* field = strtok(line, ",\r\n"); field; field = strtok(0, ",\r\n"), c++)
+      for(int n = 0; n < 6; n++)
+        if(strcmp(field, names[n]) == 0)
+          column[n] = c;
+  }
+  for(int n = 0; n < 5; n++)
+  {
+    if(column[n] < 0)
+    {
+      printf("Log file '%s' has no %s column\n", logFileName.toLocal8Bit().constData(), names[n]);
+      fclose(in);
+      return false;
+    }
+  }
+
+  // A session only counts once it is listed in the sessions file, which is written last;
+  // rows and runs past the last listed session are from an ingest that didn't finish
+  int session = this->GetSessions().count();
+  qint64 firstRow = this->GetCommittedRows();
+  qint64 row = firstRow;
+  if(!this->Truncate(session, firstRow))
+  {
+    printf("Couldnt truncate the store in '%s' to its committed sessions\n", m_Directory.toLocal8Bit().constData());
+    fclose(in);
+    return false;
+  }
+
+  // Columns are only ever appended, through large stdio buffers
+  FILE* out[NumberOfColumns];
+  FILE* index = fopen(this->FilePath(IndexFile).toLocal8Bit().constData(), "ab");
+  bool opened = index != 0;
+  for(int n = 0; n < NumberOfColumns; n++)
+  {
+    out[n] = fopen(this->FilePath(ColumnFiles[n]).toLocal8Bit().constData(), "ab");
+    if(out[n])
+      setvbuf(out[n], 0, _IOFBF, 1 << 20);
+    else
+      opened = false;
+  }
+  if(!opened)
+  {
+    printf("Couldnt open the store files in '%s' for writing\n", m_Directory.toLocal8Bit().constData());
+    fclose(in);
+    if(index) fclose(index);
+    for(int n = 0; n < NumberOfColumns; n++)
+      if(out[n]) fclose(out[n]);
+    return false;
+  }
+
+  IndexEntry run;
+  run.Session = session;
+  run.Trial = -1;
+  run.Epoch = -1;
+  run.Feature = -1;
+  run.Begin = row;
+  run.End = row;
+
+  while(fgets(line, sizeof(line), in))
+  {
+    // Split the line; the legend appended at the end of each log doesn't parse and is skipped
+    double value[8];
+    int fields = 0;
+    bool valid = true;
+    char* cursor = line;
+    while(fields < 8 && *cursor && *cursor != '\n' && *cursor != '\r')
+    {
+      char* end;
+      value[fields] = strtod(cursor, &end);
+      if(end == cursor) { valid = false; break; }
+      fields++;
+      cursor = (*end == ',') ? end + 1 : end;
+    }
+    if(!valid || fields <= column[4])
+      continue;
+
+    double time = value[column[0]];
+    qint32 trial = (qint32)value[column[1]];
+    signed char feature = (signed char)value[column[2]];
+    signed char detect = (signed char)value[column[3]];
+    signed char epoch = (signed char)value[column[4]];
+    signed char carried = (column[5] >= 0 && column[5] < fields) ? (signed char)value[column[5]] : 0;
+
+    fwrite(&time, sizeof(time), 1, out[0]);
+    fwrite(&trial, sizeof(trial), 1, out[1]);
+    fwrite(&feature, 1, 1, out[2]);
+    fwrite(&detect, 1, 1, out[3]);
+    fwrite(&epoch, 1, 1, out[4]);
+    fwrite(&carried, 1, 1, out[5]);
+
+    // Close the current run whenever one of the indexed keys changes
+    if(trial != run.Trial || epoch != run.Epoch || feature != run.Feature)
+    {
+      run.End = row;
+      this->WriteIndexEntry(index, run);
+      run.Trial = trial;
+      run.Epoch = epoch;
+      run.Feature = feature;
+      run.Begin = row;
+    }
+    row++;
+  }
+  run.End = row;
+  this->WriteIndexEntry(index, run);
+
+  // A full disk shows up as a write or close error; the next ingest truncates the partial rows
+  fclose(in);
+  bool written = !ferror(index) && fclose(index) == 0;
+  for(int n = 0; n < NumberOfColumns; n++)
+    written = !ferror(out[n]) && fclose(out[n]) == 0 && written;
+  if(!written)
+  {
+    printf("Couldnt write '%s' to the store, it was not added\n", logFileName.toLocal8Bit().constData());
+    return false;
+  }
+
+  // Only list the session once all of its rows are on disk
+  FILE* sessions = fopen(this->FilePath(SessionsFile).toLocal8Bit().constData(), "a");
+  if(sessions == 0)
+  {
+    printf("Couldnt open the sessions list in '%s', '%s' was not added\n", m_Directory.toLocal8Bit().constData(),
+      logFileName.toLocal8Bit().constData());
+    return false;
+  }
+  fprintf(sessions, "%lld %lld %s\n", (long long)firstRow, (long long)row,
+    QFileInfo(logFileName).absoluteFilePath().toLocal8Bit().constData());
+  if(fclose(sessions) != 0)
+  {
+    printf("Couldnt update the sessions list in '%s'\n", m_Directory.toLocal8Bit().constData());
+    return false;
+  }
+
+  printf("Ingested %lld rows from '%s' as session %i\n", (long long)(row - firstRow),
+    logFileName.toLocal8Bit().constData(), session);
+  return true;
+}
+
+
+QVector<SessionLogStore::Result>
+SessionLogStore
+::Run(const Query& query)
+{
+  int numSessions = this->GetSessions().count();
+  QVector<Result> results(numSessions);
+
+  QFile indexFile(this->FilePath(IndexFile));
+  if(numSessions == 0 || !indexFile.open(QFile::ReadOnly) || indexFile.size() == 0)
+    return results;
+
+  // The index is small compared to the columns, so map all of it
+  uchar* mapped = indexFile.map(0, indexFile.size());
+  if(mapped == 0)
+    return results;
+  const IndexEntry* entries = (const IndexEntry*)mapped;
+  qint64 numEntries = indexFile.size() / sizeof(IndexEntry);
+
+  // Gather the matching runs into tasks whose mapped span stays bounded.
+  // Runs are in row order, so neighbouring runs of a session share a task.
+  QVector<ScanTask> tasks;
+  QString detectFile = this->FilePath(DetectColumn);
+  for(qint64 i = 0; i < numEntries; i++)
+  {
+    const IndexEntry& e = entries[i];
+    if(e.Session >= numSessions) continue;
+    if(query.Session >= 0 && e.Session != query.Session) continue;
+    if(query.Epoch >= 0 && e.Epoch != query.Epoch) continue;
+    if(query.Feature >= 0 && e.Feature != query.Feature) continue;
+    if(query.FirstTrial >= 0 && e.Trial < query.FirstTrial) continue;
+    if(query.LastTrial >= 0 && e.Trial > query.LastTrial) continue;
+
+    for(qint64 begin = e.Begin; begin < e.End; begin += MaxRowsPerTask)
+    {
+      qint64 end = (e.End - begin > MaxRowsPerTask) ? begin + MaxRowsPerTask : e.End;
+
+      if(tasks.isEmpty() || tasks.back().Session != e.Session || end - tasks.back().Begin > MaxRowsPerTask)
+      {
+        ScanTask task;
+        task.DetectFile = detectFile;
+        task.Session = e.Session;
+        task.Begin = begin;
+        task.End = end;
+        tasks.append(task);
+      }
+
+      ScanTask& task = tasks.back();
+      task.End = end;
+      task.Ranges.append(begin);
+      task.Ranges.append(end);
+    }
+  }
+  indexFile.unmap(mapped);
+
+  // Scan on all cores, then add up the partial counts per session
+  QtConcurrent::blockingMap(tasks, ScanRows);
+
+  for(int t = 0; t < tasks.count(); t++)
+  {
+    Result& r = results[tasks[t].Session];
+    r.Rows += tasks[t].Result.Rows;
+    r.Tracked += tasks[t].Result.Tracked;
+    r.Detected += tasks[t].Result.Detected;
+  }
+
+  return results;
+}
@@ -0,0 +1,101 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef _SessionLogStore_h
+#define _SessionLogStore_h
+
+#include <stdio.h>
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/** On-disk columnar store for session logs ("Log File.csv").
+Each log column is kept in its own flat binary file so queries can memory-map
+just the rows they need, and an index of (session, trial, epoch, feature) runs
+lets a query jump straight to the matching row ranges. */
+class SessionLogStore
+{
+public:
+
+  /** One contiguous run of rows that share session, trial, epoch and feature */
+  struct IndexEntry
+  {
+    qint32 Session;
+    qint32 Trial;
+    qint32 Epoch;
+    qint32 Feature;
+    qint64 Begin;
+    qint64 End;
+  };
+
+  /** Selection of rows; -1 means "any" */
+  struct Query
+  {
+    Query() : Session(-1), Epoch(-1), Feature(-1), FirstTrial(-1), LastTrial(-1) {}
+
+    int Session;
+    int Epoch;
+    int Feature;
+    int FirstTrial;
+    int LastTrial;
+  };
+
+  /** Row counts for one session (or all of them) */
+  struct Result
+  {
+    Result() : Rows(0), Tracked(0), Detected(0) {}
+
+    qint64 Rows;
+    qint64 Tracked;
+    qint64 Detected;
+
+    double DetectionRate() const { return Tracked > 0 ? (double)Detected / Tracked : 0; }
+  };
+
+  /** Constructor; the store lives in the given directory */
+  SessionLogStore(const QString& directory);
+
+  /** Append one session log to the store. Memory use does not depend on the file size. */
+  bool Ingest(const QString& logFileName);
+
+  /** Run a query over all matching rows in parallel; one result per session */
+  QVector<Result> Run(const Query& query);
+
+  /** Source files of the ingested sessions, in session order */
+  QStringList GetSessions();
+
+  /** Total number of rows in the listed sessions */
+  qint64 GetNumberOfRows();
+
+protected:
+
+  /** Path of a file inside the store directory */
+  QString FilePath(const char* name) const;
+
+  /** Append a finished run to the index file */
+  void WriteIndexEntry(FILE* index, const IndexEntry& entry);
+
+  /** Rows covered by the sessions listed in the sessions file */
+  qint64 GetCommittedRows();
+
+  /** Cut the columns and the index back to the listed sessions, dropping whatever an
+  interrupted ingest left behind; false if a file can't be truncated */
+  bool Truncate(int sessions, qint64 rows);
+
+  QString m_Directory;
+};
+
+#endif
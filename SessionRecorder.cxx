@@ -0,0 +1,242 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "SessionRecorder.h"
+
+#include "Trace.h"
+
+#include <stdio.h>
+
+// Read an atomic counter with acquire semantics
+static int LoadAcquire(QAtomicInt& value)
+{
+  return value.fetchAndAddAcquire(0);
+}
+
+
+SessionRecorder
+::SessionRecorder(int queueLength)
+{
+  m_QueueLength = queueLength > 0 ? queueLength : 1;
+  m_Writer = 0;
+  m_EncoderWriter = 0;
+  m_Policy = 0;
+  m_ImagePool = 0;
+  m_FrameSize = cvSize(0, 0);
+  m_Channels = 3;
+  m_EncodeTime = 0;
+}
+
+
+SessionRecorder
+::~SessionRecorder()
+{
+  this->Stop();
+}
+
+
+bool
+SessionRecorder
+::Start(const char* filename, CvSize frameSize, double fps, bool color)
+{
+  this->Stop();
+
+  m_Writer = cvCreateVideoWriter(filename, CV_FOURCC('M','J','P','G'), fps, frameSize, color ? 1 : 0);
+  if(m_Writer == 0)
+  {
+    printf("Couldnt open video file '%s' for recording\n", filename);
+    return false;
+  }
+
+  // All frame memory is allocated up front; nothing is allocated while recording
+  m_FrameSize = frameSize;
+  m_Channels = color ? 3 : 1;
+  for(int s = 0; s < m_QueueLength; s++)
+    m_Slots.push_back(ImagePool::Create(m_ImagePool, frameSize, m_Channels));
+
+  m_Head = 0;
+  m_Tail = 0;
+  m_Stopping = 0;
+  m_FramesWritten = 0;
+  m_FramesDropped = 0;
+  m_MaxQueueDepth = 0;
+  m_EncodeTimeMutex.lock();
+  m_EncodeTime = 0;
+  m_EncodeTimeMutex.unlock();
+
+  // Encoding must never compete with capture and detection
+  m_EncoderWriter = m_Writer;
+  QThread::start(QThread::LowPriority);
+
+  printf("Recording %dx%d at %.1f fps to '%s'\n", frameSize.width, frameSize.height, fps, filename);
+  return true;
+}
+
+
+void
+SessionRecorder
+::Stop()
+{
+  if(m_Slots.empty())
+    return;
+
+  // The encoder drains whatever is still queued and closes the file before it exits
+  this->Finish();
+  QThread::wait();
+
+  for(size_t s = 0; s < m_Slots.size(); s++)
+    ImagePool::Free(m_ImagePool, &m_Slots[s]);
+  m_Slots.clear();
+
+  this->PrintStatistics();
+}
+
+
+void
+SessionRecorder
+::Finish()
+{
+  if(m_Writer == 0)
+    return;
+
+  // From here on the frame loop pushes nothing more; the encoder still holds the writer
+  m_Writer = 0;
+  m_Stopping.fetchAndStoreRelease(1);
+}
+
+
+bool
+SessionRecorder
+::PushFrame(const IplImage* frame)
+{
+  if(m_Writer == 0)
+    return false;
+
+  // The writer was opened for one frame size and layout
+  if(frame->width != m_FrameSize.width || frame->height != m_FrameSize.height || frame->nChannels != m_Channels)
+  {
+    m_FramesDropped.fetchAndAddRelaxed(1);
+    return false;
+  }
+
+  // Only this thread moves the head; the encoder only moves the tail
+  int head = LoadAcquire(m_Head);
+  int tail = LoadAcquire(m_Tail);
+  if(head - tail >= m_QueueLength)
+  {
+    m_FramesDropped.fetchAndAddRelaxed(1);
+    return false;
+  }
+
+  cvCopy(frame, m_Slots[head % m_QueueLength]);
+
+  int depth = head + 1 - tail;
+  if(depth > LoadAcquire(m_MaxQueueDepth))
+    m_MaxQueueDepth.fetchAndStoreRelaxed(depth);
+
+  // Publish the slot to the encoder
+  m_Head.fetchAndStoreRelease(head + 1);
+  return true;
+}
+
+
+void
+SessionRecorder
+::run()
+{
+  int tail = LoadAcquire(m_Tail);
+  if(m_Policy)
+    m_Policy->Apply(LoggingThreadRole);
+  TraceThreadName("recorder");
+
+  while(true)
+  {
+    int head = LoadAcquire(m_Head);
+    if(head == tail)
+    {
+      if(LoadAcquire(m_Stopping))
+        break;
+
+      // Nothing queued; poll rather than have the frame loop signal us
+      QThread::msleep(2);
+      continue;
+    }
+
+    double t = (double)cvGetTickCount();
+    TraceEvent("encode", 'B', tail);
+    cvWriteFrame(m_EncoderWriter, m_Slots[tail % m_QueueLength]);
+    TraceEvent("encode", 'E');
+    double seconds = ((double)cvGetTickCount() - t) / (cvGetTickFrequency() * 1.0e6);
+    m_EncodeTimeMutex.lock();
+    m_EncodeTime += seconds;
+    m_EncodeTimeMutex.unlock();
+
+    // Hand the slot back to the frame loop
+    tail++;
+    m_Tail.fetchAndStoreRelease(tail);
+    m_FramesWritten.fetchAndAddRelaxed(1);
+  }
+
+  // Closing the file writes its index, which is better done here than on the frame loop
+  cvReleaseVideoWriter(&m_EncoderWriter);
+
+  if(m_Policy)
+    m_Policy->Leave();
+}
+
+
+int
+SessionRecorder
+::GetQueueDepth()
+{
+  return LoadAcquire(m_Head) - LoadAcquire(m_Tail);
+}
+
+
+int
+SessionRecorder
+::GetFramesWritten()
+{
+  return LoadAcquire(m_FramesWritten);
+}
+
+
+int
+SessionRecorder
+::GetFramesDropped()
+{
+  return LoadAcquire(m_FramesDropped);
+}
+
+
+double
+SessionRecorder
+::GetEncodeRate() const
+{
+  // The count and the time are updated separately, so this is off by at most one frame while recording
+  QMutexLocker lock(&m_EncodeTimeMutex);
+  int written = (int)m_FramesWritten;
+  return m_EncodeTime > 0 ? written / m_EncodeTime : 0;
+}
+
+
+void
+SessionRecorder
+::PrintStatistics()
+{
+  printf("Recorder: %d frames written, %d dropped, queue depth %d (max %d of %d), encoding at %.1f fps\n",
+    this->GetFramesWritten(), this->GetFramesDropped(), this->GetQueueDepth(),
+    LoadAcquire(m_MaxQueueDepth), m_QueueLength, this->GetEncodeRate());
+}
@@ -0,0 +1,113 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef _SessionRecorder_h
+#define _SessionRecorder_h
+
+#include <vector>
+
+#include <cv.h>
+#include <highgui.h>
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThread>
+
+#include "ImagePool.h"
+#include "ThreadPolicy.h"
+
+/** Records session video without slowing down the frame loop.
+The frame loop copies each frame into a fixed ring of preallocated slots and
+returns immediately; an encoder thread drains the ring into a video file. When
+the encoder falls behind and the ring is full, the newest frame is dropped and
+counted rather than waiting for a free slot. */
+class SessionRecorder : public QThread
+{
+public:
+
+  /** Constructor; queueLength is the number of frames the ring can hold */
+  SessionRecorder(int queueLength = 15);
+
+  /** Destructor; stops recording if still running */
+  virtual ~SessionRecorder();
+
+  /** CPU and priority for the encoder thread, the logging role; call before Start() */
+  void SetThreadPolicy(ThreadPolicy* policy) { m_Policy = policy; }
+
+  /** Borrow the ring's slots from this pool, which locks them in memory if asked to;
+  without one they are allocated plainly. Call before Start(). */
+  void SetImagePool(ImagePool* pool) { m_ImagePool = pool; }
+
+  /** Open the video file and start the encoder thread; without color the frames are 1 channel luma */
+  bool Start(const char* filename, CvSize frameSize, double fps, bool color = true);
+
+  /** Let the encoder finish the queued frames, then close the file */
+  void Stop();
+
+  /** Let the encoder finish the queued frames and close the file on its own thread,
+  without waiting for it; the recorder can be deleted without blocking once IsFinished() */
+  void Finish();
+  bool IsFinished() const { return m_Writer == 0 && !QThread::isRunning(); }
+
+  /** Copy a frame into the queue. Never blocks; returns false if the frame was dropped. */
+  bool PushFrame(const IplImage* frame);
+
+  /** Is the encoder thread running? */
+  bool IsRecording() const { return m_Writer != 0; }
+
+  /** Counters; safe to read from the frame loop while recording */
+  int GetQueueDepth();
+  int GetFramesWritten();
+  int GetFramesDropped();
+
+  /** Frames encoded per second of encoder busy time */
+  double GetEncodeRate() const;
+
+  /** Print the counters to stdout */
+  void PrintStatistics();
+
+protected:
+
+  /** Encoder thread */
+  virtual void run();
+
+  /** Ring of preallocated frame slots */
+  std::vector<IplImage*> m_Slots;
+  int m_QueueLength;
+
+  /** Total frames pushed (written only by the frame loop) and encoded (only by the encoder) */
+  QAtomicInt m_Head;
+  QAtomicInt m_Tail;
+
+  QAtomicInt m_Stopping;
+  QAtomicInt m_FramesWritten;
+  QAtomicInt m_FramesDropped;
+  QAtomicInt m_MaxQueueDepth;
+
+  ThreadPolicy* m_Policy;
+  ImagePool* m_ImagePool;
+
+  /** The owner's handle, cleared by Finish(), and the encoder's, which it closes when it exits */
+  CvVideoWriter* m_Writer;
+  CvVideoWriter* m_EncoderWriter;
+  CvSize m_FrameSize;
+  int m_Channels;
+
+  /** Time the encoder spent in cvWriteFrame, in seconds */
+  mutable QMutex m_EncodeTimeMutex;
+  double m_EncodeTime;
+};
+
+#endif
@@ -0,0 +1,460 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QMutex>
+#include <QThread>
+#include <QThreadStorage>
+#include <QWaitCondition>
+
+#include "AppThread.h"
+#include "FinalProjectApp.h"
+#include "LatencyStatistics.h"
+#include "QtParallelFor.h"
+#include "Trace.h"
+
+// Runs the whole FinalProjectApp pipeline without a window for as long as a session
+// lasts, and fails if it doesn't stay flat:
+//
+//   SoakTest [-duration seconds] [-synthetic | -video file] [-width n] [-height n]
+//            [-interval seconds] [-warmup samples] [-o Soak.csv]
+//            [-rss MB] [-heap MB] [-allocations n] [-fds n] [-latency fraction] [-fps fraction]
+//
+// Frames come from the synthetic generator (the default, at 30 fps) or a looped
+// recording, through the capture thread, detection with tracking on, the recorder-free
+// frame log and the preview conversion; a display consumer stands in for the GUI.
+// Every -interval (default a minute) it samples the resident set, the bytes malloc has
+// handed out, live C++ allocations, open file descriptors, frames processed and shown,
+// and the median and 99th percentile of every traced stage (see Trace.h) over that
+// interval. The sample after -warmup intervals (default 2) is the baseline; the run
+// fails as soon as a later sample exceeds it by more than:
+//
+//   -rss MB, -heap MB     resident set or malloc'd bytes growth (default 64, 32)
+//   -allocations n        live C++ allocations growth (default 20000)
+//   -fds n                open file descriptor growth (default 8)
+//   -latency fraction     a stage's 99th percentile, relative, and by at least 1 ms (default 0.5)
+//   -fps fraction         processed frame rate drop, relative (default 0.2)
+//
+// All samples go to -o as Minute,Metric,Value rows. The exit code is 0 if the run passed.
+
+/** Live C++ allocations of the whole process, counted by the operators below */
+static QAtomicInt LiveAllocations;
+
+void* operator new(size_t size)
+{
+  void* p = malloc(size ? size : 1);
+  if(p == 0)
+    throw std::bad_alloc();
+  LiveAllocations.fetchAndAddRelaxed(1);
+  return p;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* p) throw()
+{
+  if(p == 0)
+    return;
+  LiveAllocations.fetchAndAddRelaxed(-1);
+  free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+  operator delete(p);
+}
+
+
+/** Orders stage names by their text; the same stage can be named from several files */
+struct NameLess
+{
+  bool operator()(const char* a, const char* b) const { return strcmp(a, b) < 0; }
+};
+
+typedef std::map<const char*, LatencyStatistics*, NameLess> StageMap;
+
+/** Durations of the traced stages over the current interval */
+static QMutex StageMutex;
+static StageMap Stages;
+
+/** Begin events not ended yet, per thread */
+struct OpenStage
+{
+  const char* Name;
+  double Ticks;
+};
+static QThreadStorage< std::vector<OpenStage>* > OpenStages;
+
+
+/** Installed as the library's trace function: turns begin/end pairs into stage durations */
+static void RecordStage(const char* name, char phase, int value)
+{
+  if(phase != 'B' && phase != 'E')
+    return;
+  if(!OpenStages.hasLocalData())
+    OpenStages.setLocalData(new std::vector<OpenStage>);
+  std::vector<OpenStage>& open = *OpenStages.localData();
+
+  if(phase == 'B')
+  {
+    OpenStage stage = { name, (double)cvGetTickCount() };
+    open.push_back(stage);
+    return;
+  }
+
+  // Scopes nest, so the end belongs to the innermost begin
+  if(open.empty())
+    return;
+  OpenStage stage = open.back();
+  open.pop_back();
+  double milliseconds = ((double)cvGetTickCount() - stage.Ticks) / (cvGetTickFrequency() * 1000.0);
+
+  QMutexLocker lock(&StageMutex);
+  StageMap::iterator it = Stages.find(stage.Name);
+  if(it == Stages.end())
+    it = Stages.insert(std::make_pair(stage.Name, new LatencyStatistics)).first;
+  it->second->Add(milliseconds);
+}
+
+
+/** One sample of everything that must stay flat */
+struct Sample
+{
+  double ResidentMB;
+  double HeapMB;
+  int Allocations;
+  int FileDescriptors;
+  double FramesPerSecond;
+  double DisplayedPerSecond;
+  std::map<std::string, double> Median;
+  std::map<std::string, double> Percentile99;
+};
+
+
+static double ResidentMegabytes()
+{
+#ifdef __linux__
+  FILE* file = fopen("/proc/self/statm", "r");
+  long size = 0, resident = 0;
+  if(file)
+  {
+    if(fscanf(file, "%ld %ld", &size, &resident) != 2)
+      resident = 0;
+    fclose(file);
+  }
+  return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#else
+  return 0;
+#endif
+}
+
+
+static double HeapMegabytes()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 info = mallinfo2();
+  return ((double)info.uordblks + (double)info.hblkhd) / (1024.0 * 1024.0);
+#elif defined(__GLIBC__)
+  // The older counters are ints and wrap past 2 GB
+  struct mallinfo info = mallinfo();
+  return ((double)(unsigned int)info.uordblks + (double)(unsigned int)info.hblkhd) / (1024.0 * 1024.0);
+#else
+  return 0;
+#endif
+}
+
+
+static int OpenFileDescriptors()
+{
+#ifdef __linux__
+  DIR* directory = opendir("/proc/self/fd");
+  if(directory == 0)
+    return 0;
+  int count = 0;
+  while(struct dirent* entry = readdir(directory))
+    if(entry->d_name[0] != '.')
+      count++;
+  closedir(directory);
+
+  // Leave out the descriptor of the listing itself
+  return count - 1;
+#else
+  return 0;
+#endif
+}
+
+
+/** Take a sample, and start the stage statistics of the next interval */
+static Sample TakeSample(int frames, int displayed, double seconds)
+{
+  Sample sample;
+  sample.ResidentMB = ResidentMegabytes();
+  sample.HeapMB = HeapMegabytes();
+  sample.Allocations = LiveAllocations.fetchAndAddRelaxed(0);
+  sample.FileDescriptors = OpenFileDescriptors();
+  sample.FramesPerSecond = seconds > 0 ? frames / seconds : 0;
+  sample.DisplayedPerSecond = seconds > 0 ? displayed / seconds : 0;
+
+  QMutexLocker lock(&StageMutex);
+  for(StageMap::iterator it = Stages.begin(); it != Stages.end(); ++it)
+  {
+    if(it->second->GetCount() == 0)
+      continue;
+    sample.Median[it->first] = it->second->GetPercentile(0.5);
+    sample.Percentile99[it->first] = it->second->GetPercentile(0.99);
+    it->second->Reset();
+  }
+  return sample;
+}
+
+
+static void WriteSample(FILE* file, int minute, const Sample& sample)
+{
+  if(file == 0)
+    return;
+  fprintf(file, "%d,Resident MB,%.2f\n", minute, sample.ResidentMB);
+  fprintf(file, "%d,Heap MB,%.2f\n", minute, sample.HeapMB);
+  fprintf(file, "%d,Live allocations,%d\n", minute, sample.Allocations);
+  fprintf(file, "%d,File descriptors,%d\n", minute, sample.FileDescriptors);
+  fprintf(file, "%d,Frames per second,%.2f\n", minute, sample.FramesPerSecond);
+  fprintf(file, "%d,Displayed per second,%.2f\n", minute, sample.DisplayedPerSecond);
+  std::map<std::string, double>::const_iterator it;
+  for(it = sample.Median.begin(); it != sample.Median.end(); ++it)
+    fprintf(file, "%d,%s p50 ms,%.2f\n", minute, it->first.c_str(), it->second);
+  for(it = sample.Percentile99.begin(); it != sample.Percentile99.end(); ++it)
+    fprintf(file, "%d,%s p99 ms,%.2f\n", minute, it->first.c_str(), it->second);
+  fflush(file);
+}
+
+
+/** Drift limits */
+struct Limits
+{
+  double ResidentMB;
+  double HeapMB;
+  int Allocations;
+  int FileDescriptors;
+  double Latency;
+  double FrameRate;
+};
+
+
+/** Describe the first limit the sample breaks against the baseline; empty if none */
+static std::string CheckDrift(const Sample& baseline, const Sample& sample, const Limits& limits)
+{
+  char text[256];
+  if(sample.ResidentMB - baseline.ResidentMB > limits.ResidentMB)
+  {
+    snprintf(text, sizeof(text), "resident set grew %.1f MB", sample.ResidentMB - baseline.ResidentMB);
+    return text;
+  }
+  if(sample.HeapMB - baseline.HeapMB > limits.HeapMB)
+  {
+    snprintf(text, sizeof(text), "heap grew %.1f MB", sample.HeapMB - baseline.HeapMB);
+    return text;
+  }
+  if(sample.Allocations - baseline.Allocations > limits.Allocations)
+  {
+    snprintf(text, sizeof(text), "%d more live allocations", sample.Allocations - baseline.Allocations);
+    return text;
+  }
+  if(sample.FileDescriptors - baseline.FileDescriptors > limits.FileDescriptors)
+  {
+    snprintf(text, sizeof(text), "%d more open file descriptors", sample.FileDescriptors - baseline.FileDescriptors);
+    return text;
+  }
+  if(sample.FramesPerSecond < baseline.FramesPerSecond * (1.0 - limits.FrameRate))
+  {
+    snprintf(text, sizeof(text), "frame rate fell from %.1f to %.1f", baseline.FramesPerSecond, sample.FramesPerSecond);
+    return text;
+  }
+
+  // Small stages jitter by fractions of a millisecond, so a rise must also be a whole one
+  std::map<std::string, double>::const_iterator it;
+  for(it = sample.Percentile99.begin(); it != sample.Percentile99.end(); ++it)
+  {
+    std::map<std::string, double>::const_iterator base = baseline.Percentile99.find(it->first);
+    if(base == baseline.Percentile99.end())
+      continue;
+    if(it->second > base->second * (1.0 + limits.Latency) && it->second > base->second + 1.0)
+    {
+      snprintf(text, sizeof(text), "%s 99th percentile rose from %.1f to %.1f ms", it->first.c_str(), base->second, it->second);
+      return text;
+    }
+  }
+  return "";
+}
+
+
+int main( int argc, char** argv )
+{
+  QCoreApplication application(argc, argv);
+
+  RunOptions options;
+  options.Synthetic = true;
+  options.Duration = 24 * 3600;
+  int width = 640, height = 480;
+  double interval = 60;
+  int warmup = 2;
+  std::string output = "Soak.csv";
+  Limits limits = { 64, 32, 20000, 8, 0.5, 0.2 };
+  for(int i = 1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-synthetic") == 0)
+    {
+      options.Synthetic = true;
+      options.Video.clear();
+      continue;
+    }
+    if(i + 1 >= argc)
+      break;
+    if(strcmp(argv[i], "-duration") == 0) options.Duration = atof(argv[++i]);
+    else if(strcmp(argv[i], "-video") == 0) { options.Video = argv[++i]; options.Synthetic = false; }
+    else if(strcmp(argv[i], "-width") == 0) width = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-height") == 0) height = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-interval") == 0) interval = atof(argv[++i]);
+    else if(strcmp(argv[i], "-warmup") == 0) warmup = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-o") == 0) output = argv[++i];
+    else if(strcmp(argv[i], "-rss") == 0) limits.ResidentMB = atof(argv[++i]);
+    else if(strcmp(argv[i], "-heap") == 0) limits.HeapMB = atof(argv[++i]);
+    else if(strcmp(argv[i], "-allocations") == 0) limits.Allocations = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-fds") == 0) limits.FileDescriptors = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-latency") == 0) limits.Latency = atof(argv[++i]);
+    else if(strcmp(argv[i], "-fps") == 0) limits.FrameRate = atof(argv[++i]);
+  }
+  if(interval < 1) interval = 1;
+  if(warmup < 0) warmup = 0;
+
+  // Stage durations come from the library's trace points, with nothing else recorded
+  SetTraceFunction(RecordStage);
+  SetParallelFor(QtParallelFor);
+
+  FILE* file = fopen(output.c_str(), "w");
+  if(file)
+    fprintf(file, "Minute,Metric,Value\n");
+  else
+    printf("Couldnt write '%s', samples go to the console only\n", output.c_str());
+
+  // The app on its own thread, as under the window, with tracking on
+  AppThread* appThread = new AppThread;
+  FinalProjectApp* app = appThread->StartApp();
+  app->SetRunOptions(options);
+  app->SetRequestedCaptureSize(width, height);
+  QMetaObject::invokeMethod(app, "SetupApp", Qt::QueuedConnection);
+  app->SetApplyFilter(true);
+
+  printf("Soaking for %.0f s from %s, sampling every %.0f s\n", options.Duration,
+    options.Video.empty() ? "synthetic frames" : options.Video.c_str(), interval);
+
+  // Stand in for the GUI: take every preview the app publishes, at display rate
+  TripleBuffer& display = app->GetDisplayBuffer();
+  double ticksPerSecond = cvGetTickFrequency() * 1000000.0;
+  double start = (double)cvGetTickCount();
+  double intervalStart = start;
+  int displayed = 0;
+  int samples = 0;
+  int framesAtInterval = 0;
+  Sample baseline;
+  std::string failure;
+
+  // QThread::msleep() is protected in Qt 4; a timed wait nobody wakes sleeps the same
+  QMutex sleepMutex;
+  QWaitCondition sleepCondition;
+
+  // Frames processed are counted from the trace, as "frame" stages
+  while(failure.empty())
+  {
+    sleepMutex.lock();
+    sleepCondition.wait(&sleepMutex, 16);
+    sleepMutex.unlock();
+    if(display.Acquire() && !display.GetFrontBuffer().isNull())
+      displayed++;
+
+    double now = (double)cvGetTickCount();
+    if(now - intervalStart < interval * ticksPerSecond)
+      continue;
+
+    int frames;
+    {
+      QMutexLocker lock(&StageMutex);
+      StageMap::iterator it = Stages.find("frame");
+      frames = it == Stages.end() ? 0 : it->second->GetCount();
+    }
+    framesAtInterval = frames;
+    Sample sample = TakeSample(frames, displayed, (now - intervalStart) / ticksPerSecond);
+    intervalStart = now;
+    displayed = 0;
+    samples++;
+
+    WriteSample(file, samples, sample);
+    printf("%3d: %.1f MB resident, %.1f MB heap, %d allocations, %d fds, %.1f fps (%.1f shown)",
+      samples, sample.ResidentMB, sample.HeapMB, sample.Allocations, sample.FileDescriptors,
+      sample.FramesPerSecond, sample.DisplayedPerSecond);
+    if(sample.Percentile99.count("frame"))
+      printf(", frame p50 %.1f p99 %.1f ms", sample.Median["frame"], sample.Percentile99["frame"]);
+    printf("\n");
+
+    if(samples == warmup + 1)
+      baseline = sample;
+    else if(samples > warmup + 1)
+      failure = CheckDrift(baseline, sample, limits);
+
+    if((now - start) / ticksPerSecond >= options.Duration)
+      break;
+  }
+
+  // Deleting the thread deletes the app on it, which stops capture and writes the logs
+  delete appThread;
+  SetTraceFunction(0);
+  if(file)
+    fclose(file);
+
+  if(samples <= warmup + 1)
+    printf("Ran %d samples, not past the warm-up; nothing compared\n", samples);
+  if(!failure.empty())
+  {
+    printf("FAILED after %d samples: %s\n", samples, failure.c_str());
+    return 1;
+  }
+  if(framesAtInterval == 0)
+  {
+    printf("FAILED: no frames were processed\n");
+    return 1;
+  }
+  printf("Passed: %d samples within the drift limits\n", samples);
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "TemplateFeatureDetector.h"
+
+#include <highgui.h>
+
+TemplateFeatureDetector
+::TemplateFeatureDetector()
+{
+  m_Template = 0;
+  m_Original = 0;
+  m_TemplateScale = 1.0;
+  m_Result = 0;
+  m_MinimumScore = 0.7;
+}
+
+
+TemplateFeatureDetector
+::~TemplateFeatureDetector()
+{
+  if(m_Template) cvReleaseImage(&m_Template);
+  if(m_Original) cvReleaseImage(&m_Original);
+  if(m_Result) cvReleaseImage(&m_Result);
+}
+
+
+bool
+TemplateFeatureDetector
+::Load(const std::string& filename)
+{
+  IplImage* image = cvLoadImage(filename.c_str(), CV_LOAD_IMAGE_GRAYSCALE);
+  if(image == 0)
+    return false;
+
+  if(m_Original) cvReleaseImage(&m_Original);
+  if(m_Template) cvReleaseImage(&m_Template);
+  m_Original = image;
+  m_Template = 0;
+  m_Model = filename;
+  return true;
+}
+
+
+CvRect
+TemplateFeatureDetector
+::DetectObject(IplImage* gray)
+{
+  if(m_Original == 0)
+    return cvRect(-1,-1,-1,-1);
+
+  // The template has to shrink along with the image
+  double inputScale = m_Parameters.InputScale < 1.0 ? m_Parameters.InputScale : 1.0;
+  if(m_Template == 0 || m_TemplateScale != inputScale)
+  {
+    if(m_Template) cvReleaseImage(&m_Template);
+    CvSize size = cvSize(cvRound(m_Original->width * inputScale), cvRound(m_Original->height * inputScale));
+    m_Template = cvCreateImage(size, IPL_DEPTH_8U, 1);
+    cvResize(m_Original, m_Template, CV_INTER_AREA);
+    m_TemplateScale = inputScale;
+  }
+
+  IplImage* detectImg = this->ApplyInputScale(gray);
+  CvSize size = cvGetSize(detectImg);
+  if(size.width < m_Template->width || size.height < m_Template->height)
+    return cvRect(-1,-1,-1,-1);
+
+  CvSize resultSize = cvSize(size.width - m_Template->width + 1, size.height - m_Template->height + 1);
+  if(m_Result == 0 || m_Result->width != resultSize.width || m_Result->height != resultSize.height)
+  {
+    if(m_Result) cvReleaseImage(&m_Result);
+    m_Result = cvCreateImage(resultSize, IPL_DEPTH_32F, 1);
+  }
+
+  cvMatchTemplate(detectImg, m_Template, m_Result, CV_TM_CCOEFF_NORMED);
+
+  double minScore, maxScore;
+  CvPoint minLocation, maxLocation;
+  cvMinMaxLoc(m_Result, &minScore, &maxScore, &minLocation, &maxLocation);
+  if(maxScore < m_MinimumScore)
+    return cvRect(-1,-1,-1,-1);
+
+  return this->UndoInputScale(cvRect(maxLocation.x, maxLocation.y, m_Template->width, m_Template->height));
+}
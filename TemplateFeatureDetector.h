@@ -0,0 +1,54 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _TemplateFeatureDetector_h
+#define _TemplateFeatureDetector_h
+
+#include "FeatureDetector.h"
+
+/** Normalized cross-correlation against a single gray template image. Far cheaper
+than a cascade on the small search areas of a fixed rig, but only finds the
+feature at the template's size and orientation. */
+class TemplateFeatureDetector : public FeatureDetector
+{
+public:
+
+  /** Constructor */
+  TemplateFeatureDetector();
+
+  /** Destructor */
+  virtual ~TemplateFeatureDetector();
+
+  virtual const char* GetBackend() const { return "template"; }
+  virtual bool Load(const std::string& filename);
+
+  /** Correlation (-1..1) the best match needs to count as found */
+  void SetMinimumScore(double score) { m_MinimumScore = score; }
+
+protected:
+
+  virtual CvRect DetectObject(IplImage* gray);
+
+  /** The template, already shrunk by the InputScale setting */
+  IplImage* m_Template;
+  IplImage* m_Original;
+  double m_TemplateScale;
+
+  /** Correlation map, kept between frames */
+  IplImage* m_Result;
+
+  double m_MinimumScore;
+};
+
+#endif
@@ -0,0 +1,271 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "ThreadPolicy.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* RoleNames[NUM_THREAD_ROLES] = { "capture", "detection", "logging", "gui" };
+
+ThreadPolicy
+::ThreadPolicy()
+{
+  m_LockMemory = false;
+}
+
+
+const char*
+ThreadPolicy
+::GetRoleName(int role)
+{
+  return role >= 0 && role < NUM_THREAD_ROLES ? RoleNames[role] : "unknown";
+}
+
+
+bool
+ThreadPolicy
+::Load(const char* filename)
+{
+  FILE* file = fopen(filename, "r");
+  if(file == 0)
+    return false;
+
+  char line[256], name[64], cpus[128], scheduling[16];
+  int level;
+  while(fgets(line, sizeof(line), file))
+  {
+    if(line[0] == '#')
+      continue;
+
+    if(sscanf(line, "lockmemory %d", &level) == 1)
+    {
+      m_LockMemory = level != 0;
+      continue;
+    }
+    if(sscanf(line, "%63s %127s %15s %d", name, cpus, scheduling, &level) != 4)
+      continue;
+
+    int role = 0;
+    while(role < NUM_THREAD_ROLES && strcmp(name, RoleNames[role]) != 0)
+      role++;
+    if(role == NUM_THREAD_ROLES)
+    {
+      printf("Error, unknown thread role in thread policy (%s)\n", name);
+      continue;
+    }
+
+    ThreadSettings settings;
+    if(strcmp(cpus, "-") != 0)
+      for(char* cpu = strtok(cpus, ","); cpu; cpu = strtok(0, ","))
+        settings.Cpus.push_back(atoi(cpu));
+    settings.RealTime = strcmp(scheduling, "fifo") == 0;
+    settings.Level = level;
+    this->Set(role, settings);
+  }
+  fclose(file);
+  return true;
+}
+
+
+void
+ThreadPolicy
+::Set(int role, const ThreadSettings& settings)
+{
+  if(role < 0 || role >= NUM_THREAD_ROLES)
+  {
+    printf("Error, invalid thread role (%i)\n", role);
+    return;
+  }
+
+  m_Settings[role] = settings;
+  m_Settings[role].Configured = true;
+}
+
+
+const ThreadSettings&
+ThreadPolicy
+::Get(int role) const
+{
+  return m_Settings[role < 0 || role >= NUM_THREAD_ROLES ? GuiThreadRole : role];
+}
+
+
+long
+ThreadPolicy
+::GetCurrentThreadId()
+{
+#ifdef __linux__
+  return (long)syscall(SYS_gettid);
+#else
+  return 0;
+#endif
+}
+
+
+void
+ThreadPolicy
+::Apply(int role)
+{
+  const ThreadSettings& settings = this->Get(role);
+  long id = GetCurrentThreadId();
+
+#ifdef __linux__
+  if(settings.Configured)
+  {
+    if(!settings.Cpus.empty())
+    {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      for(size_t c = 0; c < settings.Cpus.size(); c++)
+        CPU_SET(settings.Cpus[c], &cpus);
+      if(sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+        printf("Couldnt pin the %s thread: %s\n", GetRoleName(role), strerror(errno));
+    }
+
+    // Both only affect the calling thread on Linux
+    if(settings.RealTime)
+    {
+      struct sched_param param;
+      param.sched_priority = settings.Level;
+      int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+      if(error != 0)
+        printf("Couldnt make the %s thread SCHED_FIFO %d: %s\n", GetRoleName(role), settings.Level, strerror(error));
+    }
+    else if(setpriority(PRIO_PROCESS, (id_t)id, settings.Level) != 0)
+      printf("Couldnt set the %s thread to nice %d: %s\n", GetRoleName(role), settings.Level, strerror(errno));
+  }
+#endif
+
+  WatchedThread thread;
+  thread.Role = role;
+  thread.Id = id;
+  thread.Running = ReadCounters(id, thread.Start);
+  thread.Last = thread.Start;
+
+  QMutexLocker lock(&m_Mutex);
+  m_Threads.push_back(thread);
+}
+
+
+void
+ThreadPolicy
+::Leave()
+{
+  long id = GetCurrentThreadId();
+
+  QMutexLocker lock(&m_Mutex);
+  for(size_t t = 0; t < m_Threads.size(); t++)
+  {
+    if(m_Threads[t].Id == id && m_Threads[t].Running)
+    {
+      ReadCounters(id, m_Threads[t].Last);
+      m_Threads[t].Running = false;
+    }
+  }
+}
+
+
+bool
+ThreadPolicy
+::ReadCounters(long id, ThreadCounters& counters)
+{
+  memset(&counters, 0, sizeof(counters));
+#ifdef __linux__
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/task/%ld/status", id);
+  FILE* file = fopen(path, "r");
+  if(file == 0)
+    return false;
+
+  char line[256];
+  while(fgets(line, sizeof(line), file))
+  {
+    sscanf(line, "voluntary_ctxt_switches: %ld", &counters.Voluntary);
+    sscanf(line, "nonvoluntary_ctxt_switches: %ld", &counters.Involuntary);
+  }
+  fclose(file);
+
+  // <ns on the CPU> <ns waiting for it> <timeslices>; needs schedstats in the kernel
+  snprintf(path, sizeof(path), "/proc/self/task/%ld/schedstat", id);
+  file = fopen(path, "r");
+  if(file)
+  {
+    unsigned long long running, waiting;
+    if(fscanf(file, "%llu %llu %ld", &running, &waiting, &counters.Timeslices) == 3)
+      counters.RunDelay = waiting / 1.0e6;
+    fclose(file);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+void
+ThreadPolicy
+::Print() const
+{
+  for(int r = 0; r < NUM_THREAD_ROLES; r++)
+  {
+    const ThreadSettings& settings = m_Settings[r];
+    if(!settings.Configured)
+      continue;
+
+    printf("%s thread: ", RoleNames[r]);
+    if(settings.Cpus.empty())
+      printf("any CPU");
+    for(size_t c = 0; c < settings.Cpus.size(); c++)
+      printf("%sCPU %d", c ? ", " : "", settings.Cpus[c]);
+    printf(settings.RealTime ? ", SCHED_FIFO %d\n" : ", nice %d\n", settings.Level);
+  }
+  if(m_LockMemory)
+    printf("Frame buffers locked in memory\n");
+}
+
+
+void
+ThreadPolicy
+::PrintReport()
+{
+  QMutexLocker lock(&m_Mutex);
+
+  printf("Thread scheduling (context switches voluntary/involuntary, waiting for a CPU):\n");
+  for(size_t t = 0; t < m_Threads.size(); t++)
+  {
+    WatchedThread& thread = m_Threads[t];
+    if(thread.Running)
+      ReadCounters(thread.Id, thread.Last);
+
+    // Involuntary switches are preemptions; with good isolation they stay near zero
+    long slices = thread.Last.Timeslices - thread.Start.Timeslices;
+    double delay = thread.Last.RunDelay - thread.Start.RunDelay;
+    printf("  %-9s %6ld: %ld/%ld switches, %.1f ms waiting (%.3f ms per timeslice)\n",
+      GetRoleName(thread.Role), thread.Id,
+      thread.Last.Voluntary - thread.Start.Voluntary, thread.Last.Involuntary - thread.Start.Involuntary,
+      delay, slices > 0 ? delay / slices : 0);
+  }
+}
@@ -0,0 +1,127 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _ThreadPolicy_h
+#define _ThreadPolicy_h
+
+#include <vector>
+
+#include <QMutex>
+
+/** The threads of the app that can be given their own CPU and priority */
+enum ThreadRole
+{
+  CaptureThreadRole,    // CaptureThread, waiting on the camera
+  DetectionThreadRole,  // the app's own thread: detection, attention and the frame log
+  LoggingThreadRole,    // the session recorder's encoder, writing video to disk
+  GuiThreadRole,        // the window
+  NUM_THREAD_ROLES
+};
+
+/** CPU and scheduling settings of one thread role */
+struct ThreadSettings
+{
+  ThreadSettings() : RealTime(false), Level(0), Configured(false) {}
+
+  /** CPUs the thread may run on; empty for any */
+  std::vector<int> Cpus;
+
+  /** SCHED_FIFO with Level as its priority (1-99), or normal scheduling with Level as the nice value */
+  bool RealTime;
+  int Level;
+
+  /** Was the role mentioned at all? Unconfigured threads are only watched. */
+  bool Configured;
+};
+
+/** Isolates the frame loop from other work on a shared machine. A rig can pin each of
+the app's threads to CPUs, run it SCHED_FIFO or at a nice level, and lock the frame
+buffers in memory with a ThreadPolicy.txt of lines
+  <capture|detection|logging|gui> <cpu list, e.g. 2,3, or -> <fifo|nice> <level>
+  lockmemory <0|1>
+Every thread of a role calls Apply() when it starts. Whether the isolation works shows
+in the report: voluntary and involuntary context switches and the time spent waiting
+for a CPU while runnable, per thread. Settings need CAP_SYS_NICE or matching rlimits;
+without them a warning is printed and the thread runs as before. Linux only; elsewhere
+only the report's header is printed. */
+class ThreadPolicy
+{
+public:
+
+  /** Constructor; nothing is configured */
+  ThreadPolicy();
+
+  /** Read settings from a file; returns false if it can't be opened */
+  bool Load(const char* filename);
+
+  /** Change the settings of one role */
+  void Set(int role, const ThreadSettings& settings);
+  const ThreadSettings& Get(int role) const;
+
+  /** Lock the frame buffers in memory so they are never paged out */
+  void SetLockMemory(bool lock) { m_LockMemory = lock; }
+  bool GetLockMemory() const { return m_LockMemory; }
+
+  /** Apply a role's settings to the calling thread and start watching it */
+  void Apply(int role);
+
+  /** The calling thread is about to exit; keep its final counts for the report */
+  void Leave();
+
+  /** The settings, one line per configured role, to stdout */
+  void Print() const;
+
+  /** Context switches and scheduling delay of every thread that called Apply(), to stdout */
+  void PrintReport();
+
+  /** "capture", "detection", ... */
+  static const char* GetRoleName(int role);
+
+protected:
+
+  /** Scheduler counters of one thread since it started */
+  struct ThreadCounters
+  {
+    long Voluntary;
+    long Involuntary;
+    long Timeslices;
+
+    /** Milliseconds spent runnable but waiting for a CPU */
+    double RunDelay;
+  };
+
+  struct WatchedThread
+  {
+    int Role;
+    long Id;
+    bool Running;
+    ThreadCounters Start;
+    ThreadCounters Last;
+  };
+
+  /** Read the counters of a thread of this process; false if they aren't available */
+  static bool ReadCounters(long id, ThreadCounters& counters);
+
+  /** Kernel id of the calling thread */
+  static long GetCurrentThreadId();
+
+  ThreadSettings m_Settings[NUM_THREAD_ROLES];
+  bool m_LockMemory;
+
+  /** Threads register from wherever they run */
+  QMutex m_Mutex;
+  std::vector<WatchedThread> m_Threads;
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "TiledHaarFeatureDetector.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "ParallelFor.h"
+#include "Trace.h"
+
+static bool BiggerFirst(const CvRect& a, const CvRect& b)
+{
+  return a.width * a.height > b.width * b.height;
+}
+
+TiledHaarFeatureDetector
+::TiledHaarFeatureDetector()
+{
+  m_MaxObjectSize = 0;
+  m_TileSize = 0;
+  m_SuppressionOverlap = 0.5;
+  m_NumberOfTiles = 0;
+}
+
+
+TiledHaarFeatureDetector
+::~TiledHaarFeatureDetector()
+{
+  this->ReleaseTiles();
+}
+
+
+void
+TiledHaarFeatureDetector
+::ReleaseTiles()
+{
+  // The first tile borrows the detector's own cascade
+  for(size_t t = 0; t < m_Tiles.size(); t++)
+  {
+    if(t > 0 && m_Tiles[t].Cascade) cvReleaseHaarClassifierCascade(&m_Tiles[t].Cascade);
+    if(m_Tiles[t].Storage) cvReleaseMemStorage(&m_Tiles[t].Storage);
+  }
+  m_Tiles.clear();
+}
+
+
+bool
+TiledHaarFeatureDetector
+::Load(const std::string& model)
+{
+  // "<cascade file>#<max object size>"
+  std::string file = model;
+  int maxObjectSize = 0;
+  size_t hash = model.rfind('#');
+  if(hash != std::string::npos)
+  {
+    file = model.substr(0, hash);
+    maxObjectSize = atoi(model.c_str() + hash + 1);
+  }
+
+  // The tile cascades are copies of the old one, so they go with it
+  this->ReleaseTiles();
+  if(!HaarFeatureDetector::Load(file))
+    return false;
+
+  m_MaxObjectSize = std::max(0, maxObjectSize);
+  return true;
+}
+
+
+void
+TiledHaarFeatureDetector
+::SuppressOverlaps(std::vector<CvRect>& rects, double overlap)
+{
+  std::stable_sort(rects.begin(), rects.end(), BiggerFirst);
+
+  size_t kept = 0;
+  for(size_t r = 0; r < rects.size(); r++)
+  {
+    const CvRect& rect = rects[r];
+    bool duplicate = false;
+    for(size_t k = 0; k < kept && !duplicate; k++)
+    {
+      const CvRect& other = rects[k];
+      int w = std::min(rect.x + rect.width, other.x + other.width) - std::max(rect.x, other.x);
+      int h = std::min(rect.y + rect.height, other.y + other.height) - std::max(rect.y, other.y);
+
+      // Sorted biggest first, so rect is the smaller of the two
+      duplicate = w > 0 && h > 0 && w * h > overlap * rect.width * rect.height;
+    }
+    if(!duplicate)
+      rects[kept++] = rect;
+  }
+  rects.resize(kept);
+}
+
+
+CvRect
+TiledHaarFeatureDetector
+::DetectObject(IplImage* gray)
+{
+  m_NumberOfTiles = 0;
+  m_Objects.clear();
+  if(m_Cascade == 0)
+    return cvRect(-1,-1,-1,-1);
+
+  // Some cascades are accurate enough on an even smaller image
+  IplImage* detectImg = this->ApplyInputScale(gray);
+
+  // Results are relative to the ROI, like every detector's
+  CvSize size = cvGetSize(detectImg);
+  CvRect roi = detectImg->roi ? cvGetImageROI(detectImg) : cvRect(0, 0, detectImg->width, detectImg->height);
+
+  // Tiles overlap by the biggest object they look for, and are a few objects wide
+  CvSize window = m_Cascade->orig_window_size;
+  int maxObject = m_MaxObjectSize > 0 ? m_MaxObjectSize : std::min(size.width, size.height) / 4;
+  maxObject = std::max(maxObject, std::max(window.width, window.height));
+  int tileSize = m_TileSize > 0 ? m_TileSize : 2 * maxObject;
+  int columns = std::max(1, (size.width - maxObject + tileSize - 1) / tileSize);
+  int rows = std::max(1, (size.height - maxObject + tileSize - 1) / tileSize);
+
+  // One more task looks for the objects too big for any tile, over the whole area
+  int tiles = columns * rows + 1;
+  if((int)m_Tiles.size() < tiles)
+  {
+    // Each tile gets its own cascade: cvHaarDetectObjects keeps per-image state in it
+    size_t t = m_Tiles.size();
+    m_Tiles.resize(tiles);
+    for(; t < m_Tiles.size(); t++)
+    {
+      m_Tiles[t].Cascade = t == 0 ? m_Cascade : (CvHaarClassifierCascade*)cvLoad(m_Model.c_str(), 0, 0, 0);
+      m_Tiles[t].Storage = cvCreateMemStorage(0);
+    }
+  }
+
+  for(int t = 0; t < tiles; t++)
+  {
+    Tile& tile = m_Tiles[m_NumberOfTiles];
+    if(tile.Cascade == 0)
+      break;
+
+    if(t < tiles - 1)
+    {
+      // Even spacing, so the last column and row end at the border
+      int x0 = columns > 1 ? (int)((long long)(t % columns) * (size.width - maxObject - tileSize) / (columns - 1)) : 0;
+      int y0 = rows > 1 ? (int)((long long)(t / columns) * (size.height - maxObject - tileSize) / (rows - 1)) : 0;
+      int x1 = std::min(size.width, std::max(x0, 0) + tileSize + maxObject);
+      int y1 = std::min(size.height, std::max(y0, 0) + tileSize + maxObject);
+      x0 = std::max(x0, 0);
+      y0 = std::max(y0, 0);
+      tile.Bounds = cvRect(x0, y0, x1 - x0, y1 - y0);
+      tile.MinSize = m_Parameters.MinSize;
+      tile.MaxSize = maxObject;
+    }
+    else
+    {
+      tile.Bounds = cvRect(0, 0, size.width, size.height);
+      tile.MinSize = std::max(m_Parameters.MinSize, maxObject);
+      tile.MaxSize = 0;
+    }
+    if(tile.Bounds.width < window.width || tile.Bounds.height < window.height)
+      continue;
+
+    // A header over the pixels, so the tiles don't fight over the ROI
+    cvInitImageHeader(&tile.Region, cvSize(tile.Bounds.width, tile.Bounds.height), IPL_DEPTH_8U, 1);
+    cvSetData(&tile.Region, detectImg->imageData + (roi.y + tile.Bounds.y) * detectImg->widthStep + roi.x + tile.Bounds.x,
+      detectImg->widthStep);
+    m_NumberOfTiles++;
+  }
+
+  ParallelFor(m_NumberOfTiles, DetectTile, this);
+
+  // The same object seen from two overlapping tiles is reported once
+  for(int t = 0; t < m_NumberOfTiles; t++)
+  {
+    const Tile& tile = m_Tiles[t];
+    for(size_t f = 0; f < tile.Found.size(); f++)
+    {
+      CvRect rect = tile.Found[f];
+      m_Objects.push_back(this->UndoInputScale(cvRect(rect.x + tile.Bounds.x, rect.y + tile.Bounds.y, rect.width, rect.height)));
+    }
+  }
+  SuppressOverlaps(m_Objects, m_SuppressionOverlap);
+
+  return m_Objects.empty() ? cvRect(-1,-1,-1,-1) : m_Objects[0];
+}
+
+
+void
+TiledHaarFeatureDetector
+::DetectTile(void* data, int index)
+{
+  TiledHaarFeatureDetector* self = (TiledHaarFeatureDetector*)data;
+  Tile& tile = self->m_Tiles[index];
+  const DetectionParameters& p = self->m_Parameters;
+  TraceScope trace("tile", index);
+
+  cvClearMemStorage(tile.Storage);
+  CvSeq* rects = cvHaarDetectObjects(&tile.Region, tile.Cascade, tile.Storage,
+    p.ScaleFactor, p.MinNeighbors, p.Flags, cvSize(tile.MinSize, tile.MinSize), cvSize(tile.MaxSize, tile.MaxSize));
+
+  tile.Found.clear();
+  for(int r = 0; r < (rects ? rects->total : 0); r++)
+    tile.Found.push_back(*(CvRect*)cvGetSeqElem(rects, r));
+}
@@ -0,0 +1,96 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _TiledHaarFeatureDetector_h
+#define _TiledHaarFeatureDetector_h
+
+#include <vector>
+
+#include "HaarFeatureDetector.h"
+
+/** Haar detection split across cores for high resolution frames. The search area is cut
+into tiles that overlap by the biggest object size searched for tile by tile, so every
+object up to that size lies whole inside at least one tile. The tiles run in parallel
+through ParallelFor(), each with its own copy of the cascade, together with one pass over
+the whole area that only looks for objects bigger than that; its few large windows are cheap.
+Hits from neighbouring tiles that are the same object are merged with non-maximum suppression.
+The model is "<cascade file>" or "<cascade file>#<max tile object size in pixels>"; without
+a size a quarter of the search area's shorter side is used. */
+class TiledHaarFeatureDetector : public HaarFeatureDetector
+{
+public:
+
+  /** Constructor */
+  TiledHaarFeatureDetector();
+
+  /** Destructor */
+  virtual ~TiledHaarFeatureDetector();
+
+  virtual const char* GetBackend() const { return "tiled"; }
+  virtual bool Load(const std::string& model);
+
+  /** Width and height of a tile before the overlap is added; 0 = twice the max object size */
+  void SetTileSize(int size) { m_TileSize = size; }
+
+  /** Rectangles overlapping the one kept by more than this fraction of the smaller one's area are dropped */
+  void SetSuppressionOverlap(double overlap) { m_SuppressionOverlap = overlap; }
+
+  /** Tiles (including the large object pass) in the last call */
+  int GetNumberOfTiles() const { return m_NumberOfTiles; }
+
+  /** Every object found in the last call after merging, biggest first, relative to the ROI */
+  const std::vector<CvRect>& GetObjects() const { return m_Objects; }
+
+  /** Sort biggest first and drop every rectangle overlapping a bigger kept one by more
+  than the given fraction of the smaller one's area */
+  static void SuppressOverlaps(std::vector<CvRect>& rects, double overlap);
+
+protected:
+
+  virtual CvRect DetectObject(IplImage* gray);
+
+  /** Run the cascade on one tile; the ParallelForBody */
+  static void DetectTile(void* data, int index);
+
+  /** A tile and the cascade copy that searches it */
+  struct Tile
+  {
+    CvHaarClassifierCascade* Cascade;
+    CvMemStorage* Storage;
+
+    /** Header over the tile's pixels in the image being searched */
+    IplImage Region;
+    CvRect Bounds;
+
+    /** Object sizes searched for; 0 = no limit */
+    int MinSize;
+    int MaxSize;
+
+    /** Hits relative to Bounds; kept between frames so they don't allocate */
+    std::vector<CvRect> Found;
+  };
+
+  void ReleaseTiles();
+
+  /** Object size limit for the tiles, from the model; 0 = from the search area */
+  int m_MaxObjectSize;
+  int m_TileSize;
+  double m_SuppressionOverlap;
+
+  int m_NumberOfTiles;
+  std::vector<Tile> m_Tiles;
+  std::vector<CvRect> m_Objects;
+};
+
+#endif
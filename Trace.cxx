@@ -0,0 +1,36 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "Trace.h"
+
+static TraceFunction InstalledTrace = 0;
+
+
+void SetTraceFunction(TraceFunction function)
+{
+  InstalledTrace = function;
+}
+
+
+void TraceEvent(const char* name, char phase, int value)
+{
+  if(InstalledTrace)
+    InstalledTrace(name, phase, value);
+}
+
+
+void TraceThreadName(const char* name)
+{
+  TraceEvent(name, 'M');
+}
@@ -0,0 +1,45 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _Trace_h
+#define _Trace_h
+
+/** Receives trace events. name must be a string literal or otherwise outlive the trace;
+phase is a Chrome trace-event phase: 'B' begin, 'E' end, 'i' instant, or 'M' to name the
+calling thread. value is shown with the event, e.g. a frame number or an epoch. */
+typedef void (*TraceFunction)(const char* name, char phase, int value);
+
+/** The detection library marks what it spends time on, such as each detector call, with
+TraceEvent(). The events go nowhere unless the host program installs a function that
+records them, e.g. TraceRecorder; install it before any thread starts tracing. */
+void SetTraceFunction(TraceFunction function);
+
+/** Hand an event to the installed function; costs one test when none is installed */
+void TraceEvent(const char* name, char phase, int value = 0);
+
+/** Name the calling thread in the trace */
+void TraceThreadName(const char* name);
+
+/** Begin event now and the matching end event when the scope is left */
+class TraceScope
+{
+public:
+  TraceScope(const char* name, int value = 0) : m_Name(name) { TraceEvent(name, 'B', value); }
+  ~TraceScope() { TraceEvent(m_Name, 'E'); }
+
+protected:
+  const char* m_Name;
+};
+
+#endif
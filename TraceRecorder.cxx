@@ -0,0 +1,224 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "TraceRecorder.h"
+
+#include <stdio.h>
+#include <vector>
+
+TraceRecorder* TraceRecorder::Installed = 0;
+
+TraceRecorder
+::TraceRecorder(int eventsPerThread)
+{
+  // A power of two lets the ring position be a mask of the event count
+  m_Capacity = 1;
+  while(m_Capacity < eventsPerThread)
+    m_Capacity *= 2;
+
+  m_StartTicks = cvGetTickCount();
+  m_Rings = 0;
+  m_NextThreadId = 1;
+}
+
+
+TraceRecorder
+::~TraceRecorder()
+{
+  this->Uninstall();
+
+  Ring* ring = m_Rings.fetchAndStoreAcquire(0);
+  while(ring)
+  {
+    Ring* next = ring->Next;
+    delete[] ring->Events;
+    delete ring;
+    ring = next;
+  }
+}
+
+
+void
+TraceRecorder
+::Install()
+{
+  Installed = this;
+  SetTraceFunction(Record);
+}
+
+
+void
+TraceRecorder
+::Uninstall()
+{
+  if(Installed != this)
+    return;
+  SetTraceFunction(0);
+  Installed = 0;
+}
+
+
+void
+TraceRecorder
+::Record(const char* name, char phase, int value)
+{
+  TraceRecorder* recorder = Installed;
+  if(recorder == 0)
+    return;
+
+  Ring* ring = recorder->GetRing();
+  if(phase == 'M')
+  {
+    ring->ThreadName = name;
+    return;
+  }
+
+  // Only this thread writes the ring, so a plain read of the head is enough
+  int head = ring->Head.fetchAndAddRelaxed(0);
+  Event& event = ring->Events[head & (recorder->m_Capacity - 1)];
+  event.Name = name;
+  event.Ticks = cvGetTickCount();
+  event.Value = value;
+  event.Phase = phase;
+
+  // Publish the event to Write()
+  ring->Head.fetchAndStoreRelease(head + 1);
+}
+
+
+TraceRecorder::Ring*
+TraceRecorder
+::GetRing()
+{
+  if(m_Local.hasLocalData())
+    return m_Local.localData()->Owned;
+
+  // First event from this thread; the only allocation it ever makes for tracing
+  Ring* ring = new Ring;
+  ring->Events = new Event[m_Capacity];
+  ring->Head = 0;
+  ring->ThreadName = 0;
+  ring->ThreadId = m_NextThreadId.fetchAndAddRelaxed(1);
+
+  do
+    ring->Next = m_Rings;
+  while(!m_Rings.testAndSetRelease(ring->Next, ring));
+
+  RingHandle* handle = new RingHandle;
+  handle->Owned = ring;
+  m_Local.setLocalData(handle);
+  return ring;
+}
+
+
+/** Names are literals from the code, but keep the JSON valid whatever they hold */
+static void WriteString(FILE* file, const char* text)
+{
+  fputc('"', file);
+  for(const char* c = text ? text : ""; *c; c++)
+  {
+    if(*c == '"' || *c == '\\')
+      fputc('\\', file);
+    if((unsigned char)*c >= 0x20)
+      fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+
+bool
+TraceRecorder
+::Write(const char* filename)
+{
+  FILE* file = fopen(filename, "w");
+  if(file == 0)
+  {
+    printf("Couldnt write trace file '%s'\n", filename);
+    return false;
+  }
+
+  // Timestamps are microseconds since the recorder was created; cvGetTickFrequency() is ticks per microsecond
+  double ticksPerMicrosecond = cvGetTickFrequency();
+  int written = 0;
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  std::vector<Event> events;
+  for(Ring* ring = m_Rings.fetchAndAddAcquire(0); ring; ring = ring->Next)
+  {
+    if(ring->ThreadName)
+    {
+      fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+        written++ ? ",\n" : "", ring->ThreadId);
+      WriteString(file, ring->ThreadName);
+      fprintf(file, "}}");
+    }
+
+    // Copy, then keep only the events the thread can't have overwritten meanwhile
+    int head = ring->Head.fetchAndAddAcquire(0);
+    int first = head > m_Capacity ? head - m_Capacity : 0;
+    events.clear();
+    for(int e = first; e < head; e++)
+      events.push_back(ring->Events[e & (m_Capacity - 1)]);
+    // The thread may be part way through event 'after', whose slot is that of
+    // after - capacity, so that one is lost along with everything older
+    int after = ring->Head.fetchAndAddAcquire(0);
+    int valid = after >= m_Capacity ? after - m_Capacity + 1 : 0;
+
+    // An 'E' whose 'B' was overwritten would close a span the viewer never saw open
+    int depth = 0;
+    for(int e = first; e < head; e++)
+    {
+      if(e < valid)
+        continue;
+      const Event& event = events[e - first];
+      if(event.Phase == 'B')
+        depth++;
+      else if(event.Phase == 'E')
+      {
+        if(depth == 0)
+          continue;
+        depth--;
+      }
+      fprintf(file, "%s{\"name\":", written++ ? ",\n" : "");
+      WriteString(file, event.Name);
+      fprintf(file, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", event.Phase,
+        (double)(event.Ticks - m_StartTicks) / ticksPerMicrosecond, ring->ThreadId);
+      if(event.Phase == 'i')
+        fprintf(file, ",\"s\":\"t\"");
+      if(event.Phase != 'E')
+        fprintf(file, ",\"args\":{\"value\":%d}", event.Value);
+      fprintf(file, "}");
+    }
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+
+  printf("Wrote %d trace events to %s\n", written, filename);
+  return true;
+}
+
+
+void
+TraceRecorder
+::PrintStatistics()
+{
+  for(Ring* ring = m_Rings.fetchAndAddAcquire(0); ring; ring = ring->Next)
+  {
+    int head = ring->Head.fetchAndAddAcquire(0);
+    int lost = head > m_Capacity ? head - m_Capacity : 0;
+    printf("Trace thread %d (%s): %d events, %d overwritten\n", ring->ThreadId,
+      ring->ThreadName ? ring->ThreadName : "unnamed", head, lost);
+  }
+}
@@ -0,0 +1,97 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _TraceRecorder_h
+#define _TraceRecorder_h
+
+#include <cv.h>
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QThreadStorage>
+
+#include "Trace.h"
+
+/** Records the library's trace events, and the app's, for finding out what made one
+frame slow. Every thread writes into a ring of its own, so recording an event takes no
+lock and no allocation: a thread-local lookup, a tick count and one release store. When
+a ring is full the oldest events are overwritten. Write() dumps what the rings hold as
+Chrome trace-event JSON, to be opened in chrome://tracing or Perfetto. */
+class TraceRecorder
+{
+public:
+
+  /** Constructor; eventsPerThread is rounded up to a power of two */
+  TraceRecorder(int eventsPerThread = 65536);
+
+  /** Destructor; uninstalls the recorder if it is installed */
+  ~TraceRecorder();
+
+  /** Become the library's trace function. Only one recorder can be installed. */
+  void Install();
+  void Uninstall();
+
+  /** Write the events still in the rings; safe while threads are tracing, though events
+  overwritten during the dump are left out. Returns false if the file can't be written. */
+  bool Write(const char* filename);
+
+  /** Events recorded and lost to overwriting, per thread, to stdout */
+  void PrintStatistics();
+
+protected:
+
+  struct Event
+  {
+    const char* Name;
+    int64 Ticks;
+    int Value;
+    char Phase;
+  };
+
+  /** One thread's events. Only that thread writes them; Head counts the events
+  written and is published after each one. */
+  struct Ring
+  {
+    Event* Events;
+    QAtomicInt Head;
+    const char* ThreadName;
+    int ThreadId;
+    Ring* Next;
+  };
+
+  /** Deleted by QThreadStorage when its thread ends; the ring stays with the recorder */
+  struct RingHandle
+  {
+    Ring* Owned;
+  };
+
+  /** The installed function */
+  static void Record(const char* name, char phase, int value);
+
+  /** The calling thread's ring, created on its first event */
+  Ring* GetRing();
+
+  static TraceRecorder* Installed;
+
+  int m_Capacity;
+  int64 m_StartTicks;
+
+  /** Every ring ever created, newest first; only ever pushed to */
+  QAtomicPointer<Ring> m_Rings;
+  QAtomicInt m_NextThreadId;
+
+  QThreadStorage<RingHandle*> m_Local;
+};
+
+#endif
@@ -0,0 +1,157 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "TrialScheduler.h"
+
+#include <math.h>
+#include <stdio.h>
+
+/** Small portable generator, so a seed gives the same schedule on every machine */
+static unsigned int NextRandom(unsigned int& state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+/** Uniformly distributed seconds between low and high */
+static double Uniform(unsigned int& state, double low, double high)
+{
+  return low + (high - low) * (NextRandom(state) % 10000) / 10000.0;
+}
+
+
+TrialScheduler
+::TrialScheduler(QObject* parent)
+  : QObject(parent)
+{
+  m_Next = 0;
+  m_Timer.setSingleShot(true);
+  connect(&m_Timer, SIGNAL( timeout() ), this, SLOT( OnTimer() ));
+}
+
+
+bool
+TrialScheduler
+::Load(const char* filename)
+{
+  FILE* file = fopen(filename, "r");
+  if(file == 0)
+    return false;
+
+  m_Events.clear();
+  char line[256];
+  ScheduleEvent event;
+  while(fgets(line, sizeof(line), file))
+  {
+    if(line[0] == '#' || sscanf(line, "%lf %d", &event.Time, &event.Epoch) != 2)
+      continue;
+    if(!m_Events.empty() && event.Time < m_Events.back().Time)
+    {
+      printf("Trial schedule '%s' goes back in time at %.3f s; ignoring the rest\n", filename, event.Time);
+      break;
+    }
+    m_Events.push_back(event);
+  }
+  fclose(file);
+  return !m_Events.empty();
+}
+
+
+bool
+TrialScheduler
+::Save(const char* filename) const
+{
+  FILE* file = fopen(filename, "w");
+  if(file == 0)
+    return false;
+
+  fprintf(file, "# seconds epoch (0 = Intertrial, 1 = Button Press, 2 = Reach)\n");
+  for(size_t e = 0; e < m_Events.size(); e++)
+    fprintf(file, "%.3f %d\n", m_Events[e].Time, m_Events[e].Epoch);
+  fclose(file);
+  return true;
+}
+
+
+void
+TrialScheduler
+::Generate(unsigned int seed, double duration)
+{
+  m_Events.clear();
+  unsigned int state = seed ? seed : 1;
+
+  // Typical task timing: a few seconds between trials, then a button press held
+  // for up to two seconds, then a reach of about a second
+  double time = 0;
+  while(true)
+  {
+    time += Uniform(state, 2.0, 5.0);
+    if(time > duration) break;
+    ScheduleEvent press = { time, 1 };
+    m_Events.push_back(press);
+
+    time += Uniform(state, 0.5, 2.0);
+    ScheduleEvent reach = { time, 2 };
+    m_Events.push_back(reach);
+
+    time += Uniform(state, 0.5, 1.5);
+    ScheduleEvent intertrial = { time, 0 };
+    m_Events.push_back(intertrial);
+  }
+}
+
+
+void
+TrialScheduler
+::Start()
+{
+  m_Next = 0;
+  m_Lateness.Reset();
+  m_Clock.start();
+  this->OnTimer();
+}
+
+
+void
+TrialScheduler
+::Stop()
+{
+  m_Timer.stop();
+  m_Next = m_Events.size();
+}
+
+
+void
+TrialScheduler
+::OnTimer()
+{
+  // Timers may fire a little early or late; deliver by the clock, not by the timer
+  int now = m_Clock.elapsed();
+  while(m_Next < m_Events.size() && m_Events[m_Next].Time * 1000.0 <= now)
+  {
+    m_Lateness.Add(now - m_Events[m_Next].Time * 1000.0);
+    emit AdvanceEpoch(m_Events[m_Next].Epoch);
+    m_Next++;
+  }
+
+  if(m_Next < m_Events.size())
+  {
+    int wait = (int)ceil(m_Events[m_Next].Time * 1000.0) - m_Clock.elapsed();
+    m_Timer.start(wait > 0 ? wait : 0);
+  }
+  else
+    emit Finished();
+}
@@ -0,0 +1,96 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _TrialScheduler_h
+#define _TrialScheduler_h
+
+#include <vector>
+
+#include <QObject>
+#include <QTime>
+#include <QTimer>
+
+#include "LatencyStatistics.h"
+
+/** One epoch change of a trial schedule */
+struct ScheduleEvent
+{
+  /** Seconds from the start of the run */
+  double Time;
+  int Epoch;
+};
+
+/** Drives AdvanceTrialEpoch() from a trial schedule instead of from chance, so runs
+are repeatable. The schedule is replayed from a file of lines
+  <seconds> <epoch>
+or generated from a seed with realistic epoch durations; a generated schedule can be
+saved and replayed later. Each change is emitted on its timestamp from a single shot
+timer, and how late it was delivered is measured. */
+class TrialScheduler : public QObject
+{
+Q_OBJECT
+
+public:
+
+  /** Constructor */
+  TrialScheduler(QObject* parent = 0);
+
+  /** Read a schedule; returns false if the file can't be opened or holds no events */
+  bool Load(const char* filename);
+
+  /** Write the schedule */
+  bool Save(const char* filename) const;
+
+  /** Generate about duration seconds of trials. The same seed gives the same schedule on every machine. */
+  void Generate(unsigned int seed, double duration);
+
+  /** Start replaying; event times count from now */
+  void Start();
+
+  /** Stop replaying */
+  void Stop();
+
+  int GetNumberOfEvents() const { return (int)m_Events.size(); }
+
+  /** Seconds from the first to the last event */
+  double GetDuration() const { return m_Events.empty() ? 0 : m_Events.back().Time; }
+
+  /** Milliseconds between an event's timestamp and its delivery */
+  const LatencyStatistics& GetLateness() const { return m_Lateness; }
+
+signals:
+
+  /** Time for the next epoch; connect to FinalProjectApp::AdvanceTrialEpoch() */
+  void AdvanceEpoch(int epoch);
+
+  /** The last event was delivered */
+  void Finished();
+
+protected slots:
+
+  /** Deliver every event that is due and arm the timer for the next one */
+  void OnTimer();
+
+protected:
+
+  std::vector<ScheduleEvent> m_Events;
+  size_t m_Next;
+
+  QTime m_Clock;
+  QTimer m_Timer;
+
+  LatencyStatistics m_Lateness;
+};
+
+#endif
@@ -0,0 +1,67 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "TripleBuffer.h"
+
+TripleBuffer
+::TripleBuffer()
+{
+  m_Back = 0;
+  m_Middle = 1;
+  m_Front = 2;
+}
+
+
+QImage&
+TripleBuffer
+::GetBackBuffer(int width, int height)
+{
+  // Only the producer ever sees the back image, so it can be reallocated freely
+  QImage& back = m_Buffers[m_Back];
+  if(back.width() != width || back.height() != height)
+    back = QImage(width, height, QImage::Format_RGB32);
+  return back;
+}
+
+
+bool
+TripleBuffer
+::Publish()
+{
+  int old = m_Middle.fetchAndStoreOrdered(m_Back | NewFrame);
+  m_Back = old & IndexMask;
+  return !(old & NewFrame);
+}
+
+
+bool
+TripleBuffer
+::IsFrameWaiting()
+{
+  return (m_Middle.fetchAndAddOrdered(0) & NewFrame) != 0;
+}
+
+
+bool
+TripleBuffer
+::Acquire()
+{
+  if(!(m_Middle.fetchAndAddOrdered(0) & NewFrame))
+    return false;
+
+  // Only the producer sets the flag, so the middle still holds a new frame here
+  int old = m_Middle.fetchAndStoreOrdered(m_Front);
+  m_Front = old & IndexMask;
+  return true;
+}
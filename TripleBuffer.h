@@ -0,0 +1,64 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _TripleBuffer_h
+#define _TripleBuffer_h
+
+#include <QAtomicInt>
+#include <QImage>
+
+/** Hands display frames from the app thread to the GUI thread without either side
+waiting. The producer draws into the back image while the newest finished frame waits
+in the middle and the consumer shows the front one; publishing and taking a frame are
+each a single atomic exchange with the middle. A consumer that falls behind skips
+frames, and the producer never blocks on a slow repaint. */
+class TripleBuffer
+{
+public:
+
+  /** Constructor */
+  TripleBuffer();
+
+  /** Producer: the image to draw the next frame into, resized if needed */
+  QImage& GetBackBuffer(int width, int height);
+
+  /** Producer: publish the back image as the newest frame. Returns true if the consumer
+  had taken the previous one, i.e. when it needs to be told about this one. */
+  bool Publish();
+
+  /** Producer: is the last published frame still waiting for the consumer? Drawing
+  another one then only replaces a frame nobody has looked at yet. */
+  bool IsFrameWaiting();
+
+  /** Consumer: take the newest frame into the front image; returns false if there is no new one */
+  bool Acquire();
+
+  /** Consumer: the frame taken last */
+  const QImage& GetFrontBuffer() const { return m_Buffers[m_Front]; }
+
+protected:
+
+  /** The middle index and a flag telling whether it holds a frame not taken yet */
+  enum { IndexMask = 3, NewFrame = 4 };
+
+  QImage m_Buffers[3];
+
+  /** Owned by the producer and by the consumer */
+  int m_Back;
+  int m_Front;
+
+  QAtomicInt m_Middle;
+};
+
+#endif
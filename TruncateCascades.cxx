@@ -0,0 +1,288 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cv.h>
+#include <highgui.h>
+
+#include <QThreadPool>
+
+#include "DetectionProfile.h"
+#include "HaarFeatureDetector.h"
+#include "PrunedHaarFeatureDetector.h"
+#include "QtParallelFor.h"
+#include "TiledHaarFeatureDetector.h"
+
+// Derives fast "first K stages" cascades from full Haar cascades and measures the
+// two-tier "pruned" backend built on them against the full cascade:
+//
+//   TruncateCascades <corpus> [-k 2,4,6] [-o directory] [-threads n] [-serial]
+//
+// The corpus is the ParameterSweep one, one annotation per line:
+//   <image file> <cascade file> <x> <y> <width> <height>
+// with -1 -1 -1 -1 for frames in which the feature is not visible.
+//
+// For every cascade and K, <directory>/<cascade>.first<K>.xml is written (it can be
+// bound to the plain "haar" backend as well), and the pruned detector with that K is
+// run over the cascade's frames with the settings of DetectionProfile.txt. Recall,
+// false alarms and latency per K go to stdout and TruncateCascades.csv; bind the K
+// that suits a feature as "<feature> pruned <cascade file>#<K>" in FeatureDetectors.txt.
+// The full cascade split into tiles across cores (the "tiled" backend) is measured too;
+// it should match the full cascade, with its latency falling as -threads goes up.
+// Its candidates column counts tiles.
+
+// A detection counts as a hit if it overlaps the annotation by at least this much
+static const double MinOverlap = 0.5;
+
+// Tried when -k isn't given, as far as the cascade has stages
+static const int DefaultStages[] = { 2, 3, 4, 5, 6, 8, 10, 12, 15, 20 };
+
+/** One annotated frame */
+struct Frame
+{
+  IplImage* Image;
+  CvRect Truth;
+};
+
+/** Recall, false alarms and latency of one detector over a cascade's frames */
+struct Result
+{
+  int Stages;
+  int Hits;
+  int Visible;
+  int FalseAlarms;
+  int Hidden;
+  double Candidates;
+  double Latency;
+  double Latency99;
+};
+
+
+/** Intersection over union of two rectangles */
+static double Overlap(CvRect a, CvRect b)
+{
+  int x0 = std::max(a.x, b.x), y0 = std::max(a.y, b.y);
+  int x1 = std::min(a.x + a.width, b.x + b.width), y1 = std::min(a.y + a.height, b.y + b.height);
+  if(x1 <= x0 || y1 <= y0)
+    return 0;
+
+  double intersection = (double)(x1 - x0) * (y1 - y0);
+  return intersection / ((double)a.width * a.height + (double)b.width * b.height - intersection);
+}
+
+
+/** Run a detector over the frames; the first pass only warms it up */
+static Result Evaluate(FeatureDetector* detector, const std::vector<Frame>& frames, int stages)
+{
+  Result result = { stages, 0, 0, 0, 0, 0, 0, 0 };
+  PrunedHaarFeatureDetector* pruned = dynamic_cast<PrunedHaarFeatureDetector*>(detector);
+  TiledHaarFeatureDetector* tiled = dynamic_cast<TiledHaarFeatureDetector*>(detector);
+
+  detector->Detect(frames[0].Image);
+  detector->ResetCost();
+  for(size_t f = 0; f < frames.size(); f++)
+  {
+    CvRect found = detector->Detect(frames[f].Image);
+    if(pruned)
+      result.Candidates += pruned->GetNumberOfCandidates();
+    if(tiled)
+      result.Candidates += tiled->GetNumberOfTiles();
+
+    const CvRect& truth = frames[f].Truth;
+    if(truth.width > 0)
+    {
+      result.Visible++;
+      if(found.width > 0 && Overlap(found, truth) >= MinOverlap)
+        result.Hits++;
+    }
+    else
+    {
+      result.Hidden++;
+      if(found.width > 0)
+        result.FalseAlarms++;
+    }
+  }
+
+  result.Candidates /= frames.size();
+  result.Latency = detector->GetCost().GetMean();
+  result.Latency99 = detector->GetCost().GetPercentile(0.99);
+  return result;
+}
+
+
+static void PrintResult(FILE* csv, const std::string& cascade, const char* name, const Result& r)
+{
+  double recall = r.Visible ? (double)r.Hits / r.Visible : 0;
+  double falseAlarms = r.Hidden ? (double)r.FalseAlarms / r.Hidden : 0;
+  printf("  %8s %6.3f %6.3f %10.1f %8.2fms %8.2fms\n", name, recall, falseAlarms, r.Candidates, r.Latency, r.Latency99);
+  fprintf(csv, "%s,%d,%f,%f,%f,%f,%f\n", cascade.c_str(), r.Stages, recall, falseAlarms, r.Candidates, r.Latency, r.Latency99);
+}
+
+
+/** File name without directory and extension */
+static std::string Stem(const std::string& path)
+{
+  size_t slash = path.find_last_of("/\\");
+  std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+  size_t dot = name.rfind('.');
+  return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+
+int main( int argc, char** argv )
+{
+  if(argc < 2)
+  {
+    printf("Usage: TruncateCascades <corpus> [-k 2,4,6] [-o directory] [-threads n] [-serial]\n");
+    return 1;
+  }
+
+  std::vector<int> stageList(DefaultStages, DefaultStages + sizeof(DefaultStages) / sizeof(DefaultStages[0]));
+  std::string outputDir = ".";
+  bool serial = false;
+  for(int i = 2; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+    {
+      stageList.clear();
+      for(char* k = strtok(argv[++i], ","); k; k = strtok(0, ","))
+        stageList.push_back(atoi(k));
+    }
+    else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      outputDir = argv[++i];
+    else if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+      QThreadPool::globalInstance()->setMaxThreadCount(atoi(argv[++i]));
+    else if(strcmp(argv[i], "-serial") == 0)
+      serial = true;
+  }
+
+  // The candidates of a frame are verified on the thread pool, as in the app
+  if(!serial)
+    SetParallelFor(QtParallelFor);
+
+  FILE* corpus = fopen(argv[1], "r");
+  if(corpus == 0)
+  {
+    printf("Couldnt open corpus '%s'\n", argv[1]);
+    return 1;
+  }
+
+  // Read the annotations, loading every image only once
+  std::map<std::string, IplImage*> images;
+  std::map<std::string, std::vector<Frame> > frames;
+  char line[2048], imageName[1024], cascadeName[1024];
+  while(fgets(line, sizeof(line), corpus))
+  {
+    Frame frame;
+    if(line[0] == '#' || sscanf(line, "%1023s %1023s %d %d %d %d", imageName, cascadeName,
+      &frame.Truth.x, &frame.Truth.y, &frame.Truth.width, &frame.Truth.height) != 6)
+      continue;
+
+    IplImage*& image = images[imageName];
+    if(image == 0)
+      image = cvLoadImage(imageName, CV_LOAD_IMAGE_GRAYSCALE);
+    if(image == 0)
+    {
+      printf("Couldnt load image '%s'\n", imageName);
+      images.erase(imageName);
+      continue;
+    }
+
+    frame.Image = image;
+    frames[cascadeName].push_back(frame);
+  }
+  fclose(corpus);
+
+  DetectionProfile profile;
+  profile.Load("DetectionProfile.txt");
+
+  FILE* csv = fopen("TruncateCascades.csv", "w");
+  fprintf(csv, "%s,%s,%s,%s,%s,%s,%s\n", "Cascade", "Stages", "Recall", "FalseAlarms", "Candidates", "Latency", "Latency99");
+
+  std::map<std::string, std::vector<Frame> >::iterator it;
+  for(it = frames.begin(); it != frames.end(); ++it)
+  {
+    const std::string& cascadeName = it->first;
+
+    // The full cascade is the reference
+    HaarFeatureDetector full;
+    if(!full.Load(cascadeName))
+    {
+      printf("Couldnt load cascade '%s'\n", cascadeName.c_str());
+      continue;
+    }
+    full.SetParameters(profile.Get(cascadeName));
+    int stages = full.GetCascade()->count;
+
+    printf("\n%s: %d stages, %d annotated frames\n", cascadeName.c_str(), stages, (int)it->second.size());
+    printf("  %8s %6s %6s %10s %10s %10s\n", "stages", "recall", "false", "candidates", "mean", "p99");
+    PrintResult(csv, cascadeName, "full", Evaluate(&full, it->second, stages));
+
+    TiledHaarFeatureDetector tiled;
+    if(tiled.Load(cascadeName))
+    {
+      tiled.SetParameters(profile.Get(cascadeName));
+      PrintResult(csv, cascadeName, "tiled", Evaluate(&tiled, it->second, stages));
+    }
+
+    for(size_t k = 0; k < stageList.size(); k++)
+    {
+      int fastStages = stageList[k];
+      if(fastStages < 1 || fastStages >= stages)
+        continue;
+
+      // Write the fast cascade out on its own
+      CvHaarClassifierCascade* cascade = (CvHaarClassifierCascade*)cvLoad(cascadeName.c_str(), 0, 0, 0);
+      int loadedStages = PrunedHaarFeatureDetector::Truncate(cascade, fastStages);
+      if(loadedStages == 0)
+      {
+        printf("  tree cascade, can't be truncated\n");
+        cvReleaseHaarClassifierCascade(&cascade);
+        break;
+      }
+      char fastName[2048];
+      snprintf(fastName, sizeof(fastName), "%s/%s.first%d.xml", outputDir.c_str(), Stem(cascadeName).c_str(), fastStages);
+      cvSave(fastName, cascade);
+      PrunedHaarFeatureDetector::Untruncate(cascade, loadedStages);
+      cvReleaseHaarClassifierCascade(&cascade);
+
+      // And measure the two tiers with it
+      PrunedHaarFeatureDetector pruned;
+      char model[2048];
+      snprintf(model, sizeof(model), "%s#%d", cascadeName.c_str(), fastStages);
+      if(!pruned.Load(model))
+        continue;
+      pruned.SetParameters(profile.Get(cascadeName));
+
+      char name[32];
+      snprintf(name, sizeof(name), "%d", fastStages);
+      PrintResult(csv, cascadeName, name, Evaluate(&pruned, it->second, fastStages));
+    }
+  }
+  fclose(csv);
+  printf("\nWrote the fast cascades to '%s' and all results to TruncateCascades.csv\n", outputDir.c_str());
+
+  for(std::map<std::string, IplImage*>::iterator im = images.begin(); im != images.end(); ++im)
+    cvReleaseImage(&im->second);
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#include "WorkStealingPool.h"
+
+#include <QThread>
+
+/** One thread of the pool */
+class WorkStealingPool::Worker : public QThread
+{
+public:
+  Worker(WorkStealingPool* pool, Job* job, int index)
+    : m_Pool(pool), m_Job(job), m_Index(index), m_TasksRun(0) {}
+
+  int GetTasksRun() const { return m_TasksRun; }
+
+protected:
+  virtual void run()
+  {
+    int task;
+    while((task = m_Pool->NextTask(m_Index)) >= 0)
+    {
+      m_Job->Run(task, m_Index);
+      m_TasksRun++;
+    }
+  }
+
+  WorkStealingPool* m_Pool;
+  Job* m_Job;
+  int m_Index;
+  int m_TasksRun;
+};
+
+
+WorkStealingPool
+::WorkStealingPool(int threads)
+{
+  m_NumberOfThreads = threads > 0 ? threads : QThread::idealThreadCount();
+  if(m_NumberOfThreads < 1)
+    m_NumberOfThreads = 1;
+  m_Steals = 0;
+}
+
+
+void
+WorkStealingPool
+::Run(Job* job, const std::vector< std::vector<int> >& queues)
+{
+  m_Queues.resize(m_NumberOfThreads);
+  for(int w = 0; w < m_NumberOfThreads; w++)
+  {
+    m_Queues[w] = new Queue;
+    if(w < (int)queues.size())
+      m_Queues[w]->Tasks.assign(queues[w].begin(), queues[w].end());
+  }
+  m_StealCount.fetchAndStoreOrdered(0);
+
+  std::vector<Worker*> workers;
+  for(int w = 0; w < m_NumberOfThreads; w++)
+  {
+    workers.push_back(new Worker(this, job, w));
+    workers.back()->start();
+  }
+
+  m_TasksRun.assign(m_NumberOfThreads, 0);
+  for(int w = 0; w < m_NumberOfThreads; w++)
+  {
+    workers[w]->wait();
+    m_TasksRun[w] = workers[w]->GetTasksRun();
+  }
+
+  // Workers still running steal from every queue, so none goes until all have finished
+  for(int w = 0; w < m_NumberOfThreads; w++)
+  {
+    delete workers[w];
+    delete m_Queues[w];
+  }
+  m_Queues.clear();
+  m_Steals = m_StealCount.fetchAndAddOrdered(0);
+}
+
+
+int
+WorkStealingPool
+::NextTask(int worker)
+{
+  // Own work first, oldest first
+  Queue* own = m_Queues[worker];
+  own->Mutex.lock();
+  if(!own->Tasks.empty())
+  {
+    int task = own->Tasks.front();
+    own->Tasks.pop_front();
+    own->Mutex.unlock();
+    return task;
+  }
+  own->Mutex.unlock();
+
+  // Tasks are never added while running, so once every deque has been found empty we're done
+  for(int i = 1; i < m_NumberOfThreads; i++)
+  {
+    Queue* victim = m_Queues[(worker + i) % m_NumberOfThreads];
+    QMutexLocker lock(&victim->Mutex);
+    if(!victim->Tasks.empty())
+    {
+      int task = victim->Tasks.back();
+      victim->Tasks.pop_back();
+      m_StealCount.fetchAndAddRelaxed(1);
+      return task;
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,77 @@
+/*=========================================================================
+
+  University of Pittsburgh Bioengineering 1351/2351
+  Final project example code
+
+  Copyright (c) 2011 by Damion Shelton
+
+  All rights reserved.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef _WorkStealingPool_h
+#define _WorkStealingPool_h
+
+#include <deque>
+#include <vector>
+
+#include <QAtomicInt>
+#include <QMutex>
+
+/** Runs a fixed set of tasks on a group of threads. Every thread owns a deque of
+tasks and works through it from the front; a thread whose deque runs dry steals
+from the back of another's. Tasks handed out in order therefore run in order on
+their owner, while the idle threads take the work furthest away from it. */
+class WorkStealingPool
+{
+public:
+
+  /** Work to run; Run() is called from the worker threads */
+  class Job
+  {
+  public:
+    virtual ~Job() {}
+
+    /** Run one task on the given worker (0 .. threads-1) */
+    virtual void Run(int task, int worker) = 0;
+  };
+
+  /** Constructor; threads <= 0 uses one per core */
+  WorkStealingPool(int threads = 0);
+
+  int GetNumberOfThreads() const { return m_NumberOfThreads; }
+
+  /** Run the tasks and wait for all of them. queues[w] holds the tasks dealt to worker w
+  in the order it should run them; there must be one queue per thread. */
+  void Run(Job* job, const std::vector< std::vector<int> >& queues);
+
+  /** Tasks run by each worker and tasks taken from another worker's deque in the last Run() */
+  const std::vector<int>& GetTasksRun() const { return m_TasksRun; }
+  int GetSteals() const { return m_Steals; }
+
+protected:
+
+  class Worker;
+  friend class Worker;
+
+  /** A worker's deque and the lock the owner and the thieves share */
+  struct Queue
+  {
+    QMutex Mutex;
+    std::deque<int> Tasks;
+  };
+
+  /** Next task for a worker: its own first, then one stolen; -1 when no work is left */
+  int NextTask(int worker);
+
+  int m_NumberOfThreads;
+  std::vector<Queue*> m_Queues;
+  std::vector<int> m_TasksRun;
+  int m_Steals;
+  QAtomicInt m_StealCount;
+};
+
+#endif
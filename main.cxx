@@ -13,8 +13,12 @@
 
 =========================================================================*/
 
+#include <stdlib.h>
+#include <string.h>
 #include <qapplication.h>
 #include "FinalProjectWindow.h"
+#include "QtParallelFor.h"
+#include "TraceRecorder.h"
 
 // main is very short... most of the action occurs in the window
 // and application classes and main only serves to launch the window.
@@ -24,13 +28,67 @@ int main( int argc, char** argv )
   std::cout << "Creating QApplication" << std::endl;
   QApplication app( argc, argv );
   
+  // Options, mostly for repeatable load tests:
+  //   -timer            poll the camera every 33 ms instead of processing frames as they arrive
+  //   -schedule <file>  replay a trial schedule (see TrialScheduler)
+  //   -seed <n>         generate the trial schedule (and synthetic frames) from this seed
+  //   -duration <s>     length of a generated schedule in seconds
+  //   -video <file>     take frames from a recorded video, looped
+  //   -synthetic        take generated frames
+  //   -luma             capture luma (gray, YUYV or NV12) where the source can, rather than BGR
+  //   -hitrate <r>      use the fastest DetectionProfile.txt settings with at least this hit rate
+  //   -quit             close once the schedule has been played
+  //   -trace <file>     record where each frame's time goes and write it as Chrome trace-event JSON on exit
+  RunOptions options;
+  const char* traceFile = 0;
+  for(int i = 1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-timer") == 0)
+      options.EventDriven = false;
+    else if(strcmp(argv[i], "-schedule") == 0 && i + 1 < argc)
+      options.Schedule = argv[++i];
+    else if(strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+      options.Seed = (unsigned int)strtoul(argv[++i], 0, 10);
+    else if(strcmp(argv[i], "-duration") == 0 && i + 1 < argc)
+      options.Duration = atof(argv[++i]);
+    else if(strcmp(argv[i], "-video") == 0 && i + 1 < argc)
+      options.Video = argv[++i];
+    else if(strcmp(argv[i], "-synthetic") == 0)
+      options.Synthetic = true;
+    else if(strcmp(argv[i], "-luma") == 0)
+      options.LumaOnly = true;
+    else if(strcmp(argv[i], "-hitrate") == 0 && i + 1 < argc)
+      options.RequiredHitRate = atof(argv[++i]);
+    else if(strcmp(argv[i], "-quit") == 0)
+      options.QuitAtEnd = true;
+    else if(strcmp(argv[i], "-trace") == 0 && i + 1 < argc)
+      traceFile = argv[++i];
+  }
+
+  // Detectors that split their work (the two-tier "pruned" and the "tiled" backends) run it on Qt's thread pool
+  SetParallelFor(QtParallelFor);
+
+  // Tracing has to be installed before any of the app's threads start
+  TraceRecorder tracer;
+  if(traceFile)
+    tracer.Install();
+
   std::cout << "Creating FinalProjectWindow" << std::endl;
-  FinalProjectWindow* mainWindow = new FinalProjectWindow;
+  FinalProjectWindow* mainWindow = new FinalProjectWindow(0, options);
   mainWindow->show();
   mainWindow->repaint();
   
   std::cout << "Starting app event loop" << std::endl;
 
 
-  return app.exec();
+  int result = app.exec();
+
+  // The app and its threads are gone by now, so the rings hold everything up to the end
+  if(traceFile)
+  {
+    tracer.Uninstall();
+    tracer.PrintStatistics();
+    tracer.Write(traceFile);
+  }
+  return result;
 }
\ No newline at end of file
@@ -1,29 +1,25 @@
 /**
  * @file objectDetection.cpp
  * @author A. Huaman ( based in the classic facedetect.cpp in samples/c )
- * @brief A simplified version of facedetect.cpp, show how to load a cascade classifier and how to find objects (Face + eyes) in a video stream
+ * @brief A simplified version of facedetect.cpp, show how to find objects (Face, eyes, ...) in a video stream.
+ * Detection now goes through the attention tracker's C API, so this sample runs the same
+ * detectors, settings and attention counter as the Qt app, and shows how a program embeds it.
+ * Usage: objectDetection [feature number, see AttentionTrackerAPI.h]
  */
-#include "opencv2/objdetect/objdetect.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 
-#include <iostream>
 #include <stdio.h>
+#include <stdlib.h>
 
-using namespace std;
-using namespace cv;
+#include "AttentionTrackerAPI.h"
 
 /** Function Headers */
-void detectAndDisplay( Mat frame );
+void detectAndDisplay( atTracker* tracker, IplImage* frame, double time );
 
 /** Global variables */
-//-- Note, either copy these two files from opencv/data/haarscascades to your current folder, or change these locations
-String face_cascade_name = "haarcascade_frontalface_alt.xml";
-String eyes_cascade_name = "haarcascade_eye_tree_eyeglasses.xml";
-CascadeClassifier face_cascade;
-CascadeClassifier eyes_cascade;
-string window_name = "Capture - Face detection";
-RNG rng(12345);
+const char* window_name = "Capture - Face detection";
+int feature = AT_FEATURE_FRONTAL_FACE;
 
 /**
  * @function main
@@ -31,65 +27,67 @@ RNG rng(12345);
 int main( int argc, const char** argv )
 {
   CvCapture* capture;
-  Mat frame;
+  IplImage* frame;
+
+  //-- 1. Load the cascades, from the current folder like the app
+  atTracker* tracker = atCreateTracker();
+  if( !tracker ){ printf("--(!)Error loading\n"); return -1; };
+
+  if( argc > 1 ) feature = atoi( argv[1] );
+  if( atSetFeature( tracker, feature ) < 0 ){ printf("--(!)Unknown feature %d\n", feature); return -1; };
 
-  //-- 1. Load the cascades
-  if( !face_cascade.load( face_cascade_name ) ){ printf("--(!)Error loading\n"); return -1; };
-  if( !eyes_cascade.load( eyes_cascade_name ) ){ printf("--(!)Error loading\n"); return -1; };
- 
   //-- 2. Read the video stream
   capture = cvCaptureFromCAM( -1 );
   if( capture )
   {
+    double start = (double)cvGetTickCount();
     while( true )
     {
       frame = cvQueryFrame( capture );
-  
-      //-- 3. Apply the classifier to the frame
-      if( !frame.empty() )
-       { detectAndDisplay( frame ); }
+      double time = ((double)cvGetTickCount() - start) / (cvGetTickFrequency() * 1000000.0);
+
+      //-- 3. Apply the tracker to the frame
+      if( frame )
+       { detectAndDisplay( tracker, frame, time ); }
       else
        { printf(" --(!) No captured frame -- Break!"); break; }
-      
-      int c = waitKey(10);
-      if( (char)c == 'c' ) { break; } 
+
+      int c = cvWaitKey(10);
+      if( (char)c == 'c' ) { break; }
 
     }
+    cvReleaseCapture( &capture );
   }
+  atReleaseTracker( &tracker );
   return 0;
 }
 
 /**
  * @function detectAndDisplay
  */
-void detectAndDisplay( Mat frame )
+void detectAndDisplay( atTracker* tracker, IplImage* frame, double time )
 {
-   std::vector<Rect> faces;
-   Mat frame_gray;
+   //-- The tracker reads the capture buffer in place and hands back its own rectangles
+   atFrame view = { (const unsigned char*)frame->imageData, frame->width, frame->height, frame->widthStep, frame->nChannels };
+   const atRect* found;
+   int count;
+   if( atProcessFrame( tracker, &view, time, &found, &count ) < 0 )
+     return;
 
-   cvtColor( frame, frame_gray, CV_BGR2GRAY );
-   equalizeHist( frame_gray, frame_gray );
-   //-- Detect faces
-   face_cascade.detectMultiScale( frame_gray, faces, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE, Size(30, 30) );
-
-   for( int i = 0; i < faces.size(); i++ )
+   //-- Faces get an ellipse, everything else (eyes, ...) a circle
+   for( int i = 0; i < count; i++ )
     {
-      Point center( faces[i].x + faces[i].width*0.5, faces[i].y + faces[i].height*0.5 );
-      ellipse( frame, center, Size( faces[i].width*0.5, faces[i].height*0.5), 0, 0, 360, Scalar( 255, 0, 255 ), 2, 8, 0 );
-
-      Mat faceROI = frame_gray( faces[i] );
-      std::vector<Rect> eyes;
+      if( found[i].width <= 0 )
+        continue;
 
-      //-- In each face, detect eyes
-      eyes_cascade.detectMultiScale( faceROI, eyes, 1.1, 2, 0 |CV_HAAR_SCALE_IMAGE, Size(30, 30) );
+      CvPoint center = cvPoint( found[i].x + found[i].width/2, found[i].y + found[i].height/2 );
+      if( feature == AT_FEATURE_FRONTAL_FACE )
+        cvEllipse( frame, center, cvSize( found[i].width/2, found[i].height/2 ), 0, 0, 360, CV_RGB( 255, 0, 255 ), 2, 8, 0 );
+      else
+        cvCircle( frame, center, cvRound( (found[i].width + found[i].height)*0.25 ), CV_RGB( 0, 0, 255 ), 3, 8, 0 );
+    }
 
-      for( int j = 0; j < eyes.size(); j++ )
-       {
-         Point center( faces[i].x + eyes[j].x + eyes[j].width*0.5, faces[i].y + eyes[j].y + eyes[j].height*0.5 ); 
-         int radius = cvRound( (eyes[j].width + eyes[i].height)*0.25 );
-         circle( frame, center, radius, Scalar( 255, 0, 0 ), 3, 8, 0 );
-       }
-    } 
-   //-- Show what you got
-   imshow( window_name, frame );
+   //-- Show what you got, with the attention counter
+   printf( "attention %d\r", atGetAttention( tracker ) );
+   cvShowImage( window_name, frame );
 }